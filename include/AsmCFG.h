@@ -0,0 +1,59 @@
+#ifndef ASMCFG_H
+#define ASMCFG_H
+
+#include "ast/Asm.h"
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace ccomp {
+// A basic block of one function's Asm, as the range [begin, end) of its
+// instructions: labels and directives from begin to body, then the body,
+// which ends in at most one Jmp, JmpCC, JumpTable or Return.
+struct AsmBlock {
+  size_t begin;
+  size_t body;
+  size_t end;
+  // the block reached by falling off the end, or -1
+  int fall = -1;
+  // the fallthrough first, then the jump targets
+  std::vector<int> succs;
+};
+
+// Control flow graph of one function's Asm, for the passes after
+// instruction selection. It indexes the instructions it was built from, so
+// a pass that changes them builds a new one.
+class AsmCFG {
+public:
+  explicit AsmCFG(const std::vector<std::shared_ptr<Asm>>& instructions);
+
+  int find_block(const std::string& label) const;
+  bool dominates(int a, int b) const;
+  // the nearest common dominator of two blocks reachable from the entry
+  int intersect(int a, int b) const;
+
+  std::vector<AsmBlock> blocks;
+  std::vector<std::vector<int>> preds;
+  // reverse postorder of the blocks reachable from the entry
+  std::vector<int> rpo;
+  // immediate dominators, -1 for unreachable blocks
+  std::vector<int> idom;
+
+private:
+  std::unordered_map<std::string, int> label_to_block_;
+  std::vector<int> rpo_index_;
+
+  void split(const std::vector<std::shared_ptr<Asm>>& instructions);
+  void link(const std::vector<std::shared_ptr<Asm>>& instructions);
+  void compute_dominators();
+};
+
+// Instruction helpers shared by the Asm passes.
+bool ends_block(const Asm& inst);
+// labels and assembler directives, which start a block rather than end one
+bool is_directive(const Asm& inst);
+const std::string& target_of(const std::shared_ptr<Asm>& target);
+}
+
+#endif // ASMCFG_H
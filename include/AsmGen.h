@@ -2,24 +2,61 @@
 #define ASMGEN_H
 
 #include "ErrorHandler.h"
+#include "Options.h"
+#include "Profile.h"
+#include "TreeMatcher.h"
 #include "ast/Asm.h"
 #include "ast/Tacky.h"
 #include <memory>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
 
 namespace ccomp {
 class AsmGen {
 public:
-  AsmGen(Tacky* tackycode, ErrorHandler& errorHandler);
+  AsmGen(Tacky* tackycode, const Options& options, const Profile& profile,
+         ErrorHandler& errorHandler);
   std::shared_ptr<Asm> gen();
 
 private:
   Tacky* tackycode_;
+  const Options& options_;
+  const Profile& profile_;
   ErrorHandler& errorHandler_;
   std::vector<std::shared_ptr<Asm>> instructions_;
+  // Tacky variables of the current function read anywhere but right after
+  // an instruction writing them
+  std::unordered_set<std::string> nonlocal_;
+  // arithmetic only feeding the next instruction, by dest, left for the
+  // tree matcher to fold into it
+  std::unordered_map<std::string, std::unique_ptr<TreeMatcher::Node>> pending_;
+  // numbers the pseudos introduced here
+  int next_temp_ = 0;
 
   std::shared_ptr<Asm> gen(Tacky* expr);
   std::vector<std::shared_ptr<Asm>> gen(const std::vector<std::shared_ptr<Tacky>>& exprs);
   std::shared_ptr<Asm> get_label(std::shared_ptr<Tacky> inst);
+  static AsmCondCode cond_code(TokenType op);
+  static AsmCondCode invert(AsmCondCode cc);
+  static AsmCondCode swap(AsmCondCode cc);
+  // Sets the flags for src1 REL src2 and returns the condition code to test.
+  AsmCondCode gen_compare(const std::shared_ptr<Tacky>& src1,
+                          const std::shared_ptr<Tacky>& src2, AsmCondCode cc);
+  // whether inst only computes an operand of the + - * in next
+  bool defer(const Tacky& inst, const Tacky& next) const;
+  // the tree computing bin, with pending operands folded in
+  std::unique_ptr<TreeMatcher::Node> tree(const TackyBinary& bin);
+  std::unique_ptr<TreeMatcher::Node> tree(const std::shared_ptr<Tacky>& value);
+  // Lowers a compare whose result only feeds the following conditional
+  // jump or select to Cmp + JmpCC|CMovCC, without materializing the 0/1
+  // value.
+  bool fuse_compare(const Tacky& inst, const Tacky& next);
+  std::shared_ptr<Asm> temp();
+  // x / d or x % d for a constant d without idivl. d == 0 is left to trap.
+  bool gen_divide(const TackyBinary& bin, int divisor);
+  // dest = cc ? src1 : src2, once the flags are set
+  void gen_select(AsmCondCode cc, const TackySelect& select);
 
   // returns the size in bytes of stack space needed for function
   std::shared_ptr<Asm> replace_pseudo_regs(Asm* fn);
@@ -37,6 +74,9 @@ public:
   std::shared_ptr<Asm> operator()(const TackyJumpIfZero& jmp);
   std::shared_ptr<Asm> operator()(const TackyJumpIfNotZero& jmp);
   std::shared_ptr<Asm> operator()(const TackyLabel& label);
+  std::shared_ptr<Asm> operator()(const TackySelect& select);
+  std::shared_ptr<Asm> operator()(const TackyJumpTable& table);
+  std::shared_ptr<Asm> operator()(const TackyCount& count);
 };
 }
 
@@ -0,0 +1,80 @@
+#ifndef BLOCKLAYOUT_H
+#define BLOCKLAYOUT_H
+
+#include "AsmCFG.h"
+#include "ast/Asm.h"
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace ccomp {
+// Reorders the basic blocks of one function's final Asm so that the likely
+// successor of every block falls through (Pettis and Hansen). Static branch
+// heuristics weigh the edges. Chains of blocks are grown along the heaviest
+// edges, then placed entry first, each after the chain that jumps to it
+// most. Conditional jumps are inverted and unconditional ones added or
+// dropped to match, and the first block of every loop in the new order is
+// aligned. Ties go to the original order, so the layout is deterministic.
+//
+// With split set, cold blocks, those reached only over unlikely edges, go
+// after the hot ones into .text.unlikely, under the symbol <name>.cold, and
+// every jump between the two parts is explicit.
+class BlockLayout {
+public:
+  BlockLayout(std::vector<std::shared_ptr<Asm>>& instructions,
+              const std::string& name, bool split);
+  void run();
+  // estimated taken branches per call of the function, before and after
+  std::pair<double, double> taken_branches() const;
+  // whether the function has a loop, so it likely runs long
+  bool hot() const;
+  // blocks moved to .text.unlikely
+  int cold_blocks() const;
+
+private:
+  struct Block {
+    std::vector<std::string> labels;
+    // the instructions after the labels, terminator included
+    std::vector<std::shared_ptr<Asm>> body;
+    // the block reached by falling off the end, or -1
+    int fall = -1;
+    std::vector<int> succs;
+    // probability of taking each edge in succs
+    std::vector<double> probs;
+    double freq = 0;
+  };
+  struct Loop {
+    int header;
+    std::vector<bool> contains;
+    int size;
+  };
+
+  std::vector<std::shared_ptr<Asm>>& instructions_;
+  const std::string name_;
+  const bool split_;
+  // of the instructions as they came in
+  const AsmCFG cfg_;
+  std::vector<Block> blocks_;
+  std::vector<Loop> loops_;
+  // innermost loop of every block, or -1
+  std::vector<int> innermost_;
+  std::vector<bool> cold_;
+  std::pair<double, double> taken_ = {0, 0};
+
+  // copies the blocks of cfg_, to be reordered
+  void split();
+  void find_loops();
+  // branch probabilities and block frequencies
+  void weigh();
+  double taken_probability(int block, int taken) const;
+  bool returns_error(int block) const;
+  void classify();
+  std::vector<int> place() const;
+  // with split, no block falls through between the hot and cold parts
+  double taken(const std::vector<int>& order, bool split) const;
+  void emit(const std::vector<int>& order);
+};
+}
+
+#endif // BLOCKLAYOUT_H
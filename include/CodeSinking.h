@@ -0,0 +1,35 @@
+#ifndef CODESINKING_H
+#define CODESINKING_H
+
+#include "TackyCFG.h"
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace ccomp {
+// Moves side-effect-free instructions down to the nearest common dominator
+// of their uses, so that values are only computed on the paths that read
+// them. Instructions never sink into a loop, and divisions that may trap
+// stay where they are.
+class CodeSinking {
+public:
+  explicit CodeSinking(TackyCFG& cfg);
+  bool run();
+
+private:
+  TackyCFG& cfg_;
+  // definitions as (block, index), and the blocks reading each variable,
+  // built once and kept up to date as instructions move
+  std::unordered_map<std::string, std::vector<std::pair<int, int>>> defs_;
+  std::unordered_map<std::string, std::vector<int>> uses_;
+
+  // Returns the block to move instruction `index` of `block` to, or -1.
+  int sink_target(int block, int index) const;
+  // true if some path from `from` leaves the function without passing `to`
+  bool avoids(int from, int to) const;
+  // blocks on some path from `from` to `to`
+  std::vector<bool> between(int from, int to) const;
+};
+}
+
+#endif // CODESINKING_H
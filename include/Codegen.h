@@ -3,22 +3,39 @@
 
 #include "ast/Asm.h"
 #include "ErrorHandler.h"
+#include "Options.h"
+#include "Profile.h"
 #include <memory>
 
 namespace ccomp {
 class Codegen {
 public:
-  Codegen(const Asm* program,
+  Codegen(const Asm* program, const Options& options, const Profile& profile,
           ErrorHandler& errorHandler);
   std::string code();
   virtual ~Codegen() {}
 
 private:
   const Asm* program_;
+  const Options& options_;
+  const Profile& profile_;
   ErrorHandler& errorHandler_;
+  // numbers the jump tables in .rodata
+  int jump_tables_ = 0;
+  // the function being emitted
+  std::string function_;
+  // Its frame: without a frame pointer, stack slots are addressed from
+  // %rsp, which sits rsp_offset_ bytes below the return address.
+  bool frame_pointer_ = true;
+  int rsp_offset_ = 0;
 
   std::string code(std::shared_ptr<Asm> inst);
   std::string code(std::vector<std::shared_ptr<Asm>> insts);
+  static std::string byte_reg(AsmReg reg);
+  static std::string quad_reg(const std::shared_ptr<Asm>& operand);
+  // the counters of a --profile-generate build, and the exit hook writing
+  // them out
+  std::string profile_runtime() const;
 
 public:
   std::string operator()(const AsmProgram& Asm);
@@ -26,14 +43,25 @@ public:
   std::string operator()(const AsmUnary& Asm);
   std::string operator()(const AsmBinary& bin);
   std::string operator()(const AsmCmp& cmp);
+  std::string operator()(const AsmTest& test);
+  std::string operator()(const AsmLea& lea);
+  std::string operator()(const AsmImulImm& imul);
+  std::string operator()(const AsmShift& shift);
+  std::string operator()(const AsmImulHi& imul);
   std::string operator()(const AsmIdiv& idiv);
   std::string operator()(const AsmCdq& cdq);
   std::string operator()(const AsmJmp& jmp);
   std::string operator()(const AsmJmpCC& jmpcc);
   std::string operator()(const AsmSetCC& setcc);
+  std::string operator()(const AsmCMovCC& cmov);
+  std::string operator()(const AsmJumpTable& table);
   std::string operator()(const AsmLabel& label);
+  std::string operator()(const AsmAlign& align);
+  std::string operator()(const AsmSection& section);
+  std::string operator()(const AsmCount& count);
   std::string operator()(const AsmMov& Asm);
   std::string operator()(const AsmAllocateStack& Asm);
+  std::string operator()(const AsmDeallocateStack& Asm);
   std::string operator()(const AsmReturn& Asm);
   std::string operator()(const AsmImm& Asm);
   std::string operator()(const AsmRegister& Asm);
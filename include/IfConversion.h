@@ -0,0 +1,49 @@
+#ifndef IFCONVERSION_H
+#define IFCONVERSION_H
+
+#include "Options.h"
+#include "TackyCFG.h"
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+namespace ccomp {
+// Turns small if/else diamonds and if-then triangles that only assign one
+// variable into straight-line code ending in a Select, which lowers to
+// cmov. Both arms are computed unconditionally, so a conversion is only
+// worth it while the speculated instructions cost less than the
+// `cmov_miss_cost` of a mispredicted branch, scaled down for branches a
+// hint or the profile shows biased.
+class IfConversion {
+public:
+  IfConversion(TackyCFG& cfg, const Options& options);
+  bool run();
+
+private:
+  // An arm of the branch: the instructions to speculate, and the value
+  // the assigned variable ends up with.
+  struct Arm {
+    int block = -1;
+    std::vector<std::shared_ptr<Tacky>> speculated;
+    std::shared_ptr<Tacky> value;
+  };
+
+  TackyCFG& cfg_;
+  const Options& options_;
+  // variables read in some block before it writes them
+  std::unordered_set<std::string> live_in_;
+
+  // Converts every branch that qualifies in one pass over the blocks, then
+  // updates the CFG.
+  bool convert_all();
+  // Checks that `block` computes a single assignment to `var` (or to any
+  // variable if `var` is empty) and can run without its branch.
+  bool safe_arm(int block, const std::string& cond, std::string& var) const;
+  // Renames the final assignment of the arm into a fresh variable.
+  Arm speculate(int block) const;
+  static bool reads_any(const Tacky& inst,
+                        const std::vector<std::shared_ptr<Tacky>>& defs);
+};
+}
+
+#endif // IFCONVERSION_H
@@ -0,0 +1,40 @@
+#ifndef JUMPTHREADING_H
+#define JUMPTHREADING_H
+
+#include "Options.h"
+#include "TackyCFG.h"
+#include <string>
+#include <vector>
+
+namespace ccomp {
+// Threads edges into blocks whose branch outcome is already known on that
+// edge, such as the 0/1 result of && and || tested right after it is
+// materialized. The edge goes straight to the final target, through a copy
+// of the branching block's other instructions if there are at most
+// `thread_max_size` of them.
+class JumpThreading {
+public:
+  JumpThreading(TackyCFG& cfg, const Options& options);
+  bool run();
+
+private:
+  enum class Known { UNKNOWN, ZERO, NONZERO };
+
+  TackyCFG& cfg_;
+  const Options& options_;
+
+  // Threads every edge it can in one pass over the blocks, at most `limit`
+  // of them, then updates the CFG.
+  bool thread_all(size_t& limit);
+  void remove_dead_copies();
+  void forward_empty_blocks();
+  // What `var` holds when control leaves `block` for `succ`, following
+  // single predecessors up to `depth` blocks back. The blocks looked at
+  // are added to `path`.
+  Known known_on_edge(int block, const std::string& succ,
+                      const std::string& var, int depth,
+                      std::vector<int>& path) const;
+};
+}
+
+#endif // JUMPTHREADING_H
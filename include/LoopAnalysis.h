@@ -0,0 +1,44 @@
+#ifndef LOOPANALYSIS_H
+#define LOOPANALYSIS_H
+
+#include "TackyCFG.h"
+#include "Token.h"
+#include <cstdint>
+#include <memory>
+#include <string>
+
+namespace ccomp {
+// A loop whose exit test compares an induction variable against a loop
+// invariant bound: iv REL bound is tested once per iteration in block
+// `exiting`, and iv is advanced by `step` once per iteration.
+struct CountedLoop {
+  int exiting;
+  std::string stay;
+  std::string exit;
+  bool stay_if_true;
+  std::string iv;
+  int step;
+  TokenType rel;
+  std::shared_ptr<Tacky> bound;
+  // iv is advanced before the exit test sees it
+  bool step_before_test;
+  // the compare feeding the exit test, if nothing else reads its result
+  std::shared_ptr<Tacky> compare;
+};
+
+bool find_counted_loop(const TackyCFG& cfg, const TackyLoop& loop,
+                       CountedLoop& counted);
+
+// Finds the constant `var` holds on entry to the loop, following
+// straight-line code back from the loop's only entry edge.
+bool entry_value(const TackyCFG& cfg, const TackyLoop& loop,
+                 const std::string& var, int* value);
+
+int count_uses(const TackyCFG& cfg, const std::string& var);
+
+TokenType swap_relational(TokenType op);
+TokenType negate_relational(TokenType op);
+bool eval_relational(TokenType op, int64_t a, int64_t b);
+}
+
+#endif // LOOPANALYSIS_H
@@ -0,0 +1,49 @@
+#ifndef LOOPUNROLL_H
+#define LOOPUNROLL_H
+
+#include "LoopAnalysis.h"
+#include "Options.h"
+#include "TackyCFG.h"
+#include "Token.h"
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+
+namespace ccomp {
+// Unrolls small innermost counted loops. Loops with a constant trip count
+// are unrolled completely; others get a main loop of `unroll_factor` body
+// copies with a single exit test, followed by the original loop which runs
+// the remaining iterations.
+class LoopUnroll {
+public:
+  LoopUnroll(TackyCFG& cfg, const Options& options);
+  bool run();
+
+private:
+  TackyCFG& cfg_;
+  const Options& options_;
+  std::unordered_set<std::string> done_;
+
+  bool unroll(const TackyLoop& loop);
+  int loop_size(const TackyLoop& loop) const;
+  std::unordered_map<std::string, std::string>
+  fresh_labels(const TackyLoop& loop) const;
+  // Copies the loop body. Back edges go to `next_header`; the exit test
+  // jumps to `exit_to`, or stays in the loop if that is empty.
+  std::vector<TackyBlock> clone(
+    const TackyLoop& loop, const CountedLoop& counted,
+    const std::unordered_map<std::string, std::string>& rename,
+    const std::string& next_header, const std::string& exit_to);
+  // Places `blocks` in front of the loop and sends the loop entry edges to
+  // the first of them.
+  void insert_before(const TackyLoop& loop, std::vector<TackyBlock> blocks,
+                     bool keep_loop);
+
+  bool full_unroll(const TackyLoop& loop, const CountedLoop& counted,
+                   int trip_count);
+  bool partial_unroll(const TackyLoop& loop, const CountedLoop& counted,
+                      int factor);
+};
+}
+
+#endif // LOOPUNROLL_H
@@ -0,0 +1,34 @@
+#ifndef LOOPUNSWITCH_H
+#define LOOPUNSWITCH_H
+
+#include "Options.h"
+#include "TackyCFG.h"
+#include <string>
+#include <vector>
+
+namespace ccomp {
+// Moves branches on loop invariant conditions out of loops. The condition
+// is tested once in front of the loop, which is cloned so that each copy
+// takes one side of the branch unconditionally. Cloning stops once the
+// function has grown by `unswitch_max_growth` instructions.
+class LoopUnswitch {
+public:
+  LoopUnswitch(TackyCFG& cfg, const Options& options);
+  bool run();
+
+private:
+  TackyCFG& cfg_;
+  const Options& options_;
+  int growth_ = 0;
+
+  bool unswitch(const TackyLoop& loop);
+  // Appends the loop instructions computing `var` as read at instruction
+  // `index` of `block`, after the ones they depend on. Fails unless they
+  // only depend on values that do not change in the loop.
+  bool invariant_chain(const TackyLoop& loop, const std::string& var,
+                       int block, int index,
+                       std::vector<std::shared_ptr<Tacky>>& chain) const;
+};
+}
+
+#endif // LOOPUNSWITCH_H
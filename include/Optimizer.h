@@ -0,0 +1,27 @@
+#ifndef OPTIMIZER_H
+#define OPTIMIZER_H
+
+#include "ErrorHandler.h"
+#include "Options.h"
+#include "Profile.h"
+#include "ast/Tacky.h"
+
+namespace ccomp {
+// Runs the Tacky optimization passes over every function of a program.
+class Optimizer {
+public:
+  Optimizer(Tacky* tackycode, const Options& options, Profile& profile,
+            ErrorHandler& errorHandler);
+  void optimize();
+
+private:
+  Tacky* tackycode_;
+  const Options& options_;
+  Profile& profile_;
+  ErrorHandler& errorHandler_;
+
+  void optimize(TackyFunction& fn);
+};
+}
+
+#endif // OPTIMIZER_H
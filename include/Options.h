@@ -0,0 +1,62 @@
+#ifndef OPTIONS_H
+#define OPTIONS_H
+
+#include <string>
+
+namespace ccomp {
+// Knobs for the optimization passes, set from the command line.
+struct Options {
+  // Evaluate the operand that needs more registers first when neither has
+  // side effects. 0 keeps the source order.
+  int eval_order = 1;
+  // Largest loop, in Tacky instructions, the unroller may produce.
+  // 0 disables unrolling.
+  int unroll_max_size = 64;
+  // Number of body copies in a partially unrolled loop.
+  int unroll_factor = 4;
+  // Instructions loop unswitching may add to a function. 0 disables it.
+  int unswitch_max_growth = 128;
+  // Largest block, in Tacky instructions besides its branch, jump threading
+  // may duplicate. -1 disables jump threading.
+  int thread_max_size = 6;
+  // Cost of a mispredicted branch, in Tacky instructions. If-conversion
+  // speculates both arms of a branch while they fit in this budget.
+  // 0 disables if-conversion.
+  int cmov_miss_cost = 10;
+  // Regroup chains of + and * into balanced trees with their constants
+  // folded. 0 disables it.
+  int reassociate = 1;
+  // Registers the allocator may assign to pseudos, at most 7. 0 keeps every
+  // pseudo on the stack.
+  int alloc_regs = 7;
+  // Forward stack slots already held in a register after the spill code is
+  // in place. 0 disables it.
+  int store_forwarding = 1;
+  // Run the peephole rules over the final Asm. 0 disables them.
+  int peephole = 1;
+  // Reorder basic blocks so likely successors fall through, and align
+  // loops. 0 keeps the source order.
+  int block_layout = 1;
+  // With block layout, move cold blocks to .text.unlikely, put functions
+  // with loops in .text.hot and ones a profile never saw called in
+  // .text.unlikely. 0 keeps everything in .text.
+  int hot_cold_split = 1;
+  // Address the stack frame from %rsp and keep no frame pointer; leaf
+  // functions with small frames use the red zone. 0 sets up %rbp.
+  int omit_frame_pointer = 1;
+  // Set up the stack frame only on paths that use it, and let returns share
+  // one epilogue. 0 sets it up at the entry of every function.
+  int shrink_wrap = 1;
+  // Instrument the program to write an edge profile to this file when it
+  // exits. Empty disables it.
+  std::string profile_generate;
+  // Optimize with the edge profile in this file, from a run of a
+  // --profile-generate build. Empty disables it.
+  std::string profile_use;
+  // Print register, stack frame, peephole and layout statistics for every function
+  // to stderr.
+  bool stats = false;
+};
+}
+
+#endif // OPTIONS_H
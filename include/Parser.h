@@ -31,6 +31,9 @@ public:
   std::unique_ptr<Stmt> whileStatement();
   std::unique_ptr<Stmt> doWhileStatement();
   std::unique_ptr<Stmt> forStatement();
+  std::unique_ptr<Stmt> switchStatement();
+  std::unique_ptr<Stmt> caseStatement();
+  std::unique_ptr<Stmt> defaultStatement();
   std::unique_ptr<Stmt> expressionStatement();
   std::unique_ptr<Stmt> returnStatement();
   std::unique_ptr<Expr> expression();
@@ -46,6 +49,7 @@ public:
   std::unique_ptr<Expr> finishCall(std::unique_ptr<Expr> e);
   std::unique_ptr<Expr> unary();
   std::unique_ptr<Expr> primary();
+  std::unique_ptr<Expr> builtinExpect();
   std::vector<std::unique_ptr<Stmt>> parse();
   ParseError error(Token token, std::string message);
 
@@ -0,0 +1,62 @@
+#ifndef PEEPHOLE_H
+#define PEEPHOLE_H
+
+#include "ast/Asm.h"
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace ccomp {
+// Rule-based peephole optimizer over the final Asm of one function. Every
+// rule looks at the window of instructions starting at a position and may
+// rewrite it; the rules are tried at every position until none applies any
+// more. Flags are assumed dead at labels, which holds for AsmGen's output:
+// every flags reader follows its compare in the same block.
+class Peephole {
+public:
+  explicit Peephole(std::vector<std::shared_ptr<Asm>>& instructions);
+  // Runs the rules to a fixed point.
+  void run();
+  // rule name and number of rewrites, in rule order
+  std::vector<std::pair<std::string, int>> hits() const;
+
+private:
+  struct Rule {
+    const char* name;
+    // rewrites the window starting at position i, if it matches
+    bool (Peephole::*apply)(size_t i);
+  };
+  static const std::vector<Rule> kRules;
+
+  std::vector<std::shared_ptr<Asm>>& instructions_;
+  std::vector<int> hits_;
+  // label -> position, and the number of jumps naming it
+  std::unordered_map<std::string, size_t> labels_;
+  std::unordered_map<std::string, int> refs_;
+
+  void index();
+  void replace(size_t i, size_t count,
+               std::vector<std::shared_ptr<Asm>> with);
+  // whether the flags set at i are only read by E and NE
+  bool flags_only_zero(size_t i) const;
+  // whether no instruction from i on reads the flags before they are set
+  bool flags_dead(size_t i) const;
+  // the label at the end of the chain of jumps starting at label
+  std::string final_target(const std::string& label) const;
+
+  bool jump_to_next(size_t i);
+  bool jump_over_jump(size_t i);
+  bool jump_chain(size_t i);
+  bool unreachable(size_t i);
+  bool unused_label(size_t i);
+  bool self_move(size_t i);
+  bool move_back(size_t i);
+  bool zero_setcc(size_t i);
+  bool redundant_test(size_t i);
+  bool superopt(size_t i);
+};
+}
+
+#endif // PEEPHOLE_H
@@ -0,0 +1,71 @@
+#ifndef PROFILE_H
+#define PROFILE_H
+
+#include "Options.h"
+#include "TackyCFG.h"
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace ccomp {
+// Edge profiles for profile-guided optimization.
+//
+// With --profile-generate, every function counts its calls and both edges
+// of each conditional branch in its CFG as TackyGen built it, in a .bss
+// array the program writes out when it exits. With --profile-use, the
+// counts come back as the branch probabilities __builtin_expect also sets,
+// so block layout, hot/cold splitting, unrolling and if-conversion follow
+// the profile. The counts of a function are keyed by a checksum of its CFG,
+// so a profile of code that has changed since is ignored for it.
+//
+// The file holds the magic "ccprof01", then for every function its
+// checksum, number of counters and name length as 64-bit words, the name,
+// and the counters.
+class Profile {
+public:
+  // counters Codegen emits for an instrumented function
+  struct Counters {
+    std::string function;
+    uint64_t checksum;
+    int size;
+  };
+
+  explicit Profile(const Options& options);
+  // Reads the --profile-use file. Warns and returns false if it is missing
+  // or corrupt; functions are then compiled without profile.
+  bool load();
+  // Annotates and instruments the function, as the options ask, before any
+  // pass changes its CFG.
+  void apply(const std::string& name, TackyCFG& cfg);
+  // times the function was called in the profile, or -1 without one
+  int64_t entry_count(const std::string& name) const;
+
+  bool generating() const;
+  const std::vector<Counters>& counters() const;
+  // where the instrumented program writes its profile
+  const std::string& output() const;
+
+  static constexpr char kMagic[] = "ccprof01";
+
+private:
+  struct FunctionCounts {
+    uint64_t checksum;
+    std::vector<uint64_t> counts;
+  };
+
+  const Options& options_;
+  std::unordered_map<std::string, FunctionCounts> loaded_;
+  std::unordered_map<std::string, int64_t> entries_;
+  std::vector<Counters> counters_;
+
+  static uint64_t checksum(const TackyCFG& cfg);
+  // Counter 0 counts calls, and counters 2k+1 and 2k+2 the false and true
+  // edges of the kth conditional branch, in block order.
+  void annotate(const std::string& name, uint64_t sum,
+                const std::vector<int>& branches, TackyCFG& cfg);
+  void instrument(const std::vector<int>& branches, TackyCFG& cfg);
+};
+}
+
+#endif // PROFILE_H
@@ -0,0 +1,60 @@
+#ifndef REASSOCIATE_H
+#define REASSOCIATE_H
+
+#include "Options.h"
+#include "TackyCFG.h"
+#include "Token.h"
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+namespace ccomp {
+// Reassociates chains of + and of * within a block. The parser builds
+// left-deep trees, so a+b+c+d is a serial chain of dependent adds; int
+// addition and multiplication wrap the same in any order, so the chain's
+// operands can be regrouped freely. Constants are folded into one, added
+// or multiplied last, and the variables are sorted by name and combined
+// as a balanced tree, so independent operations can run in parallel.
+//
+// A chain is a Binary whose operands are temporaries, each defined once by
+// a Binary with the same operator earlier in the block and read nowhere
+// else. The variables it reads must not change between its first
+// operation and its last.
+class Reassociate {
+public:
+  Reassociate(TackyCFG& cfg, const Options& options);
+  bool run();
+
+private:
+  struct Chain {
+    TokenType op;
+    // indices of the chain's operations in the block, the root last
+    std::vector<int> ops;
+    // the variables it combines, with the operations reading them
+    std::vector<std::shared_ptr<Tacky>> vars;
+    std::vector<int> readers;
+    std::vector<int> constants;
+  };
+
+  TackyCFG& cfg_;
+  const Options& options_;
+  // temporaries read once, in the block defining them
+  std::unordered_set<std::string> local_;
+
+  bool run(TackyBlock& block);
+  // Collects the chain of block instruction `index` into chain.
+  void collect(const TackyBlock& block, int index,
+               const std::unordered_map<std::string, int>& def_at,
+               Chain& chain) const;
+  // Emits vars[lo, hi) as a balanced tree, depth first, and returns the
+  // value holding the result. The top operation writes dest if it is set.
+  std::shared_ptr<Tacky> balance(TokenType op,
+                                 const std::vector<std::shared_ptr<Tacky>>& vars,
+                                 size_t lo, size_t hi,
+                                 std::shared_ptr<Tacky> dest,
+                                 std::vector<std::shared_ptr<Tacky>>& out) const;
+};
+}
+
+#endif // REASSOCIATE_H
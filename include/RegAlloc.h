@@ -0,0 +1,75 @@
+#ifndef REGALLOC_H
+#define REGALLOC_H
+
+#include "ast/Asm.h"
+#include <memory>
+#include <set>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace ccomp {
+// Graph colouring register allocator (Chaitin-Briggs) for the pseudos of one
+// function. Moves are coalesced conservatively, and AX and DX are
+// precoloured wherever idivl, cdq and the return value need them. Pseudos
+// that do not fit in the first `num_regs` registers are coloured again with
+// stack slots, so spilled values that are never live at the same time share
+// a slot; ReplacePseudo then gives each slot its frame offset.
+class RegAlloc {
+public:
+  struct Stats {
+    int pseudos = 0;
+    int registers = 0;
+    int spilled = 0;
+    int slots = 0;
+  };
+
+  explicit RegAlloc(int num_regs);
+  std::vector<std::shared_ptr<Asm>> allocate(
+    const std::vector<std::shared_ptr<Asm>>& instructions);
+  const Stats& stats() const { return stats_; }
+
+private:
+  // nodes read and written by an instruction
+  struct Access {
+    std::vector<int> uses;
+    std::vector<int> defs;
+    // a Mov between two nodes, which may be coalesced
+    int move_src = -1;
+    int move_dst = -1;
+  };
+
+  int num_regs_;
+  std::vector<std::shared_ptr<Asm>> instructions_;
+  // the hardware registers come first, then one node per pseudo
+  std::unordered_map<std::string, int> pseudo_node_;
+  std::vector<std::string> node_name_;
+  std::vector<int> alias_;
+  std::vector<std::set<int>> adj_;
+  std::vector<std::vector<int>> partners_;
+  // the moves between two nodes, in program order
+  std::vector<std::pair<int, int>> moves_;
+  std::vector<double> cost_;
+  std::vector<int> color_;
+  std::vector<int> slot_;
+  Stats stats_;
+
+  int find(int node) const;
+  int node(const std::shared_ptr<Asm>& operand) const;
+  bool precolored(int node) const;
+  bool allowed(int node) const;
+  Access access(const Asm& inst) const;
+
+  // block liveness, then interference and spill costs, once before
+  // coalescing
+  void build();
+  bool coalesce();
+  void merge(int into, int from);
+  void color();
+  void color_slots();
+  std::shared_ptr<Asm> rewrite(const std::shared_ptr<Asm>& operand) const;
+};
+}
+
+#endif // REGALLOC_H
@@ -21,7 +21,11 @@ private:
   ErrorHandler& errorHandler_;
   FunctionType currentFunction_;
   std::vector<std::unordered_map<std::string, bool>> scopes_;
+  // labels continue can reach (loops), and break can reach (loops and
+  // switches)
   std::vector<int> nested_loop_labels_;
+  std::vector<int> nested_break_labels_;
+  std::vector<Switch*> nested_switches_;
   int loop_label_;
 
 public:
@@ -47,7 +51,11 @@ private:
 
   void beginLoop(int* label);
   void endLoop();
+  void beginSwitch(Switch* stmt);
+  void endSwitch();
   void copyLoopLabel(int* label);
+  // folds an integer constant expression such as a case value
+  bool evaluate(const Expr* expr, long long& value);
 
 public:
   void operator()(const Block& stmt);
@@ -62,12 +70,16 @@ public:
   void operator()(const Null& stmt);
   void operator()(Break& stmt);
   void operator()(Continue& stmt);
+  void operator()(Switch& stmt);
+  void operator()(Case& stmt);
+  void operator()(Default& stmt);
 
   void operator()(const Assign& expr);
   void operator()(const Conditional& expr);
   void operator()(const BinaryExpr& expr);
   void operator()(const LiteralExpr& expr);
   void operator()(const UnaryExpr& expr);
+  void operator()(Expect& expr);
   void operator()(Variable& expr);
 };
 
@@ -0,0 +1,29 @@
+#ifndef SCALAREVOLUTION_H
+#define SCALAREVOLUTION_H
+
+#include "TackyCFG.h"
+#include <string>
+#include <unordered_set>
+
+namespace ccomp {
+// Final value replacement. Finds straight-line innermost counted loops in
+// which every variable live after the loop is a polynomial in the iteration
+// number (counters, x = x + c, sums of arithmetic series, ...), computes
+// their exit values in closed form and deletes the loop. When the trip
+// count is only known at run time the loop is kept as a fallback for
+// iteration spaces too large to count in an int.
+class ScalarEvolution {
+public:
+  explicit ScalarEvolution(TackyCFG& cfg);
+  bool run();
+
+private:
+  TackyCFG& cfg_;
+  std::unordered_set<std::string> done_;
+
+  bool replace(const TackyLoop& loop);
+  bool used_outside(const TackyLoop& loop, const std::string& var) const;
+};
+}
+
+#endif // SCALAREVOLUTION_H
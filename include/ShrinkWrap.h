@@ -0,0 +1,40 @@
+#ifndef SHRINKWRAP_H
+#define SHRINKWRAP_H
+
+#include "AsmCFG.h"
+#include "ast/Asm.h"
+#include <memory>
+#include <vector>
+
+namespace ccomp {
+// Shrink-wraps the stack frame of one function's final Asm. The prologue
+// (AllocateStack) moves from the entry to the block nearest to it that
+// dominates every use of a stack slot and is in no loop, so paths that
+// return early never set up a frame. Returns that cannot be reached from
+// there lose their epilogue (DeallocateStack), and the others jump to one
+// shared epilogue. If some return could be reached both with and without
+// a frame, the prologue stays at the entry.
+class ShrinkWrap {
+public:
+  explicit ShrinkWrap(std::vector<std::shared_ptr<Asm>>& instructions);
+  void run();
+  // whether the prologue left the entry block
+  bool moved() const;
+  // returns that jump to the shared epilogue
+  int merged() const;
+
+private:
+  std::vector<std::shared_ptr<Asm>>& instructions_;
+  // of the instructions as they came in
+  const AsmCFG cfg_;
+  bool moved_ = false;
+  int merged_ = 0;
+
+  // blocks reachable from block over at least one edge
+  std::vector<bool> reachable(int block) const;
+  bool uses_frame(int block) const;
+  void share_epilogue();
+};
+}
+
+#endif // SHRINKWRAP_H
@@ -0,0 +1,32 @@
+#ifndef STOREFORWARDING_H
+#define STOREFORWARDING_H
+
+#include "ast/Asm.h"
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+namespace ccomp {
+// Tracks which register holds a copy of which stack slot while walking a
+// function's final Asm. Reloads of a slot into a register that already
+// holds it, and stores of a register back into the slot it came from, are
+// dropped; other reads of the slot use the register instead. Everything is
+// forgotten at labels, so the pass stays linear.
+class StoreForwarding {
+public:
+  explicit StoreForwarding(std::vector<std::shared_ptr<Asm>>& instructions);
+  // Returns the number of memory accesses removed or rewritten.
+  int run();
+
+private:
+  std::vector<std::shared_ptr<Asm>>& instructions_;
+  // register -> stack offset it mirrors
+  std::unordered_map<int, int> holds_;
+
+  // the register holding the slot `operand`, or operand itself
+  std::shared_ptr<Asm> forward(const std::shared_ptr<Asm>& operand) const;
+  void written(const std::shared_ptr<Asm>& operand);
+};
+}
+
+#endif // STOREFORWARDING_H
@@ -0,0 +1,51 @@
+#ifndef SUPEROPT_H
+#define SUPEROPT_H
+
+#include "Token.h"
+#include "ast/Asm.h"
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace ccomp {
+// A rewrite found by the superoptimizer tool: a short pattern over two
+// distinct registers A and B, and a cheaper replacement leaving the same
+// values in both for every input. Flags may differ.
+struct SuperoptRule {
+  std::vector<std::shared_ptr<Asm>> pattern;
+  std::vector<std::shared_ptr<Asm>> replacement;
+};
+
+// The generated table, include/SuperoptRules.h.
+const std::vector<SuperoptRule>& superopt_rules();
+
+namespace superopt {
+// Pattern registers, AsmPseudo("A") and AsmPseudo("B").
+std::shared_ptr<Asm> reg_a();
+std::shared_ptr<Asm> reg_b();
+std::shared_ptr<Asm> imm(int value);
+
+// builders for the generated table
+std::shared_ptr<Asm> mov(std::shared_ptr<Asm> src, std::shared_ptr<Asm> dest);
+std::shared_ptr<Asm> binary(TokenType op, std::shared_ptr<Asm> src,
+                            std::shared_ptr<Asm> dest);
+std::shared_ptr<Asm> unary(TokenType op, std::shared_ptr<Asm> dest);
+std::shared_ptr<Asm> shift(AsmShiftOp op, int count, std::shared_ptr<Asm> dest);
+std::shared_ptr<Asm> lea(std::shared_ptr<Asm> base, std::shared_ptr<Asm> index,
+                         int scale, int disp, std::shared_ptr<Asm> dest);
+std::shared_ptr<Asm> imul(int value, std::shared_ptr<Asm> src,
+                          std::shared_ptr<Asm> dest);
+
+// Runs seq on registers A = a and B = b. Returns false for instructions
+// the superoptimizer does not model.
+bool run(const std::vector<std::shared_ptr<Asm>>& seq, uint32_t& a,
+         uint32_t& b);
+// rough cycles, as in TreeMatcher: 3 for a multiply, 1 for anything else
+int cost(const std::vector<std::shared_ptr<Asm>>& seq);
+// the builder calls constructing seq, for the generated table
+std::string source(const std::vector<std::shared_ptr<Asm>>& seq);
+}
+}
+
+#endif // SUPEROPT_H
@@ -0,0 +1,1073 @@
+// Generated by superoptimizer. Do not edit.
+#ifndef SUPEROPTRULES_H
+#define SUPEROPTRULES_H
+
+#include "Superopt.h"
+
+namespace ccomp {
+inline std::vector<SuperoptRule> make_superopt_rules() {
+  using namespace superopt;
+  auto A = reg_a();
+  auto B = reg_b();
+  return {
+    {{binary(TokenType::PLUS, imm(0), A)},
+     {}},
+    {{binary(TokenType::MINUS, imm(0), A)},
+     {}},
+    {{binary(TokenType::STAR, imm(0), A)},
+     {mov(imm(0), A)}},
+    {{binary(TokenType::STAR, imm(1), A)},
+     {}},
+    {{binary(TokenType::STAR, imm(-1), A)},
+     {unary(TokenType::MINUS, A)}},
+    {{binary(TokenType::STAR, imm(2), A)},
+     {binary(TokenType::PLUS, A, A)}},
+    {{binary(TokenType::AMPERSAND, A, A)},
+     {}},
+    {{binary(TokenType::AMPERSAND, imm(-1), A)},
+     {}},
+    {{binary(TokenType::CARET, imm(0), A)},
+     {}},
+    {{imul(-1, A, A)},
+     {unary(TokenType::MINUS, A)}},
+    {{imul(2, A, A)},
+     {binary(TokenType::PLUS, A, A)}},
+    {{imul(3, A, A)},
+     {lea(A, A, 2, 0, A)}},
+    {{imul(4, A, A)},
+     {shift(AsmShiftOp::SAL, 2, A)}},
+    {{imul(5, A, A)},
+     {lea(A, A, 4, 0, A)}},
+    {{imul(8, A, A)},
+     {lea(nullptr, A, 8, 0, A)}},
+    {{imul(9, A, A)},
+     {lea(A, A, 8, 0, A)}},
+    {{imul(2, A, B)},
+     {lea(A, A, 1, 0, B)}},
+    {{imul(3, A, B)},
+     {lea(A, A, 2, 0, B)}},
+    {{imul(4, A, B)},
+     {lea(nullptr, A, 4, 0, B)}},
+    {{imul(5, A, B)},
+     {lea(A, A, 4, 0, B)}},
+    {{imul(8, A, B)},
+     {lea(nullptr, A, 8, 0, B)}},
+    {{imul(9, A, B)},
+     {lea(A, A, 8, 0, B)}},
+    {{mov(imm(0), A), binary(TokenType::PLUS, A, A)},
+     {mov(imm(0), A)}},
+    {{mov(imm(0), A), binary(TokenType::PLUS, B, A)},
+     {mov(B, A)}},
+    {{mov(imm(0), A), binary(TokenType::PLUS, imm(1), A)},
+     {mov(imm(1), A)}},
+    {{mov(imm(0), A), binary(TokenType::PLUS, imm(-1), A)},
+     {mov(imm(-1), A)}},
+    {{mov(imm(0), A), binary(TokenType::PLUS, imm(2), A)},
+     {mov(imm(2), A)}},
+    {{mov(imm(0), A), binary(TokenType::MINUS, A, A)},
+     {mov(imm(0), A)}},
+    {{mov(imm(0), A), binary(TokenType::MINUS, imm(1), A)},
+     {mov(imm(-1), A)}},
+    {{mov(imm(0), A), binary(TokenType::MINUS, imm(-1), A)},
+     {mov(imm(1), A)}},
+    {{mov(imm(0), A), binary(TokenType::STAR, A, A)},
+     {mov(imm(0), A)}},
+    {{mov(imm(0), A), binary(TokenType::STAR, B, A)},
+     {mov(imm(0), A)}},
+    {{mov(imm(0), A), binary(TokenType::AMPERSAND, B, A)},
+     {mov(imm(0), A)}},
+    {{mov(imm(0), A), binary(TokenType::AMPERSAND, imm(0), A)},
+     {mov(imm(0), A)}},
+    {{mov(imm(0), A), binary(TokenType::AMPERSAND, imm(1), A)},
+     {mov(imm(0), A)}},
+    {{mov(imm(0), A), binary(TokenType::AMPERSAND, imm(2), A)},
+     {mov(imm(0), A)}},
+    {{mov(imm(0), A), binary(TokenType::CARET, A, A)},
+     {mov(imm(0), A)}},
+    {{mov(imm(0), A), binary(TokenType::CARET, B, A)},
+     {mov(B, A)}},
+    {{mov(imm(0), A), binary(TokenType::CARET, imm(1), A)},
+     {mov(imm(1), A)}},
+    {{mov(imm(0), A), binary(TokenType::CARET, imm(-1), A)},
+     {mov(imm(-1), A)}},
+    {{mov(imm(0), A), binary(TokenType::CARET, imm(2), A)},
+     {mov(imm(2), A)}},
+    {{mov(imm(0), A), unary(TokenType::MINUS, A)},
+     {mov(imm(0), A)}},
+    {{mov(imm(0), A), unary(TokenType::TILDE, A)},
+     {mov(imm(-1), A)}},
+    {{mov(imm(0), A), shift(AsmShiftOp::SAL, 1, A)},
+     {mov(imm(0), A)}},
+    {{mov(imm(0), A), shift(AsmShiftOp::SAL, 2, A)},
+     {mov(imm(0), A)}},
+    {{mov(imm(0), A), shift(AsmShiftOp::SAL, 31, A)},
+     {mov(imm(0), A)}},
+    {{mov(imm(0), A), shift(AsmShiftOp::SAR, 1, A)},
+     {mov(imm(0), A)}},
+    {{mov(imm(0), A), shift(AsmShiftOp::SAR, 2, A)},
+     {mov(imm(0), A)}},
+    {{mov(imm(0), A), shift(AsmShiftOp::SAR, 31, A)},
+     {mov(imm(0), A)}},
+    {{mov(imm(0), A), shift(AsmShiftOp::SHR, 1, A)},
+     {mov(imm(0), A)}},
+    {{mov(imm(0), A), shift(AsmShiftOp::SHR, 2, A)},
+     {mov(imm(0), A)}},
+    {{mov(imm(0), A), shift(AsmShiftOp::SHR, 31, A)},
+     {mov(imm(0), A)}},
+    {{mov(imm(0), A), binary(TokenType::PLUS, A, B)},
+     {mov(imm(0), A)}},
+    {{mov(imm(0), A), binary(TokenType::MINUS, A, B)},
+     {mov(imm(0), A)}},
+    {{mov(imm(0), A), binary(TokenType::STAR, A, B)},
+     {mov(imm(0), A), mov(A, B)}},
+    {{mov(imm(0), A), binary(TokenType::CARET, A, B)},
+     {mov(imm(0), A)}},
+    {{mov(imm(0), A), imul(-1, A, B)},
+     {mov(imm(0), A), mov(A, B)}},
+    {{mov(imm(1), A), binary(TokenType::PLUS, A, A)},
+     {mov(imm(2), A)}},
+    {{mov(imm(1), A), binary(TokenType::PLUS, B, A)},
+     {lea(B, nullptr, 1, 1, A)}},
+    {{mov(imm(1), A), binary(TokenType::PLUS, imm(1), A)},
+     {mov(imm(2), A)}},
+    {{mov(imm(1), A), binary(TokenType::PLUS, imm(-1), A)},
+     {mov(imm(0), A)}},
+    {{mov(imm(1), A), binary(TokenType::MINUS, A, A)},
+     {mov(imm(0), A)}},
+    {{mov(imm(1), A), binary(TokenType::MINUS, imm(1), A)},
+     {mov(imm(0), A)}},
+    {{mov(imm(1), A), binary(TokenType::MINUS, imm(-1), A)},
+     {mov(imm(2), A)}},
+    {{mov(imm(1), A), binary(TokenType::MINUS, imm(2), A)},
+     {mov(imm(-1), A)}},
+    {{mov(imm(1), A), binary(TokenType::STAR, A, A)},
+     {mov(imm(1), A)}},
+    {{mov(imm(1), A), binary(TokenType::STAR, B, A)},
+     {mov(B, A)}},
+    {{mov(imm(1), A), binary(TokenType::AMPERSAND, imm(0), A)},
+     {mov(imm(0), A)}},
+    {{mov(imm(1), A), binary(TokenType::AMPERSAND, imm(1), A)},
+     {mov(imm(1), A)}},
+    {{mov(imm(1), A), binary(TokenType::AMPERSAND, imm(2), A)},
+     {mov(imm(0), A)}},
+    {{mov(imm(1), A), binary(TokenType::CARET, A, A)},
+     {mov(imm(0), A)}},
+    {{mov(imm(1), A), binary(TokenType::CARET, imm(1), A)},
+     {mov(imm(0), A)}},
+    {{mov(imm(1), A), unary(TokenType::MINUS, A)},
+     {mov(imm(-1), A)}},
+    {{mov(imm(1), A), shift(AsmShiftOp::SAL, 1, A)},
+     {mov(imm(2), A)}},
+    {{mov(imm(1), A), shift(AsmShiftOp::SAR, 1, A)},
+     {mov(imm(0), A)}},
+    {{mov(imm(1), A), shift(AsmShiftOp::SAR, 2, A)},
+     {mov(imm(0), A)}},
+    {{mov(imm(1), A), shift(AsmShiftOp::SAR, 31, A)},
+     {mov(imm(0), A)}},
+    {{mov(imm(1), A), shift(AsmShiftOp::SHR, 1, A)},
+     {mov(imm(0), A)}},
+    {{mov(imm(1), A), shift(AsmShiftOp::SHR, 2, A)},
+     {mov(imm(0), A)}},
+    {{mov(imm(1), A), shift(AsmShiftOp::SHR, 31, A)},
+     {mov(imm(0), A)}},
+    {{mov(imm(1), A), binary(TokenType::STAR, A, B)},
+     {mov(imm(1), A)}},
+    {{mov(imm(-1), A), binary(TokenType::PLUS, B, A)},
+     {lea(B, nullptr, 1, -1, A)}},
+    {{mov(imm(-1), A), binary(TokenType::PLUS, imm(1), A)},
+     {mov(imm(0), A)}},
+    {{mov(imm(-1), A), binary(TokenType::PLUS, imm(2), A)},
+     {mov(imm(1), A)}},
+    {{mov(imm(-1), A), binary(TokenType::MINUS, A, A)},
+     {mov(imm(0), A)}},
+    {{mov(imm(-1), A), binary(TokenType::MINUS, imm(-1), A)},
+     {mov(imm(0), A)}},
+    {{mov(imm(-1), A), binary(TokenType::STAR, A, A)},
+     {mov(imm(1), A)}},
+    {{mov(imm(-1), A), binary(TokenType::STAR, B, A)},
+     {mov(B, A), unary(TokenType::MINUS, A)}},
+    {{mov(imm(-1), A), binary(TokenType::AMPERSAND, B, A)},
+     {mov(B, A)}},
+    {{mov(imm(-1), A), binary(TokenType::AMPERSAND, imm(0), A)},
+     {mov(imm(0), A)}},
+    {{mov(imm(-1), A), binary(TokenType::AMPERSAND, imm(1), A)},
+     {mov(imm(1), A)}},
+    {{mov(imm(-1), A), binary(TokenType::AMPERSAND, imm(2), A)},
+     {mov(imm(2), A)}},
+    {{mov(imm(-1), A), binary(TokenType::CARET, A, A)},
+     {mov(imm(0), A)}},
+    {{mov(imm(-1), A), binary(TokenType::CARET, imm(-1), A)},
+     {mov(imm(0), A)}},
+    {{mov(imm(-1), A), unary(TokenType::MINUS, A)},
+     {mov(imm(1), A)}},
+    {{mov(imm(-1), A), unary(TokenType::TILDE, A)},
+     {mov(imm(0), A)}},
+    {{mov(imm(-1), A), shift(AsmShiftOp::SAR, 1, A)},
+     {mov(imm(-1), A)}},
+    {{mov(imm(-1), A), shift(AsmShiftOp::SAR, 2, A)},
+     {mov(imm(-1), A)}},
+    {{mov(imm(-1), A), shift(AsmShiftOp::SAR, 31, A)},
+     {mov(imm(-1), A)}},
+    {{mov(imm(-1), A), shift(AsmShiftOp::SHR, 31, A)},
+     {mov(imm(1), A)}},
+    {{mov(imm(-1), A), binary(TokenType::AMPERSAND, A, B)},
+     {mov(imm(-1), A)}},
+    {{mov(imm(2), A), binary(TokenType::PLUS, imm(-1), A)},
+     {mov(imm(1), A)}},
+    {{mov(imm(2), A), binary(TokenType::MINUS, A, A)},
+     {mov(imm(0), A)}},
+    {{mov(imm(2), A), binary(TokenType::MINUS, imm(1), A)},
+     {mov(imm(1), A)}},
+    {{mov(imm(2), A), binary(TokenType::MINUS, imm(2), A)},
+     {mov(imm(0), A)}},
+    {{mov(imm(2), A), binary(TokenType::STAR, A, A)},
+     {mov(imm(1), A), shift(AsmShiftOp::SAL, 2, A)}},
+    {{mov(imm(2), A), binary(TokenType::STAR, B, A)},
+     {lea(B, B, 1, 0, A)}},
+    {{mov(imm(2), A), binary(TokenType::AMPERSAND, imm(0), A)},
+     {mov(imm(0), A)}},
+    {{mov(imm(2), A), binary(TokenType::AMPERSAND, imm(1), A)},
+     {mov(imm(0), A)}},
+    {{mov(imm(2), A), binary(TokenType::AMPERSAND, imm(2), A)},
+     {mov(imm(2), A)}},
+    {{mov(imm(2), A), binary(TokenType::CARET, A, A)},
+     {mov(imm(0), A)}},
+    {{mov(imm(2), A), binary(TokenType::CARET, imm(2), A)},
+     {mov(imm(0), A)}},
+    {{mov(imm(2), A), shift(AsmShiftOp::SAL, 31, A)},
+     {mov(imm(0), A)}},
+    {{mov(imm(2), A), shift(AsmShiftOp::SAR, 1, A)},
+     {mov(imm(1), A)}},
+    {{mov(imm(2), A), shift(AsmShiftOp::SAR, 2, A)},
+     {mov(imm(0), A)}},
+    {{mov(imm(2), A), shift(AsmShiftOp::SAR, 31, A)},
+     {mov(imm(0), A)}},
+    {{mov(imm(2), A), shift(AsmShiftOp::SHR, 1, A)},
+     {mov(imm(1), A)}},
+    {{mov(imm(2), A), shift(AsmShiftOp::SHR, 2, A)},
+     {mov(imm(0), A)}},
+    {{mov(imm(2), A), shift(AsmShiftOp::SHR, 31, A)},
+     {mov(imm(0), A)}},
+    {{binary(TokenType::PLUS, A, A), binary(TokenType::PLUS, A, A)},
+     {shift(AsmShiftOp::SAL, 2, A)}},
+    {{binary(TokenType::PLUS, A, A), binary(TokenType::PLUS, B, A)},
+     {lea(B, A, 2, 0, A)}},
+    {{binary(TokenType::PLUS, A, A), binary(TokenType::PLUS, imm(1), A)},
+     {lea(A, A, 1, 1, A)}},
+    {{binary(TokenType::PLUS, A, A), binary(TokenType::PLUS, imm(-1), A)},
+     {lea(A, A, 1, -1, A)}},
+    {{binary(TokenType::PLUS, A, A), binary(TokenType::MINUS, A, A)},
+     {mov(imm(0), A)}},
+    {{binary(TokenType::PLUS, A, A), binary(TokenType::MINUS, imm(1), A)},
+     {lea(A, A, 1, -1, A)}},
+    {{binary(TokenType::PLUS, A, A), binary(TokenType::MINUS, imm(-1), A)},
+     {lea(A, A, 1, 1, A)}},
+    {{binary(TokenType::PLUS, A, A), binary(TokenType::AMPERSAND, imm(0), A)},
+     {mov(imm(0), A)}},
+    {{binary(TokenType::PLUS, A, A), binary(TokenType::AMPERSAND, imm(1), A)},
+     {mov(imm(0), A)}},
+    {{binary(TokenType::PLUS, A, A), binary(TokenType::CARET, A, A)},
+     {mov(imm(0), A)}},
+    {{binary(TokenType::PLUS, A, A), binary(TokenType::CARET, imm(1), A)},
+     {lea(A, A, 1, 1, A)}},
+    {{binary(TokenType::PLUS, A, A), shift(AsmShiftOp::SAL, 1, A)},
+     {shift(AsmShiftOp::SAL, 2, A)}},
+    {{binary(TokenType::PLUS, A, A), shift(AsmShiftOp::SAL, 2, A)},
+     {lea(nullptr, A, 8, 0, A)}},
+    {{binary(TokenType::PLUS, A, A), shift(AsmShiftOp::SAL, 31, A)},
+     {mov(imm(0), A)}},
+    {{binary(TokenType::PLUS, imm(1), A), binary(TokenType::PLUS, B, A)},
+     {lea(A, B, 1, 1, A)}},
+    {{binary(TokenType::PLUS, imm(1), A), binary(TokenType::PLUS, imm(1), A)},
+     {binary(TokenType::PLUS, imm(2), A)}},
+    {{binary(TokenType::PLUS, imm(1), A), binary(TokenType::PLUS, imm(-1), A)},
+     {}},
+    {{binary(TokenType::PLUS, imm(1), A), binary(TokenType::MINUS, A, A)},
+     {mov(imm(0), A)}},
+    {{binary(TokenType::PLUS, imm(1), A), binary(TokenType::MINUS, imm(1), A)},
+     {}},
+    {{binary(TokenType::PLUS, imm(1), A), binary(TokenType::MINUS, imm(-1), A)},
+     {binary(TokenType::PLUS, imm(2), A)}},
+    {{binary(TokenType::PLUS, imm(1), A), binary(TokenType::MINUS, imm(2), A)},
+     {binary(TokenType::PLUS, imm(-1), A)}},
+    {{binary(TokenType::PLUS, imm(1), A), binary(TokenType::AMPERSAND, imm(0), A)},
+     {mov(imm(0), A)}},
+    {{binary(TokenType::PLUS, imm(1), A), binary(TokenType::CARET, A, A)},
+     {mov(imm(0), A)}},
+    {{binary(TokenType::PLUS, imm(1), A), unary(TokenType::MINUS, A)},
+     {binary(TokenType::CARET, imm(-1), A)}},
+    {{binary(TokenType::PLUS, imm(-1), A), binary(TokenType::PLUS, B, A)},
+     {lea(A, B, 1, -1, A)}},
+    {{binary(TokenType::PLUS, imm(-1), A), binary(TokenType::PLUS, imm(1), A)},
+     {}},
+    {{binary(TokenType::PLUS, imm(-1), A), binary(TokenType::PLUS, imm(-1), A)},
+     {binary(TokenType::MINUS, imm(2), A)}},
+    {{binary(TokenType::PLUS, imm(-1), A), binary(TokenType::PLUS, imm(2), A)},
+     {binary(TokenType::PLUS, imm(1), A)}},
+    {{binary(TokenType::PLUS, imm(-1), A), binary(TokenType::MINUS, A, A)},
+     {mov(imm(0), A)}},
+    {{binary(TokenType::PLUS, imm(-1), A), binary(TokenType::MINUS, imm(1), A)},
+     {binary(TokenType::MINUS, imm(2), A)}},
+    {{binary(TokenType::PLUS, imm(-1), A), binary(TokenType::MINUS, imm(-1), A)},
+     {}},
+    {{binary(TokenType::PLUS, imm(-1), A), binary(TokenType::AMPERSAND, imm(0), A)},
+     {mov(imm(0), A)}},
+    {{binary(TokenType::PLUS, imm(-1), A), binary(TokenType::CARET, A, A)},
+     {mov(imm(0), A)}},
+    {{binary(TokenType::PLUS, imm(-1), A), binary(TokenType::CARET, imm(-1), A)},
+     {unary(TokenType::MINUS, A)}},
+    {{binary(TokenType::PLUS, imm(-1), A), unary(TokenType::TILDE, A)},
+     {unary(TokenType::MINUS, A)}},
+    {{binary(TokenType::PLUS, imm(2), A), binary(TokenType::PLUS, imm(-1), A)},
+     {binary(TokenType::PLUS, imm(1), A)}},
+    {{binary(TokenType::PLUS, imm(2), A), binary(TokenType::MINUS, A, A)},
+     {mov(imm(0), A)}},
+    {{binary(TokenType::PLUS, imm(2), A), binary(TokenType::MINUS, imm(1), A)},
+     {binary(TokenType::PLUS, imm(1), A)}},
+    {{binary(TokenType::PLUS, imm(2), A), binary(TokenType::MINUS, imm(2), A)},
+     {}},
+    {{binary(TokenType::PLUS, imm(2), A), binary(TokenType::AMPERSAND, imm(0), A)},
+     {mov(imm(0), A)}},
+    {{binary(TokenType::PLUS, imm(2), A), binary(TokenType::AMPERSAND, imm(1), A)},
+     {binary(TokenType::AMPERSAND, imm(1), A)}},
+    {{binary(TokenType::PLUS, imm(2), A), binary(TokenType::CARET, A, A)},
+     {mov(imm(0), A)}},
+    {{binary(TokenType::PLUS, imm(2), A), shift(AsmShiftOp::SAL, 31, A)},
+     {shift(AsmShiftOp::SAL, 31, A)}},
+    {{binary(TokenType::MINUS, A, A), binary(TokenType::PLUS, A, A)},
+     {mov(imm(0), A)}},
+    {{binary(TokenType::MINUS, A, A), binary(TokenType::PLUS, B, A)},
+     {mov(B, A)}},
+    {{binary(TokenType::MINUS, A, A), binary(TokenType::PLUS, imm(1), A)},
+     {mov(imm(1), A)}},
+    {{binary(TokenType::MINUS, A, A), binary(TokenType::PLUS, imm(-1), A)},
+     {mov(imm(-1), A)}},
+    {{binary(TokenType::MINUS, A, A), binary(TokenType::PLUS, imm(2), A)},
+     {mov(imm(2), A)}},
+    {{binary(TokenType::MINUS, A, A), binary(TokenType::MINUS, A, A)},
+     {mov(imm(0), A)}},
+    {{binary(TokenType::MINUS, A, A), binary(TokenType::MINUS, imm(1), A)},
+     {mov(imm(-1), A)}},
+    {{binary(TokenType::MINUS, A, A), binary(TokenType::MINUS, imm(-1), A)},
+     {mov(imm(1), A)}},
+    {{binary(TokenType::MINUS, A, A), binary(TokenType::STAR, A, A)},
+     {mov(imm(0), A)}},
+    {{binary(TokenType::MINUS, A, A), binary(TokenType::STAR, B, A)},
+     {mov(imm(0), A)}},
+    {{binary(TokenType::MINUS, A, A), binary(TokenType::AMPERSAND, B, A)},
+     {mov(imm(0), A)}},
+    {{binary(TokenType::MINUS, A, A), binary(TokenType::AMPERSAND, imm(0), A)},
+     {mov(imm(0), A)}},
+    {{binary(TokenType::MINUS, A, A), binary(TokenType::AMPERSAND, imm(1), A)},
+     {mov(imm(0), A)}},
+    {{binary(TokenType::MINUS, A, A), binary(TokenType::AMPERSAND, imm(2), A)},
+     {mov(imm(0), A)}},
+    {{binary(TokenType::MINUS, A, A), binary(TokenType::CARET, A, A)},
+     {mov(imm(0), A)}},
+    {{binary(TokenType::MINUS, A, A), binary(TokenType::CARET, B, A)},
+     {mov(B, A)}},
+    {{binary(TokenType::MINUS, A, A), binary(TokenType::CARET, imm(1), A)},
+     {mov(imm(1), A)}},
+    {{binary(TokenType::MINUS, A, A), binary(TokenType::CARET, imm(-1), A)},
+     {mov(imm(-1), A)}},
+    {{binary(TokenType::MINUS, A, A), binary(TokenType::CARET, imm(2), A)},
+     {mov(imm(2), A)}},
+    {{binary(TokenType::MINUS, A, A), unary(TokenType::MINUS, A)},
+     {mov(imm(0), A)}},
+    {{binary(TokenType::MINUS, A, A), unary(TokenType::TILDE, A)},
+     {mov(imm(-1), A)}},
+    {{binary(TokenType::MINUS, A, A), shift(AsmShiftOp::SAL, 1, A)},
+     {mov(imm(0), A)}},
+    {{binary(TokenType::MINUS, A, A), shift(AsmShiftOp::SAL, 2, A)},
+     {mov(imm(0), A)}},
+    {{binary(TokenType::MINUS, A, A), shift(AsmShiftOp::SAL, 31, A)},
+     {mov(imm(0), A)}},
+    {{binary(TokenType::MINUS, A, A), shift(AsmShiftOp::SAR, 1, A)},
+     {mov(imm(0), A)}},
+    {{binary(TokenType::MINUS, A, A), shift(AsmShiftOp::SAR, 2, A)},
+     {mov(imm(0), A)}},
+    {{binary(TokenType::MINUS, A, A), shift(AsmShiftOp::SAR, 31, A)},
+     {mov(imm(0), A)}},
+    {{binary(TokenType::MINUS, A, A), shift(AsmShiftOp::SHR, 1, A)},
+     {mov(imm(0), A)}},
+    {{binary(TokenType::MINUS, A, A), shift(AsmShiftOp::SHR, 2, A)},
+     {mov(imm(0), A)}},
+    {{binary(TokenType::MINUS, A, A), shift(AsmShiftOp::SHR, 31, A)},
+     {mov(imm(0), A)}},
+    {{binary(TokenType::MINUS, A, A), binary(TokenType::PLUS, A, B)},
+     {mov(imm(0), A)}},
+    {{binary(TokenType::MINUS, A, A), binary(TokenType::MINUS, A, B)},
+     {mov(imm(0), A)}},
+    {{binary(TokenType::MINUS, A, A), binary(TokenType::STAR, A, B)},
+     {mov(imm(0), A), mov(A, B)}},
+    {{binary(TokenType::MINUS, A, A), binary(TokenType::CARET, A, B)},
+     {mov(imm(0), A)}},
+    {{binary(TokenType::MINUS, A, A), imul(-1, A, B)},
+     {mov(imm(0), A), mov(A, B)}},
+    {{binary(TokenType::MINUS, imm(1), A), binary(TokenType::PLUS, B, A)},
+     {lea(A, B, 1, -1, A)}},
+    {{binary(TokenType::MINUS, imm(1), A), binary(TokenType::PLUS, imm(1), A)},
+     {}},
+    {{binary(TokenType::MINUS, imm(1), A), binary(TokenType::PLUS, imm(-1), A)},
+     {binary(TokenType::MINUS, imm(2), A)}},
+    {{binary(TokenType::MINUS, imm(1), A), binary(TokenType::PLUS, imm(2), A)},
+     {binary(TokenType::PLUS, imm(1), A)}},
+    {{binary(TokenType::MINUS, imm(1), A), binary(TokenType::MINUS, A, A)},
+     {mov(imm(0), A)}},
+    {{binary(TokenType::MINUS, imm(1), A), binary(TokenType::MINUS, imm(1), A)},
+     {binary(TokenType::MINUS, imm(2), A)}},
+    {{binary(TokenType::MINUS, imm(1), A), binary(TokenType::MINUS, imm(-1), A)},
+     {}},
+    {{binary(TokenType::MINUS, imm(1), A), binary(TokenType::AMPERSAND, imm(0), A)},
+     {mov(imm(0), A)}},
+    {{binary(TokenType::MINUS, imm(1), A), binary(TokenType::CARET, A, A)},
+     {mov(imm(0), A)}},
+    {{binary(TokenType::MINUS, imm(1), A), binary(TokenType::CARET, imm(-1), A)},
+     {unary(TokenType::MINUS, A)}},
+    {{binary(TokenType::MINUS, imm(1), A), unary(TokenType::TILDE, A)},
+     {unary(TokenType::MINUS, A)}},
+    {{binary(TokenType::MINUS, imm(-1), A), binary(TokenType::PLUS, B, A)},
+     {lea(A, B, 1, 1, A)}},
+    {{binary(TokenType::MINUS, imm(-1), A), binary(TokenType::PLUS, imm(1), A)},
+     {binary(TokenType::PLUS, imm(2), A)}},
+    {{binary(TokenType::MINUS, imm(-1), A), binary(TokenType::PLUS, imm(-1), A)},
+     {}},
+    {{binary(TokenType::MINUS, imm(-1), A), binary(TokenType::MINUS, A, A)},
+     {mov(imm(0), A)}},
+    {{binary(TokenType::MINUS, imm(-1), A), binary(TokenType::MINUS, imm(1), A)},
+     {}},
+    {{binary(TokenType::MINUS, imm(-1), A), binary(TokenType::MINUS, imm(-1), A)},
+     {binary(TokenType::PLUS, imm(2), A)}},
+    {{binary(TokenType::MINUS, imm(-1), A), binary(TokenType::MINUS, imm(2), A)},
+     {binary(TokenType::PLUS, imm(-1), A)}},
+    {{binary(TokenType::MINUS, imm(-1), A), binary(TokenType::AMPERSAND, imm(0), A)},
+     {mov(imm(0), A)}},
+    {{binary(TokenType::MINUS, imm(-1), A), binary(TokenType::CARET, A, A)},
+     {mov(imm(0), A)}},
+    {{binary(TokenType::MINUS, imm(-1), A), unary(TokenType::MINUS, A)},
+     {binary(TokenType::CARET, imm(-1), A)}},
+    {{binary(TokenType::MINUS, imm(2), A), binary(TokenType::PLUS, imm(1), A)},
+     {binary(TokenType::PLUS, imm(-1), A)}},
+    {{binary(TokenType::MINUS, imm(2), A), binary(TokenType::PLUS, imm(2), A)},
+     {}},
+    {{binary(TokenType::MINUS, imm(2), A), binary(TokenType::MINUS, A, A)},
+     {mov(imm(0), A)}},
+    {{binary(TokenType::MINUS, imm(2), A), binary(TokenType::MINUS, imm(-1), A)},
+     {binary(TokenType::PLUS, imm(-1), A)}},
+    {{binary(TokenType::MINUS, imm(2), A), binary(TokenType::AMPERSAND, imm(0), A)},
+     {mov(imm(0), A)}},
+    {{binary(TokenType::MINUS, imm(2), A), binary(TokenType::AMPERSAND, imm(1), A)},
+     {binary(TokenType::AMPERSAND, imm(1), A)}},
+    {{binary(TokenType::MINUS, imm(2), A), binary(TokenType::CARET, A, A)},
+     {mov(imm(0), A)}},
+    {{binary(TokenType::MINUS, imm(2), A), shift(AsmShiftOp::SAL, 31, A)},
+     {shift(AsmShiftOp::SAL, 31, A)}},
+    {{binary(TokenType::STAR, A, A), binary(TokenType::MINUS, A, A)},
+     {mov(imm(0), A)}},
+    {{binary(TokenType::STAR, A, A), binary(TokenType::AMPERSAND, imm(0), A)},
+     {mov(imm(0), A)}},
+    {{binary(TokenType::STAR, A, A), binary(TokenType::AMPERSAND, imm(1), A)},
+     {binary(TokenType::AMPERSAND, imm(1), A)}},
+    {{binary(TokenType::STAR, A, A), binary(TokenType::AMPERSAND, imm(2), A)},
+     {mov(imm(0), A)}},
+    {{binary(TokenType::STAR, A, A), binary(TokenType::CARET, A, A)},
+     {mov(imm(0), A)}},
+    {{binary(TokenType::STAR, A, A), shift(AsmShiftOp::SAL, 31, A)},
+     {shift(AsmShiftOp::SAL, 31, A)}},
+    {{binary(TokenType::AMPERSAND, imm(0), A), binary(TokenType::PLUS, A, A)},
+     {mov(imm(0), A)}},
+    {{binary(TokenType::AMPERSAND, imm(0), A), binary(TokenType::PLUS, B, A)},
+     {mov(B, A)}},
+    {{binary(TokenType::AMPERSAND, imm(0), A), binary(TokenType::PLUS, imm(1), A)},
+     {mov(imm(1), A)}},
+    {{binary(TokenType::AMPERSAND, imm(0), A), binary(TokenType::PLUS, imm(-1), A)},
+     {mov(imm(-1), A)}},
+    {{binary(TokenType::AMPERSAND, imm(0), A), binary(TokenType::PLUS, imm(2), A)},
+     {mov(imm(2), A)}},
+    {{binary(TokenType::AMPERSAND, imm(0), A), binary(TokenType::MINUS, A, A)},
+     {mov(imm(0), A)}},
+    {{binary(TokenType::AMPERSAND, imm(0), A), binary(TokenType::MINUS, imm(1), A)},
+     {mov(imm(-1), A)}},
+    {{binary(TokenType::AMPERSAND, imm(0), A), binary(TokenType::MINUS, imm(-1), A)},
+     {mov(imm(1), A)}},
+    {{binary(TokenType::AMPERSAND, imm(0), A), binary(TokenType::STAR, A, A)},
+     {mov(imm(0), A)}},
+    {{binary(TokenType::AMPERSAND, imm(0), A), binary(TokenType::STAR, B, A)},
+     {mov(imm(0), A)}},
+    {{binary(TokenType::AMPERSAND, imm(0), A), binary(TokenType::AMPERSAND, B, A)},
+     {mov(imm(0), A)}},
+    {{binary(TokenType::AMPERSAND, imm(0), A), binary(TokenType::AMPERSAND, imm(0), A)},
+     {mov(imm(0), A)}},
+    {{binary(TokenType::AMPERSAND, imm(0), A), binary(TokenType::AMPERSAND, imm(1), A)},
+     {mov(imm(0), A)}},
+    {{binary(TokenType::AMPERSAND, imm(0), A), binary(TokenType::AMPERSAND, imm(2), A)},
+     {mov(imm(0), A)}},
+    {{binary(TokenType::AMPERSAND, imm(0), A), binary(TokenType::CARET, A, A)},
+     {mov(imm(0), A)}},
+    {{binary(TokenType::AMPERSAND, imm(0), A), binary(TokenType::CARET, B, A)},
+     {mov(B, A)}},
+    {{binary(TokenType::AMPERSAND, imm(0), A), binary(TokenType::CARET, imm(1), A)},
+     {mov(imm(1), A)}},
+    {{binary(TokenType::AMPERSAND, imm(0), A), binary(TokenType::CARET, imm(-1), A)},
+     {mov(imm(-1), A)}},
+    {{binary(TokenType::AMPERSAND, imm(0), A), binary(TokenType::CARET, imm(2), A)},
+     {mov(imm(2), A)}},
+    {{binary(TokenType::AMPERSAND, imm(0), A), unary(TokenType::MINUS, A)},
+     {mov(imm(0), A)}},
+    {{binary(TokenType::AMPERSAND, imm(0), A), unary(TokenType::TILDE, A)},
+     {mov(imm(-1), A)}},
+    {{binary(TokenType::AMPERSAND, imm(0), A), shift(AsmShiftOp::SAL, 1, A)},
+     {mov(imm(0), A)}},
+    {{binary(TokenType::AMPERSAND, imm(0), A), shift(AsmShiftOp::SAL, 2, A)},
+     {mov(imm(0), A)}},
+    {{binary(TokenType::AMPERSAND, imm(0), A), shift(AsmShiftOp::SAL, 31, A)},
+     {mov(imm(0), A)}},
+    {{binary(TokenType::AMPERSAND, imm(0), A), shift(AsmShiftOp::SAR, 1, A)},
+     {mov(imm(0), A)}},
+    {{binary(TokenType::AMPERSAND, imm(0), A), shift(AsmShiftOp::SAR, 2, A)},
+     {mov(imm(0), A)}},
+    {{binary(TokenType::AMPERSAND, imm(0), A), shift(AsmShiftOp::SAR, 31, A)},
+     {mov(imm(0), A)}},
+    {{binary(TokenType::AMPERSAND, imm(0), A), shift(AsmShiftOp::SHR, 1, A)},
+     {mov(imm(0), A)}},
+    {{binary(TokenType::AMPERSAND, imm(0), A), shift(AsmShiftOp::SHR, 2, A)},
+     {mov(imm(0), A)}},
+    {{binary(TokenType::AMPERSAND, imm(0), A), shift(AsmShiftOp::SHR, 31, A)},
+     {mov(imm(0), A)}},
+    {{binary(TokenType::AMPERSAND, imm(0), A), binary(TokenType::PLUS, A, B)},
+     {mov(imm(0), A)}},
+    {{binary(TokenType::AMPERSAND, imm(0), A), binary(TokenType::MINUS, A, B)},
+     {mov(imm(0), A)}},
+    {{binary(TokenType::AMPERSAND, imm(0), A), binary(TokenType::STAR, A, B)},
+     {mov(imm(0), A), mov(A, B)}},
+    {{binary(TokenType::AMPERSAND, imm(0), A), binary(TokenType::CARET, A, B)},
+     {mov(imm(0), A)}},
+    {{binary(TokenType::AMPERSAND, imm(0), A), imul(-1, A, B)},
+     {mov(imm(0), A), mov(A, B)}},
+    {{binary(TokenType::AMPERSAND, imm(1), A), binary(TokenType::MINUS, A, A)},
+     {mov(imm(0), A)}},
+    {{binary(TokenType::AMPERSAND, imm(1), A), binary(TokenType::STAR, A, A)},
+     {binary(TokenType::AMPERSAND, imm(1), A)}},
+    {{binary(TokenType::AMPERSAND, imm(1), A), binary(TokenType::AMPERSAND, imm(0), A)},
+     {mov(imm(0), A)}},
+    {{binary(TokenType::AMPERSAND, imm(1), A), binary(TokenType::AMPERSAND, imm(1), A)},
+     {binary(TokenType::AMPERSAND, imm(1), A)}},
+    {{binary(TokenType::AMPERSAND, imm(1), A), binary(TokenType::AMPERSAND, imm(2), A)},
+     {mov(imm(0), A)}},
+    {{binary(TokenType::AMPERSAND, imm(1), A), binary(TokenType::CARET, A, A)},
+     {mov(imm(0), A)}},
+    {{binary(TokenType::AMPERSAND, imm(1), A), shift(AsmShiftOp::SAL, 31, A)},
+     {shift(AsmShiftOp::SAL, 31, A)}},
+    {{binary(TokenType::AMPERSAND, imm(1), A), shift(AsmShiftOp::SAR, 1, A)},
+     {mov(imm(0), A)}},
+    {{binary(TokenType::AMPERSAND, imm(1), A), shift(AsmShiftOp::SAR, 2, A)},
+     {mov(imm(0), A)}},
+    {{binary(TokenType::AMPERSAND, imm(1), A), shift(AsmShiftOp::SAR, 31, A)},
+     {mov(imm(0), A)}},
+    {{binary(TokenType::AMPERSAND, imm(1), A), shift(AsmShiftOp::SHR, 1, A)},
+     {mov(imm(0), A)}},
+    {{binary(TokenType::AMPERSAND, imm(1), A), shift(AsmShiftOp::SHR, 2, A)},
+     {mov(imm(0), A)}},
+    {{binary(TokenType::AMPERSAND, imm(1), A), shift(AsmShiftOp::SHR, 31, A)},
+     {mov(imm(0), A)}},
+    {{binary(TokenType::AMPERSAND, imm(2), A), binary(TokenType::MINUS, A, A)},
+     {mov(imm(0), A)}},
+    {{binary(TokenType::AMPERSAND, imm(2), A), binary(TokenType::STAR, A, A)},
+     {binary(TokenType::AMPERSAND, imm(2), A), binary(TokenType::PLUS, A, A)}},
+    {{binary(TokenType::AMPERSAND, imm(2), A), binary(TokenType::AMPERSAND, imm(0), A)},
+     {mov(imm(0), A)}},
+    {{binary(TokenType::AMPERSAND, imm(2), A), binary(TokenType::AMPERSAND, imm(1), A)},
+     {mov(imm(0), A)}},
+    {{binary(TokenType::AMPERSAND, imm(2), A), binary(TokenType::AMPERSAND, imm(2), A)},
+     {binary(TokenType::AMPERSAND, imm(2), A)}},
+    {{binary(TokenType::AMPERSAND, imm(2), A), binary(TokenType::CARET, A, A)},
+     {mov(imm(0), A)}},
+    {{binary(TokenType::AMPERSAND, imm(2), A), shift(AsmShiftOp::SAL, 31, A)},
+     {mov(imm(0), A)}},
+    {{binary(TokenType::AMPERSAND, imm(2), A), shift(AsmShiftOp::SAR, 2, A)},
+     {mov(imm(0), A)}},
+    {{binary(TokenType::AMPERSAND, imm(2), A), shift(AsmShiftOp::SAR, 31, A)},
+     {mov(imm(0), A)}},
+    {{binary(TokenType::AMPERSAND, imm(2), A), shift(AsmShiftOp::SHR, 2, A)},
+     {mov(imm(0), A)}},
+    {{binary(TokenType::AMPERSAND, imm(2), A), shift(AsmShiftOp::SHR, 31, A)},
+     {mov(imm(0), A)}},
+    {{binary(TokenType::CARET, A, A), binary(TokenType::PLUS, A, A)},
+     {mov(imm(0), A)}},
+    {{binary(TokenType::CARET, A, A), binary(TokenType::PLUS, B, A)},
+     {mov(B, A)}},
+    {{binary(TokenType::CARET, A, A), binary(TokenType::PLUS, imm(1), A)},
+     {mov(imm(1), A)}},
+    {{binary(TokenType::CARET, A, A), binary(TokenType::PLUS, imm(-1), A)},
+     {mov(imm(-1), A)}},
+    {{binary(TokenType::CARET, A, A), binary(TokenType::PLUS, imm(2), A)},
+     {mov(imm(2), A)}},
+    {{binary(TokenType::CARET, A, A), binary(TokenType::MINUS, A, A)},
+     {mov(imm(0), A)}},
+    {{binary(TokenType::CARET, A, A), binary(TokenType::MINUS, imm(1), A)},
+     {mov(imm(-1), A)}},
+    {{binary(TokenType::CARET, A, A), binary(TokenType::MINUS, imm(-1), A)},
+     {mov(imm(1), A)}},
+    {{binary(TokenType::CARET, A, A), binary(TokenType::STAR, A, A)},
+     {mov(imm(0), A)}},
+    {{binary(TokenType::CARET, A, A), binary(TokenType::STAR, B, A)},
+     {mov(imm(0), A)}},
+    {{binary(TokenType::CARET, A, A), binary(TokenType::AMPERSAND, B, A)},
+     {mov(imm(0), A)}},
+    {{binary(TokenType::CARET, A, A), binary(TokenType::AMPERSAND, imm(0), A)},
+     {mov(imm(0), A)}},
+    {{binary(TokenType::CARET, A, A), binary(TokenType::AMPERSAND, imm(1), A)},
+     {mov(imm(0), A)}},
+    {{binary(TokenType::CARET, A, A), binary(TokenType::AMPERSAND, imm(2), A)},
+     {mov(imm(0), A)}},
+    {{binary(TokenType::CARET, A, A), binary(TokenType::CARET, A, A)},
+     {mov(imm(0), A)}},
+    {{binary(TokenType::CARET, A, A), binary(TokenType::CARET, B, A)},
+     {mov(B, A)}},
+    {{binary(TokenType::CARET, A, A), binary(TokenType::CARET, imm(1), A)},
+     {mov(imm(1), A)}},
+    {{binary(TokenType::CARET, A, A), binary(TokenType::CARET, imm(-1), A)},
+     {mov(imm(-1), A)}},
+    {{binary(TokenType::CARET, A, A), binary(TokenType::CARET, imm(2), A)},
+     {mov(imm(2), A)}},
+    {{binary(TokenType::CARET, A, A), unary(TokenType::MINUS, A)},
+     {mov(imm(0), A)}},
+    {{binary(TokenType::CARET, A, A), unary(TokenType::TILDE, A)},
+     {mov(imm(-1), A)}},
+    {{binary(TokenType::CARET, A, A), shift(AsmShiftOp::SAL, 1, A)},
+     {mov(imm(0), A)}},
+    {{binary(TokenType::CARET, A, A), shift(AsmShiftOp::SAL, 2, A)},
+     {mov(imm(0), A)}},
+    {{binary(TokenType::CARET, A, A), shift(AsmShiftOp::SAL, 31, A)},
+     {mov(imm(0), A)}},
+    {{binary(TokenType::CARET, A, A), shift(AsmShiftOp::SAR, 1, A)},
+     {mov(imm(0), A)}},
+    {{binary(TokenType::CARET, A, A), shift(AsmShiftOp::SAR, 2, A)},
+     {mov(imm(0), A)}},
+    {{binary(TokenType::CARET, A, A), shift(AsmShiftOp::SAR, 31, A)},
+     {mov(imm(0), A)}},
+    {{binary(TokenType::CARET, A, A), shift(AsmShiftOp::SHR, 1, A)},
+     {mov(imm(0), A)}},
+    {{binary(TokenType::CARET, A, A), shift(AsmShiftOp::SHR, 2, A)},
+     {mov(imm(0), A)}},
+    {{binary(TokenType::CARET, A, A), shift(AsmShiftOp::SHR, 31, A)},
+     {mov(imm(0), A)}},
+    {{binary(TokenType::CARET, A, A), binary(TokenType::PLUS, A, B)},
+     {mov(imm(0), A)}},
+    {{binary(TokenType::CARET, A, A), binary(TokenType::MINUS, A, B)},
+     {mov(imm(0), A)}},
+    {{binary(TokenType::CARET, A, A), binary(TokenType::STAR, A, B)},
+     {mov(imm(0), A), mov(A, B)}},
+    {{binary(TokenType::CARET, A, A), binary(TokenType::CARET, A, B)},
+     {mov(imm(0), A)}},
+    {{binary(TokenType::CARET, A, A), imul(-1, A, B)},
+     {mov(imm(0), A), mov(A, B)}},
+    {{binary(TokenType::CARET, imm(1), A), binary(TokenType::MINUS, A, A)},
+     {mov(imm(0), A)}},
+    {{binary(TokenType::CARET, imm(1), A), binary(TokenType::AMPERSAND, imm(0), A)},
+     {mov(imm(0), A)}},
+    {{binary(TokenType::CARET, imm(1), A), binary(TokenType::AMPERSAND, imm(2), A)},
+     {binary(TokenType::AMPERSAND, imm(2), A)}},
+    {{binary(TokenType::CARET, imm(1), A), binary(TokenType::CARET, A, A)},
+     {mov(imm(0), A)}},
+    {{binary(TokenType::CARET, imm(1), A), binary(TokenType::CARET, imm(1), A)},
+     {}},
+    {{binary(TokenType::CARET, imm(1), A), shift(AsmShiftOp::SAR, 1, A)},
+     {shift(AsmShiftOp::SAR, 1, A)}},
+    {{binary(TokenType::CARET, imm(1), A), shift(AsmShiftOp::SAR, 2, A)},
+     {shift(AsmShiftOp::SAR, 2, A)}},
+    {{binary(TokenType::CARET, imm(1), A), shift(AsmShiftOp::SAR, 31, A)},
+     {shift(AsmShiftOp::SAR, 31, A)}},
+    {{binary(TokenType::CARET, imm(1), A), shift(AsmShiftOp::SHR, 1, A)},
+     {shift(AsmShiftOp::SHR, 1, A)}},
+    {{binary(TokenType::CARET, imm(1), A), shift(AsmShiftOp::SHR, 2, A)},
+     {shift(AsmShiftOp::SHR, 2, A)}},
+    {{binary(TokenType::CARET, imm(1), A), shift(AsmShiftOp::SHR, 31, A)},
+     {shift(AsmShiftOp::SHR, 31, A)}},
+    {{binary(TokenType::CARET, imm(-1), A), binary(TokenType::PLUS, imm(1), A)},
+     {unary(TokenType::MINUS, A)}},
+    {{binary(TokenType::CARET, imm(-1), A), binary(TokenType::MINUS, A, A)},
+     {mov(imm(0), A)}},
+    {{binary(TokenType::CARET, imm(-1), A), binary(TokenType::MINUS, imm(-1), A)},
+     {unary(TokenType::MINUS, A)}},
+    {{binary(TokenType::CARET, imm(-1), A), binary(TokenType::AMPERSAND, imm(0), A)},
+     {mov(imm(0), A)}},
+    {{binary(TokenType::CARET, imm(-1), A), binary(TokenType::CARET, A, A)},
+     {mov(imm(0), A)}},
+    {{binary(TokenType::CARET, imm(-1), A), binary(TokenType::CARET, imm(-1), A)},
+     {}},
+    {{binary(TokenType::CARET, imm(-1), A), unary(TokenType::MINUS, A)},
+     {binary(TokenType::PLUS, imm(1), A)}},
+    {{binary(TokenType::CARET, imm(-1), A), unary(TokenType::TILDE, A)},
+     {}},
+    {{binary(TokenType::CARET, imm(2), A), binary(TokenType::MINUS, A, A)},
+     {mov(imm(0), A)}},
+    {{binary(TokenType::CARET, imm(2), A), binary(TokenType::AMPERSAND, imm(0), A)},
+     {mov(imm(0), A)}},
+    {{binary(TokenType::CARET, imm(2), A), binary(TokenType::AMPERSAND, imm(1), A)},
+     {binary(TokenType::AMPERSAND, imm(1), A)}},
+    {{binary(TokenType::CARET, imm(2), A), binary(TokenType::CARET, A, A)},
+     {mov(imm(0), A)}},
+    {{binary(TokenType::CARET, imm(2), A), binary(TokenType::CARET, imm(2), A)},
+     {}},
+    {{binary(TokenType::CARET, imm(2), A), shift(AsmShiftOp::SAL, 31, A)},
+     {shift(AsmShiftOp::SAL, 31, A)}},
+    {{binary(TokenType::CARET, imm(2), A), shift(AsmShiftOp::SAR, 2, A)},
+     {shift(AsmShiftOp::SAR, 2, A)}},
+    {{binary(TokenType::CARET, imm(2), A), shift(AsmShiftOp::SAR, 31, A)},
+     {shift(AsmShiftOp::SAR, 31, A)}},
+    {{binary(TokenType::CARET, imm(2), A), shift(AsmShiftOp::SHR, 2, A)},
+     {shift(AsmShiftOp::SHR, 2, A)}},
+    {{binary(TokenType::CARET, imm(2), A), shift(AsmShiftOp::SHR, 31, A)},
+     {shift(AsmShiftOp::SHR, 31, A)}},
+    {{unary(TokenType::MINUS, A), binary(TokenType::PLUS, imm(-1), A)},
+     {binary(TokenType::CARET, imm(-1), A)}},
+    {{unary(TokenType::MINUS, A), binary(TokenType::MINUS, A, A)},
+     {mov(imm(0), A)}},
+    {{unary(TokenType::MINUS, A), binary(TokenType::MINUS, imm(1), A)},
+     {binary(TokenType::CARET, imm(-1), A)}},
+    {{unary(TokenType::MINUS, A), binary(TokenType::STAR, A, A)},
+     {binary(TokenType::STAR, A, A)}},
+    {{unary(TokenType::MINUS, A), binary(TokenType::AMPERSAND, imm(0), A)},
+     {mov(imm(0), A)}},
+    {{unary(TokenType::MINUS, A), binary(TokenType::AMPERSAND, imm(1), A)},
+     {binary(TokenType::AMPERSAND, imm(1), A)}},
+    {{unary(TokenType::MINUS, A), binary(TokenType::CARET, A, A)},
+     {mov(imm(0), A)}},
+    {{unary(TokenType::MINUS, A), binary(TokenType::CARET, imm(-1), A)},
+     {binary(TokenType::PLUS, imm(-1), A)}},
+    {{unary(TokenType::MINUS, A), unary(TokenType::MINUS, A)},
+     {}},
+    {{unary(TokenType::MINUS, A), unary(TokenType::TILDE, A)},
+     {binary(TokenType::PLUS, imm(-1), A)}},
+    {{unary(TokenType::MINUS, A), shift(AsmShiftOp::SAL, 31, A)},
+     {shift(AsmShiftOp::SAL, 31, A)}},
+    {{unary(TokenType::TILDE, A), binary(TokenType::PLUS, imm(1), A)},
+     {unary(TokenType::MINUS, A)}},
+    {{unary(TokenType::TILDE, A), binary(TokenType::MINUS, A, A)},
+     {mov(imm(0), A)}},
+    {{unary(TokenType::TILDE, A), binary(TokenType::MINUS, imm(-1), A)},
+     {unary(TokenType::MINUS, A)}},
+    {{unary(TokenType::TILDE, A), binary(TokenType::AMPERSAND, imm(0), A)},
+     {mov(imm(0), A)}},
+    {{unary(TokenType::TILDE, A), binary(TokenType::CARET, A, A)},
+     {mov(imm(0), A)}},
+    {{unary(TokenType::TILDE, A), binary(TokenType::CARET, imm(-1), A)},
+     {}},
+    {{unary(TokenType::TILDE, A), unary(TokenType::MINUS, A)},
+     {binary(TokenType::PLUS, imm(1), A)}},
+    {{unary(TokenType::TILDE, A), unary(TokenType::TILDE, A)},
+     {}},
+    {{shift(AsmShiftOp::SAL, 1, A), binary(TokenType::PLUS, A, A)},
+     {shift(AsmShiftOp::SAL, 2, A)}},
+    {{shift(AsmShiftOp::SAL, 1, A), binary(TokenType::PLUS, B, A)},
+     {lea(B, A, 2, 0, A)}},
+    {{shift(AsmShiftOp::SAL, 1, A), binary(TokenType::PLUS, imm(1), A)},
+     {lea(A, A, 1, 1, A)}},
+    {{shift(AsmShiftOp::SAL, 1, A), binary(TokenType::PLUS, imm(-1), A)},
+     {lea(A, A, 1, -1, A)}},
+    {{shift(AsmShiftOp::SAL, 1, A), binary(TokenType::MINUS, A, A)},
+     {mov(imm(0), A)}},
+    {{shift(AsmShiftOp::SAL, 1, A), binary(TokenType::MINUS, imm(1), A)},
+     {lea(A, A, 1, -1, A)}},
+    {{shift(AsmShiftOp::SAL, 1, A), binary(TokenType::MINUS, imm(-1), A)},
+     {lea(A, A, 1, 1, A)}},
+    {{shift(AsmShiftOp::SAL, 1, A), binary(TokenType::AMPERSAND, imm(0), A)},
+     {mov(imm(0), A)}},
+    {{shift(AsmShiftOp::SAL, 1, A), binary(TokenType::AMPERSAND, imm(1), A)},
+     {mov(imm(0), A)}},
+    {{shift(AsmShiftOp::SAL, 1, A), binary(TokenType::CARET, A, A)},
+     {mov(imm(0), A)}},
+    {{shift(AsmShiftOp::SAL, 1, A), binary(TokenType::CARET, imm(1), A)},
+     {lea(A, A, 1, 1, A)}},
+    {{shift(AsmShiftOp::SAL, 1, A), shift(AsmShiftOp::SAL, 1, A)},
+     {shift(AsmShiftOp::SAL, 2, A)}},
+    {{shift(AsmShiftOp::SAL, 1, A), shift(AsmShiftOp::SAL, 2, A)},
+     {lea(nullptr, A, 8, 0, A)}},
+    {{shift(AsmShiftOp::SAL, 1, A), shift(AsmShiftOp::SAL, 31, A)},
+     {mov(imm(0), A)}},
+    {{shift(AsmShiftOp::SAL, 2, A), binary(TokenType::PLUS, A, A)},
+     {lea(nullptr, A, 8, 0, A)}},
+    {{shift(AsmShiftOp::SAL, 2, A), binary(TokenType::PLUS, B, A)},
+     {lea(B, A, 4, 0, A)}},
+    {{shift(AsmShiftOp::SAL, 2, A), binary(TokenType::PLUS, imm(1), A)},
+     {lea(nullptr, A, 4, 1, A)}},
+    {{shift(AsmShiftOp::SAL, 2, A), binary(TokenType::PLUS, imm(-1), A)},
+     {lea(nullptr, A, 4, -1, A)}},
+    {{shift(AsmShiftOp::SAL, 2, A), binary(TokenType::MINUS, A, A)},
+     {mov(imm(0), A)}},
+    {{shift(AsmShiftOp::SAL, 2, A), binary(TokenType::MINUS, imm(1), A)},
+     {lea(nullptr, A, 4, -1, A)}},
+    {{shift(AsmShiftOp::SAL, 2, A), binary(TokenType::MINUS, imm(-1), A)},
+     {lea(nullptr, A, 4, 1, A)}},
+    {{shift(AsmShiftOp::SAL, 2, A), binary(TokenType::AMPERSAND, imm(0), A)},
+     {mov(imm(0), A)}},
+    {{shift(AsmShiftOp::SAL, 2, A), binary(TokenType::AMPERSAND, imm(1), A)},
+     {mov(imm(0), A)}},
+    {{shift(AsmShiftOp::SAL, 2, A), binary(TokenType::AMPERSAND, imm(2), A)},
+     {mov(imm(0), A)}},
+    {{shift(AsmShiftOp::SAL, 2, A), binary(TokenType::CARET, A, A)},
+     {mov(imm(0), A)}},
+    {{shift(AsmShiftOp::SAL, 2, A), binary(TokenType::CARET, imm(1), A)},
+     {lea(nullptr, A, 4, 1, A)}},
+    {{shift(AsmShiftOp::SAL, 2, A), shift(AsmShiftOp::SAL, 1, A)},
+     {lea(nullptr, A, 8, 0, A)}},
+    {{shift(AsmShiftOp::SAL, 2, A), shift(AsmShiftOp::SAL, 31, A)},
+     {mov(imm(0), A)}},
+    {{shift(AsmShiftOp::SAL, 31, A), binary(TokenType::PLUS, A, A)},
+     {mov(imm(0), A)}},
+    {{shift(AsmShiftOp::SAL, 31, A), binary(TokenType::MINUS, A, A)},
+     {mov(imm(0), A)}},
+    {{shift(AsmShiftOp::SAL, 31, A), binary(TokenType::STAR, A, A)},
+     {mov(imm(0), A)}},
+    {{shift(AsmShiftOp::SAL, 31, A), binary(TokenType::STAR, B, A)},
+     {binary(TokenType::AMPERSAND, B, A), shift(AsmShiftOp::SAL, 31, A)}},
+    {{shift(AsmShiftOp::SAL, 31, A), binary(TokenType::AMPERSAND, imm(0), A)},
+     {mov(imm(0), A)}},
+    {{shift(AsmShiftOp::SAL, 31, A), binary(TokenType::AMPERSAND, imm(1), A)},
+     {mov(imm(0), A)}},
+    {{shift(AsmShiftOp::SAL, 31, A), binary(TokenType::AMPERSAND, imm(2), A)},
+     {mov(imm(0), A)}},
+    {{shift(AsmShiftOp::SAL, 31, A), binary(TokenType::CARET, A, A)},
+     {mov(imm(0), A)}},
+    {{shift(AsmShiftOp::SAL, 31, A), unary(TokenType::MINUS, A)},
+     {shift(AsmShiftOp::SAL, 31, A)}},
+    {{shift(AsmShiftOp::SAL, 31, A), shift(AsmShiftOp::SAL, 1, A)},
+     {mov(imm(0), A)}},
+    {{shift(AsmShiftOp::SAL, 31, A), shift(AsmShiftOp::SAL, 2, A)},
+     {mov(imm(0), A)}},
+    {{shift(AsmShiftOp::SAL, 31, A), shift(AsmShiftOp::SAL, 31, A)},
+     {mov(imm(0), A)}},
+    {{shift(AsmShiftOp::SAL, 31, A), shift(AsmShiftOp::SHR, 31, A)},
+     {binary(TokenType::AMPERSAND, imm(1), A)}},
+    {{shift(AsmShiftOp::SAL, 31, A), imul(-1, A, B)},
+     {shift(AsmShiftOp::SAL, 31, A), mov(A, B)}},
+    {{shift(AsmShiftOp::SAR, 1, A), binary(TokenType::MINUS, A, A)},
+     {mov(imm(0), A)}},
+    {{shift(AsmShiftOp::SAR, 1, A), binary(TokenType::AMPERSAND, imm(0), A)},
+     {mov(imm(0), A)}},
+    {{shift(AsmShiftOp::SAR, 1, A), binary(TokenType::CARET, A, A)},
+     {mov(imm(0), A)}},
+    {{shift(AsmShiftOp::SAR, 1, A), shift(AsmShiftOp::SAR, 1, A)},
+     {shift(AsmShiftOp::SAR, 2, A)}},
+    {{shift(AsmShiftOp::SAR, 1, A), shift(AsmShiftOp::SAR, 31, A)},
+     {shift(AsmShiftOp::SAR, 31, A)}},
+    {{shift(AsmShiftOp::SAR, 1, A), shift(AsmShiftOp::SHR, 31, A)},
+     {shift(AsmShiftOp::SHR, 31, A)}},
+    {{shift(AsmShiftOp::SAR, 2, A), binary(TokenType::MINUS, A, A)},
+     {mov(imm(0), A)}},
+    {{shift(AsmShiftOp::SAR, 2, A), binary(TokenType::AMPERSAND, imm(0), A)},
+     {mov(imm(0), A)}},
+    {{shift(AsmShiftOp::SAR, 2, A), binary(TokenType::CARET, A, A)},
+     {mov(imm(0), A)}},
+    {{shift(AsmShiftOp::SAR, 2, A), shift(AsmShiftOp::SAR, 31, A)},
+     {shift(AsmShiftOp::SAR, 31, A)}},
+    {{shift(AsmShiftOp::SAR, 2, A), shift(AsmShiftOp::SHR, 31, A)},
+     {shift(AsmShiftOp::SHR, 31, A)}},
+    {{shift(AsmShiftOp::SAR, 31, A), binary(TokenType::MINUS, A, A)},
+     {mov(imm(0), A)}},
+    {{shift(AsmShiftOp::SAR, 31, A), binary(TokenType::STAR, A, A)},
+     {shift(AsmShiftOp::SHR, 31, A)}},
+    {{shift(AsmShiftOp::SAR, 31, A), binary(TokenType::AMPERSAND, imm(0), A)},
+     {mov(imm(0), A)}},
+    {{shift(AsmShiftOp::SAR, 31, A), binary(TokenType::AMPERSAND, imm(1), A)},
+     {shift(AsmShiftOp::SHR, 31, A)}},
+    {{shift(AsmShiftOp::SAR, 31, A), binary(TokenType::CARET, A, A)},
+     {mov(imm(0), A)}},
+    {{shift(AsmShiftOp::SAR, 31, A), unary(TokenType::MINUS, A)},
+     {shift(AsmShiftOp::SHR, 31, A)}},
+    {{shift(AsmShiftOp::SAR, 31, A), shift(AsmShiftOp::SAR, 1, A)},
+     {shift(AsmShiftOp::SAR, 31, A)}},
+    {{shift(AsmShiftOp::SAR, 31, A), shift(AsmShiftOp::SAR, 2, A)},
+     {shift(AsmShiftOp::SAR, 31, A)}},
+    {{shift(AsmShiftOp::SAR, 31, A), shift(AsmShiftOp::SAR, 31, A)},
+     {shift(AsmShiftOp::SAR, 31, A)}},
+    {{shift(AsmShiftOp::SAR, 31, A), shift(AsmShiftOp::SHR, 31, A)},
+     {shift(AsmShiftOp::SHR, 31, A)}},
+    {{shift(AsmShiftOp::SHR, 1, A), binary(TokenType::MINUS, A, A)},
+     {mov(imm(0), A)}},
+    {{shift(AsmShiftOp::SHR, 1, A), binary(TokenType::AMPERSAND, imm(0), A)},
+     {mov(imm(0), A)}},
+    {{shift(AsmShiftOp::SHR, 1, A), binary(TokenType::CARET, A, A)},
+     {mov(imm(0), A)}},
+    {{shift(AsmShiftOp::SHR, 1, A), shift(AsmShiftOp::SAR, 1, A)},
+     {shift(AsmShiftOp::SHR, 2, A)}},
+    {{shift(AsmShiftOp::SHR, 1, A), shift(AsmShiftOp::SAR, 31, A)},
+     {mov(imm(0), A)}},
+    {{shift(AsmShiftOp::SHR, 1, A), shift(AsmShiftOp::SHR, 1, A)},
+     {shift(AsmShiftOp::SHR, 2, A)}},
+    {{shift(AsmShiftOp::SHR, 1, A), shift(AsmShiftOp::SHR, 31, A)},
+     {mov(imm(0), A)}},
+    {{shift(AsmShiftOp::SHR, 2, A), binary(TokenType::MINUS, A, A)},
+     {mov(imm(0), A)}},
+    {{shift(AsmShiftOp::SHR, 2, A), binary(TokenType::AMPERSAND, imm(0), A)},
+     {mov(imm(0), A)}},
+    {{shift(AsmShiftOp::SHR, 2, A), binary(TokenType::CARET, A, A)},
+     {mov(imm(0), A)}},
+    {{shift(AsmShiftOp::SHR, 2, A), shift(AsmShiftOp::SAR, 31, A)},
+     {mov(imm(0), A)}},
+    {{shift(AsmShiftOp::SHR, 2, A), shift(AsmShiftOp::SHR, 31, A)},
+     {mov(imm(0), A)}},
+    {{shift(AsmShiftOp::SHR, 31, A), binary(TokenType::MINUS, A, A)},
+     {mov(imm(0), A)}},
+    {{shift(AsmShiftOp::SHR, 31, A), binary(TokenType::STAR, A, A)},
+     {shift(AsmShiftOp::SHR, 31, A)}},
+    {{shift(AsmShiftOp::SHR, 31, A), binary(TokenType::STAR, B, A)},
+     {shift(AsmShiftOp::SAR, 31, A), binary(TokenType::AMPERSAND, B, A)}},
+    {{shift(AsmShiftOp::SHR, 31, A), binary(TokenType::AMPERSAND, imm(0), A)},
+     {mov(imm(0), A)}},
+    {{shift(AsmShiftOp::SHR, 31, A), binary(TokenType::AMPERSAND, imm(1), A)},
+     {shift(AsmShiftOp::SHR, 31, A)}},
+    {{shift(AsmShiftOp::SHR, 31, A), binary(TokenType::AMPERSAND, imm(2), A)},
+     {mov(imm(0), A)}},
+    {{shift(AsmShiftOp::SHR, 31, A), binary(TokenType::CARET, A, A)},
+     {mov(imm(0), A)}},
+    {{shift(AsmShiftOp::SHR, 31, A), unary(TokenType::MINUS, A)},
+     {shift(AsmShiftOp::SAR, 31, A)}},
+    {{shift(AsmShiftOp::SHR, 31, A), shift(AsmShiftOp::SAR, 1, A)},
+     {mov(imm(0), A)}},
+    {{shift(AsmShiftOp::SHR, 31, A), shift(AsmShiftOp::SAR, 2, A)},
+     {mov(imm(0), A)}},
+    {{shift(AsmShiftOp::SHR, 31, A), shift(AsmShiftOp::SAR, 31, A)},
+     {mov(imm(0), A)}},
+    {{shift(AsmShiftOp::SHR, 31, A), shift(AsmShiftOp::SHR, 1, A)},
+     {mov(imm(0), A)}},
+    {{shift(AsmShiftOp::SHR, 31, A), shift(AsmShiftOp::SHR, 2, A)},
+     {mov(imm(0), A)}},
+    {{shift(AsmShiftOp::SHR, 31, A), shift(AsmShiftOp::SHR, 31, A)},
+     {mov(imm(0), A)}},
+    {{mov(A, B), mov(B, A)},
+     {mov(A, B)}},
+    {{mov(A, B), binary(TokenType::AMPERSAND, B, A)},
+     {mov(A, B)}},
+    {{mov(A, B), binary(TokenType::PLUS, A, B)},
+     {lea(A, A, 1, 0, B)}},
+    {{mov(A, B), binary(TokenType::PLUS, B, B)},
+     {lea(A, A, 1, 0, B)}},
+    {{mov(A, B), binary(TokenType::PLUS, imm(1), B)},
+     {lea(A, nullptr, 1, 1, B)}},
+    {{mov(A, B), binary(TokenType::PLUS, imm(-1), B)},
+     {lea(A, nullptr, 1, -1, B)}},
+    {{mov(A, B), binary(TokenType::MINUS, A, B)},
+     {mov(imm(0), B)}},
+    {{mov(A, B), binary(TokenType::MINUS, B, B)},
+     {mov(imm(0), B)}},
+    {{mov(A, B), binary(TokenType::MINUS, imm(1), B)},
+     {lea(A, nullptr, 1, -1, B)}},
+    {{mov(A, B), binary(TokenType::MINUS, imm(-1), B)},
+     {lea(A, nullptr, 1, 1, B)}},
+    {{mov(A, B), binary(TokenType::AMPERSAND, A, B)},
+     {mov(A, B)}},
+    {{mov(A, B), binary(TokenType::AMPERSAND, imm(0), B)},
+     {mov(imm(0), B)}},
+    {{mov(A, B), binary(TokenType::CARET, A, B)},
+     {mov(imm(0), B)}},
+    {{mov(A, B), binary(TokenType::CARET, B, B)},
+     {mov(imm(0), B)}},
+    {{mov(A, B), shift(AsmShiftOp::SAL, 1, B)},
+     {lea(A, A, 1, 0, B)}},
+    {{mov(A, B), shift(AsmShiftOp::SAL, 2, B)},
+     {lea(nullptr, A, 4, 0, B)}},
+    {{binary(TokenType::PLUS, A, B), binary(TokenType::PLUS, A, B)},
+     {lea(B, A, 2, 0, B)}},
+    {{binary(TokenType::PLUS, A, B), binary(TokenType::PLUS, imm(1), B)},
+     {lea(A, B, 1, 1, B)}},
+    {{binary(TokenType::PLUS, A, B), binary(TokenType::PLUS, imm(-1), B)},
+     {lea(A, B, 1, -1, B)}},
+    {{binary(TokenType::PLUS, A, B), binary(TokenType::MINUS, A, B)},
+     {}},
+    {{binary(TokenType::PLUS, A, B), binary(TokenType::MINUS, B, B)},
+     {mov(imm(0), B)}},
+    {{binary(TokenType::PLUS, A, B), binary(TokenType::MINUS, imm(1), B)},
+     {lea(A, B, 1, -1, B)}},
+    {{binary(TokenType::PLUS, A, B), binary(TokenType::MINUS, imm(-1), B)},
+     {lea(A, B, 1, 1, B)}},
+    {{binary(TokenType::PLUS, A, B), binary(TokenType::AMPERSAND, imm(0), B)},
+     {mov(imm(0), B)}},
+    {{binary(TokenType::PLUS, A, B), binary(TokenType::CARET, B, B)},
+     {mov(imm(0), B)}},
+    {{binary(TokenType::MINUS, A, B), binary(TokenType::PLUS, A, B)},
+     {}},
+    {{binary(TokenType::MINUS, A, B), binary(TokenType::MINUS, B, B)},
+     {mov(imm(0), B)}},
+    {{binary(TokenType::MINUS, A, B), binary(TokenType::AMPERSAND, imm(0), B)},
+     {mov(imm(0), B)}},
+    {{binary(TokenType::MINUS, A, B), binary(TokenType::CARET, B, B)},
+     {mov(imm(0), B)}},
+    {{binary(TokenType::STAR, A, B), binary(TokenType::MINUS, B, B)},
+     {mov(imm(0), B)}},
+    {{binary(TokenType::STAR, A, B), binary(TokenType::AMPERSAND, imm(0), B)},
+     {mov(imm(0), B)}},
+    {{binary(TokenType::STAR, A, B), binary(TokenType::AMPERSAND, imm(1), B)},
+     {binary(TokenType::AMPERSAND, A, B), binary(TokenType::AMPERSAND, imm(1), B)}},
+    {{binary(TokenType::STAR, A, B), binary(TokenType::CARET, B, B)},
+     {mov(imm(0), B)}},
+    {{binary(TokenType::STAR, A, B), shift(AsmShiftOp::SAL, 31, B)},
+     {binary(TokenType::AMPERSAND, A, B), shift(AsmShiftOp::SAL, 31, B)}},
+    {{binary(TokenType::AMPERSAND, A, B), binary(TokenType::MINUS, B, B)},
+     {mov(imm(0), B)}},
+    {{binary(TokenType::AMPERSAND, A, B), binary(TokenType::AMPERSAND, A, B)},
+     {binary(TokenType::AMPERSAND, A, B)}},
+    {{binary(TokenType::AMPERSAND, A, B), binary(TokenType::AMPERSAND, imm(0), B)},
+     {mov(imm(0), B)}},
+    {{binary(TokenType::AMPERSAND, A, B), binary(TokenType::CARET, B, B)},
+     {mov(imm(0), B)}},
+    {{binary(TokenType::CARET, A, B), binary(TokenType::MINUS, B, B)},
+     {mov(imm(0), B)}},
+    {{binary(TokenType::CARET, A, B), binary(TokenType::AMPERSAND, imm(0), B)},
+     {mov(imm(0), B)}},
+    {{binary(TokenType::CARET, A, B), binary(TokenType::CARET, A, B)},
+     {}},
+    {{binary(TokenType::CARET, A, B), binary(TokenType::CARET, B, B)},
+     {mov(imm(0), B)}},
+    {{imul(-1, A, B), mov(B, A)},
+     {unary(TokenType::MINUS, A), mov(A, B)}},
+    {{imul(-1, A, B), imul(-1, B, A)},
+     {mov(A, B), unary(TokenType::MINUS, B)}},
+    {{imul(-1, A, B), binary(TokenType::PLUS, A, B)},
+     {mov(imm(0), B)}},
+    {{imul(-1, A, B), binary(TokenType::PLUS, B, B)},
+     {lea(A, A, 1, 0, B), unary(TokenType::MINUS, B)}},
+    {{imul(-1, A, B), binary(TokenType::PLUS, imm(1), B)},
+     {mov(imm(1), B), binary(TokenType::MINUS, A, B)}},
+    {{imul(-1, A, B), binary(TokenType::PLUS, imm(-1), B)},
+     {mov(A, B), binary(TokenType::CARET, imm(-1), B)}},
+    {{imul(-1, A, B), binary(TokenType::PLUS, imm(2), B)},
+     {mov(imm(2), B), binary(TokenType::MINUS, A, B)}},
+    {{imul(-1, A, B), binary(TokenType::MINUS, A, B)},
+     {lea(A, A, 1, 0, B), unary(TokenType::MINUS, B)}},
+    {{imul(-1, A, B), binary(TokenType::MINUS, B, B)},
+     {mov(imm(0), B)}},
+    {{imul(-1, A, B), binary(TokenType::MINUS, imm(1), B)},
+     {mov(A, B), binary(TokenType::CARET, imm(-1), B)}},
+    {{imul(-1, A, B), binary(TokenType::MINUS, imm(-1), B)},
+     {mov(imm(1), B), binary(TokenType::MINUS, A, B)}},
+    {{imul(-1, A, B), binary(TokenType::MINUS, imm(2), B)},
+     {lea(A, nullptr, 1, 1, B), binary(TokenType::CARET, imm(-1), B)}},
+    {{imul(-1, A, B), binary(TokenType::STAR, B, B)},
+     {mov(A, B), binary(TokenType::STAR, A, B)}},
+    {{imul(-1, A, B), binary(TokenType::AMPERSAND, imm(0), B)},
+     {mov(imm(0), B)}},
+    {{imul(-1, A, B), binary(TokenType::AMPERSAND, imm(1), B)},
+     {mov(A, B), binary(TokenType::AMPERSAND, imm(1), B)}},
+    {{imul(-1, A, B), binary(TokenType::AMPERSAND, imm(2), B)},
+     {lea(A, A, 2, 0, B), binary(TokenType::AMPERSAND, imm(2), B)}},
+    {{imul(-1, A, B), binary(TokenType::CARET, B, B)},
+     {mov(imm(0), B)}},
+    {{imul(-1, A, B), binary(TokenType::CARET, imm(-1), B)},
+     {lea(A, nullptr, 1, -1, B)}},
+    {{imul(-1, A, B), unary(TokenType::MINUS, B)},
+     {mov(A, B)}},
+    {{imul(-1, A, B), unary(TokenType::TILDE, B)},
+     {lea(A, nullptr, 1, -1, B)}},
+    {{imul(-1, A, B), shift(AsmShiftOp::SAL, 1, B)},
+     {lea(A, A, 1, 0, B), unary(TokenType::MINUS, B)}},
+    {{imul(-1, A, B), shift(AsmShiftOp::SAL, 2, B)},
+     {lea(nullptr, A, 4, 0, B), unary(TokenType::MINUS, B)}},
+    {{imul(-1, A, B), shift(AsmShiftOp::SAL, 31, B)},
+     {mov(A, B), shift(AsmShiftOp::SAL, 31, B)}},
+  };
+}
+}
+
+#endif // SUPEROPTRULES_H
@@ -0,0 +1,86 @@
+#ifndef TACKYCFG_H
+#define TACKYCFG_H
+
+#include "ast/Tacky.h"
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace ccomp {
+// A basic block of Tacky instructions. Every block has a label and ends in
+// explicit terminators: Return, Jump(L), JumpTable(i, [L...]), or
+// JumpIfZero|JumpIfNotZero(c, L1) followed by Jump(L2). Blocks can be cloned and reordered without worrying
+// about fallthrough.
+struct TackyBlock {
+  std::string label;
+  std::vector<std::shared_ptr<Tacky>> instructions;
+};
+
+// A natural loop, identified by its header block.
+struct TackyLoop {
+  int header;
+  // sorted block indices, header included
+  std::vector<int> blocks;
+  // blocks with a back edge to the header
+  std::vector<int> latches;
+  bool innermost;
+};
+
+// Control flow graph of a single function. Passes edit `blocks` and call
+// analyze() to refresh the edges, dominators and loops.
+class TackyCFG {
+public:
+  explicit TackyCFG(const std::vector<std::shared_ptr<Tacky>>& instructions);
+
+  // Lays the blocks out in order. Jumps to the next block and labels that
+  // are never jumped to are dropped.
+  std::vector<std::shared_ptr<Tacky>> instructions() const;
+
+  void analyze();
+  void remove_unreachable();
+
+  int find_block(const std::string& label) const;
+  bool dominates(int a, int b) const;
+  bool in_loop(const TackyLoop& loop, int block) const;
+
+  static std::string unique_label(const std::string& desc);
+  static std::string unique_var();
+
+  std::vector<TackyBlock> blocks;
+  std::vector<std::vector<int>> succs;
+  std::vector<std::vector<int>> preds;
+  std::vector<int> idom;
+  std::vector<int> rpo;
+  std::vector<TackyLoop> loops;
+
+private:
+  std::unordered_map<std::string, int> label_to_block_;
+  std::vector<int> rpo_index_;
+
+  void compute_dominators();
+  void find_loops();
+};
+
+// Instruction helpers shared by the Tacky passes. Tacky nodes are shared
+// between instructions, so passes never modify a node in place.
+std::shared_ptr<Tacky> tacky_dest(const Tacky& inst);
+std::vector<std::shared_ptr<Tacky>> tacky_srcs(const Tacky& inst);
+const std::string* var_name(const std::shared_ptr<Tacky>& val);
+bool is_terminator(const Tacky& inst);
+std::vector<std::string> successors(const TackyBlock& block);
+void retarget(TackyBlock& block, const std::string& from, const std::string& to);
+
+// A block ending in JumpIfZero|JumpIfNotZero(c, L1) Jump(L2), with the
+// successors taken when c is nonzero and when it is zero.
+struct TackyBranch {
+  std::shared_ptr<Tacky> condition;
+  std::string if_true;
+  std::string if_false;
+  // percent chance of going to if_true, or kUnknownProb
+  int prob;
+};
+bool cond_branch(const TackyBlock& block, TackyBranch& branch);
+}
+
+#endif // TACKYCFG_H
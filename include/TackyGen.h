@@ -2,30 +2,79 @@
 #define TACKYGEN_H
 
 #include "ErrorHandler.h"
+#include "Options.h"
+#include "Util.h"
 #include "ast/Tacky.h"
 #include "ast/Expr.h"
 #include "ast/Stmt.h"
+#include <unordered_map>
 
 namespace ccomp {
 class TackyGen {
 public:
-  TackyGen(const std::vector<std::unique_ptr<Stmt>>& stmts, ErrorHandler& errorHandler);
+  TackyGen(const std::vector<std::unique_ptr<Stmt>>& stmts,
+           const Options& options, ErrorHandler& errorHandler);
   std::shared_ptr<Tacky> gen();
 
 private:
   const std::vector<std::unique_ptr<Stmt>>& stmts_;
   std::vector<std::shared_ptr<Tacky>> instructions_;
+  const Options& options_;
   ErrorHandler& errorHandler_;
 
   std::shared_ptr<Tacky> gen(Expr* expr);
   std::shared_ptr<Tacky> gen(Stmt* stmt);
   void gen(const std::vector<std::unique_ptr<Stmt>>& stmts);
 
+  // Registers an expression needs, by Sethi-Ullman labelling: a leaf takes
+  // one (a constant none, as it is an immediate), and an operator the
+  // larger of its operands' needs, or one more when they tie. ordered is
+  // the need when the hungrier operand of every pure operator goes first,
+  // source the need in source order.
+  struct Need {
+    int ordered;
+    int source;
+    // no assignment inside, so operands may be evaluated in either order
+    bool pure;
+  };
+  const Need& need(const Expr* expr);
+  Need need(const BinaryExpr& expr);
+  // whether the right operand of an arithmetic or relational operator is
+  // evaluated first
+  bool right_first(const BinaryExpr& expr);
+  std::unordered_map<const Expr*, Need> needs_;
+  // the function's peak needs and operators evaluated right to left
+  int peak_ordered_ = 0;
+  int peak_source_ = 0;
+  int swapped_ = 0;
+
   std::shared_ptr<Tacky> genLogical(const BinaryExpr& expr);
+  // Condition context: jumps to target when cond is nonzero (jump_if_true)
+  // or zero, and falls through otherwise. &&, || and ! become branches
+  // instead of 0/1 temporaries. prob is the chance the jump is taken, from
+  // an enclosing __builtin_expect.
+  void genBranch(Expr* cond, std::shared_ptr<Tacky> target, bool jump_if_true,
+                 int prob = kUnknownProb);
+
+  // Dispatch for the sorted (value, label) cases in [lo, hi) of a switch on
+  // v, known to lie in [min, max]. Dense ranges become a jump table, sparse
+  // ones a binary search that ends in short compare chains.
+  using SwitchCase = std::pair<int, std::shared_ptr<Tacky>>;
+  void genDispatch(std::shared_ptr<Tacky> v,
+                   const std::vector<SwitchCase>& cases, size_t lo, size_t hi,
+                   std::shared_ptr<Tacky> default_label,
+                   long long min, long long max);
+  // fewest cases worth a jump table, and the most table entries per case
+  static constexpr size_t kJumpTableMinCases = 4;
+  static constexpr long long kJumpTableMaxSpread = 3;
+  // most cases tested one after another
+  static constexpr size_t kCompareChainMaxCases = 3;
   std::string unique_var();
   std::string unique_label(const std::string& desc);
   std::string break_label(int loop_label);
   std::string continue_label(int loop_label);
+  std::string case_label(int loop_label, int index);
+  std::string default_label(int loop_label);
 
   template<typename T, typename... Args>
   std::shared_ptr<Tacky> make_tacky(Args&&... args)
@@ -45,11 +94,15 @@ public:
   std::shared_ptr<Tacky> operator()(const Null& stmt);
   std::shared_ptr<Tacky> operator()(const Break& stmt);
   std::shared_ptr<Tacky> operator()(const Continue& stmt);
+  std::shared_ptr<Tacky> operator()(const Switch& stmt);
+  std::shared_ptr<Tacky> operator()(const Case& stmt);
+  std::shared_ptr<Tacky> operator()(const Default& stmt);
 
   std::shared_ptr<Tacky> operator()(const Conditional& expr);
   std::shared_ptr<Tacky> operator()(const BinaryExpr& expr);
   std::shared_ptr<Tacky> operator()(const LiteralExpr& expr);
   std::shared_ptr<Tacky> operator()(const UnaryExpr& expr);
+  std::shared_ptr<Tacky> operator()(const Expect& expr);
   std::shared_ptr<Tacky> operator()(const Variable& expr);
 };
 }
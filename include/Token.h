@@ -20,6 +20,7 @@ enum class TokenType {
   PERCENT,
   QUESTION_MARK,
   COLON,
+  CARET,
 
   // One or two character tokens.
   AMPERSAND,
@@ -61,6 +62,9 @@ enum class TokenType {
   FOR,
   BREAK,
   CONTINUE,
+  SWITCH,
+  CASE,
+  DEFAULT,
 
   ERROR,
   END_OF_FILE
@@ -0,0 +1,82 @@
+#ifndef TREEMATCHER_H
+#define TREEMATCHER_H
+
+#include "Token.h"
+#include "ast/Asm.h"
+#include "ast/Tacky.h"
+#include <array>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+namespace ccomp {
+// Bottom-up tree pattern matching (BURS style) for trees of +, - and *.
+// Every node is labelled with the cheapest way to get its value into an
+// operand and the cheapest address of each shape base + index*scale + disp
+// it can be folded into; the cheapest cover is then emitted, using leal,
+// shifts, three-operand imull or the two-address forms. Costs are rough
+// cycles: 1 for moves, lea and ALU operations, 3 for a multiply.
+class TreeMatcher {
+public:
+  struct Node {
+    // the operand of a leaf, or the Tacky dest of an operation
+    std::shared_ptr<Tacky> value;
+    TokenType op = TokenType::PLUS;
+    std::unique_ptr<Node> left, right;
+
+    bool leaf() const { return left == nullptr; }
+  };
+
+  explicit TreeMatcher(std::vector<std::shared_ptr<Asm>>& instructions);
+  // Emits root, leaving its value in the Tacky dest of the root.
+  void emit(Node& root);
+
+private:
+  enum class Rule { Leaf, TwoAddress, ImulImm, Lea, MulChain };
+
+  // one step of a multiplication by a constant: t = t*factor with a lea,
+  // or t = t << shift
+  struct Step {
+    int factor;
+    int shift;
+  };
+
+  // base + index*scale + disp, base and index evaluated into registers
+  struct Address {
+    int cost;
+    const Node* base = nullptr;
+    const Node* index = nullptr;
+    int scale = 1;
+    long long disp = 0;
+  };
+
+  // by shape: 1 = base, 2 = index, 3 = base and index
+  using Addresses = std::array<Address, 4>;
+
+  struct Label {
+    int cost;
+    Rule rule;
+    Addresses addrs;
+    // the address a Lea computes
+    Address lea;
+    // the steps of a MulChain
+    std::vector<Step> steps;
+    // operand already holding the value, once emitted
+    std::shared_ptr<Asm> operand;
+  };
+
+  std::vector<std::shared_ptr<Asm>>& instructions_;
+  std::unordered_map<const Node*, Label> labels_;
+
+  void label(const Node& node);
+  std::shared_ptr<Asm> operand(const Node& node);
+  void emit(const Node& node, std::shared_ptr<Asm> dest);
+  static std::shared_ptr<Asm> tacky_operand(const Node& node);
+  static const int* constant(const Node& node);
+  static int chain_cost(const std::vector<Step>& steps);
+  static std::vector<Step> mul_steps(int c);
+  static bool same(const std::shared_ptr<Asm>& a, const std::shared_ptr<Asm>& b);
+};
+}
+
+#endif // TREEMATCHER_H
@@ -3,6 +3,9 @@
 
 #include "Token.h"
 #include "ast/Asm.h"
+#include "ast/Tacky.h"
+#include <climits>
+#include <cstdint>
 #include <memory>
 #include <vector>
 #include <algorithm>
@@ -24,6 +27,66 @@ inline bool isLogicalOp(TokenType op) {
                 TokenType::PIPE_PIPE});
 }
 
+// Builds the operator token for instructions created by the optimizer.
+inline Token make_op(TokenType type) {
+  switch (type) {
+    case TokenType::PLUS: return Token(type, "+", "", 0);
+    case TokenType::MINUS: return Token(type, "-", "", 0);
+    case TokenType::STAR: return Token(type, "*", "", 0);
+    case TokenType::SLASH: return Token(type, "/", "", 0);
+    case TokenType::PERCENT: return Token(type, "%", "", 0);
+    case TokenType::AMPERSAND: return Token(type, "&", "", 0);
+    case TokenType::CARET: return Token(type, "^", "", 0);
+    case TokenType::TILDE: return Token(type, "~", "", 0);
+    case TokenType::BANG: return Token(type, "!", "", 0);
+    case TokenType::LESS: return Token(type, "<", "", 0);
+    case TokenType::LESS_EQUAL: return Token(type, "<=", "", 0);
+    case TokenType::GREATER: return Token(type, ">", "", 0);
+    case TokenType::GREATER_EQUAL: return Token(type, ">=", "", 0);
+    case TokenType::EQUAL_EQUAL: return Token(type, "==", "", 0);
+    case TokenType::BANG_EQUAL: return Token(type, "!=", "", 0);
+    default: return Token(type, "", "", 0);
+  }
+}
+
+// Branch probabilities on TackyJumpIfZero|JumpIfNotZero and AsmJmpCC are
+// the percent chance the jump is taken, or kUnknownProb.
+inline constexpr int kUnknownProb = -1;
+// how likely __builtin_expect's expected outcome is, as in gcc
+inline constexpr int kExpectProb = 90;
+
+// Whether a value computed in 64 bits fits in an int.
+inline bool fits_int(int64_t value) {
+  return value >= INT_MIN && value <= INT_MAX;
+}
+
+// A value computed in 64 bits, wrapped around as 32-bit arithmetic does.
+inline int wrap(int64_t value) {
+  return (int)(uint32_t)value;
+}
+
+// The probability of the opposite jump.
+inline int invert_prob(int prob) {
+  return (prob == kUnknownProb) ? kUnknownProb : 100 - prob;
+}
+
+// The condition that holds exactly when cc does not.
+inline AsmCondCode invert(AsmCondCode cc) {
+  switch (cc) {
+    case AsmCondCode::E: return AsmCondCode::NE;
+    case AsmCondCode::NE: return AsmCondCode::E;
+    case AsmCondCode::G: return AsmCondCode::LE;
+    case AsmCondCode::GE: return AsmCondCode::L;
+    case AsmCondCode::L: return AsmCondCode::GE;
+    case AsmCondCode::LE: return AsmCondCode::G;
+  }
+  return cc;
+}
+
+template<typename T, typename... Args>
+std::shared_ptr<Tacky> make_tacky(Args&&... args)
+{ return std::make_shared<Tacky>(T(std::forward<Args>(args)...)); }
+
 template<typename T, typename... Args>
 std::shared_ptr<Asm> make_asm(Args&&... args)
 { return std::make_shared<Asm>(T(std::forward<Args>(args)...)); }
@@ -43,6 +106,45 @@ std::shared_ptr<Asm> make_add_and_return(
   instructions.emplace_back(inst);
   return inst;
 }
+
+// Rebuilds inst with every register or pseudo operand passed through fn.
+// The missing base or index of a Lea is passed as nullptr.
+template<typename F>
+std::shared_ptr<Asm> map_operands(const std::shared_ptr<Asm>& inst, F fn) {
+  if (auto mov = std::get_if<AsmMov>(inst.get())) {
+    return make_asm<AsmMov>(fn(mov->src), fn(mov->dest));
+  } else if (auto unary = std::get_if<AsmUnary>(inst.get())) {
+    return make_asm<AsmUnary>(unary->op, fn(unary->operand));
+  } else if (auto bin = std::get_if<AsmBinary>(inst.get())) {
+    return make_asm<AsmBinary>(bin->op, fn(bin->operand1), fn(bin->operand2));
+  } else if (auto cmp = std::get_if<AsmCmp>(inst.get())) {
+    return make_asm<AsmCmp>(fn(cmp->operand1), fn(cmp->operand2));
+  } else if (auto test = std::get_if<AsmTest>(inst.get())) {
+    return make_asm<AsmTest>(fn(test->operand1), fn(test->operand2));
+  } else if (auto lea = std::get_if<AsmLea>(inst.get())) {
+    return make_asm<AsmLea>(fn(lea->base), fn(lea->index), lea->scale,
+                            lea->disp, fn(lea->dest));
+  } else if (auto imul = std::get_if<AsmImulImm>(inst.get())) {
+    return make_asm<AsmImulImm>(imul->value, fn(imul->src), fn(imul->dest));
+  } else if (auto shift = std::get_if<AsmShift>(inst.get())) {
+    return make_asm<AsmShift>(shift->op, shift->count, fn(shift->operand));
+  } else if (auto imul = std::get_if<AsmImulHi>(inst.get())) {
+    return make_asm<AsmImulHi>(fn(imul->operand));
+  } else if (auto idiv = std::get_if<AsmIdiv>(inst.get())) {
+    return make_asm<AsmIdiv>(fn(idiv->operand));
+  } else if (auto setcc = std::get_if<AsmSetCC>(inst.get())) {
+    return make_asm<AsmSetCC>(setcc->cond_code, fn(setcc->operand));
+  } else if (auto cmov = std::get_if<AsmCMovCC>(inst.get())) {
+    return make_asm<AsmCMovCC>(cmov->cond_code, fn(cmov->src), fn(cmov->dest));
+  } else if (auto table = std::get_if<AsmJumpTable>(inst.get())) {
+    return make_asm<AsmJumpTable>(fn(table->index), table->targets);
+  }
+  return inst;
+}
+
+// Bytes below %rsp the System V ABI keeps safe from signal handlers, which
+// a leaf function may use as its frame without moving %rsp.
+inline constexpr int kRedZone = 128;
 }
 
 #endif
@@ -13,20 +13,31 @@ class AsmFunction;
 class AsmUnary;
 class AsmBinary;
 class AsmCmp;
+class AsmTest;
+class AsmLea;
+class AsmImulImm;
+class AsmShift;
+class AsmImulHi;
 class AsmIdiv;
 class AsmCdq;
 class AsmJmp;
 class AsmJmpCC;
 class AsmSetCC;
+class AsmCMovCC;
+class AsmJumpTable;
 class AsmLabel;
+class AsmAlign;
+class AsmSection;
+class AsmCount;
 class AsmMov;
 class AsmAllocateStack;
+class AsmDeallocateStack;
 class AsmReturn;
 class AsmImm;
 class AsmRegister;
 class AsmPseudo;
 class AsmStack;
-using Asm = std::variant<AsmProgram, AsmFunction, AsmUnary, AsmBinary, AsmCmp, AsmIdiv, AsmCdq, AsmJmp, AsmJmpCC, AsmSetCC, AsmLabel, AsmMov, AsmAllocateStack, AsmReturn, AsmImm, AsmRegister, AsmPseudo, AsmStack>;
+using Asm = std::variant<AsmProgram, AsmFunction, AsmUnary, AsmBinary, AsmCmp, AsmTest, AsmLea, AsmImulImm, AsmShift, AsmImulHi, AsmIdiv, AsmCdq, AsmJmp, AsmJmpCC, AsmSetCC, AsmCMovCC, AsmJumpTable, AsmLabel, AsmAlign, AsmSection, AsmCount, AsmMov, AsmAllocateStack, AsmDeallocateStack, AsmReturn, AsmImm, AsmRegister, AsmPseudo, AsmStack>;
 enum AsmCondCode {
   E,
   NE,
@@ -37,10 +48,20 @@ enum AsmCondCode {
 };
 enum AsmReg {
   AX,
+  CX,
   DX,
+  SI,
+  DI,
+  R8,
+  R9,
   R10,
   R11,
 };
+enum AsmShiftOp {
+  SAL,
+  SAR,
+  SHR,
+};
 class AsmProgram {
 public: 
   AsmProgram(  std::vector<std::shared_ptr<Asm>> functions) :
@@ -51,11 +72,12 @@ public:
 
 class AsmFunction {
 public: 
-  AsmFunction(  Token name,   std::vector<std::shared_ptr<Asm>> instructions) :
-    name(name), instructions(instructions) {}
+  AsmFunction(  Token name,   std::vector<std::shared_ptr<Asm>> instructions,   std::string section) :
+    name(name), instructions(instructions), section(section) {}
 public: 
   Token name;
   std::vector<std::shared_ptr<Asm>> instructions;
+  std::string section;
 };
 
 class AsmUnary {
@@ -86,6 +108,55 @@ public:
   std::shared_ptr<Asm> operand2;
 };
 
+class AsmTest {
+public: 
+  AsmTest(  std::shared_ptr<Asm> operand1,   std::shared_ptr<Asm> operand2) :
+    operand1(operand1), operand2(operand2) {}
+public: 
+  std::shared_ptr<Asm> operand1;
+  std::shared_ptr<Asm> operand2;
+};
+
+class AsmLea {
+public: 
+  AsmLea(  std::shared_ptr<Asm> base,   std::shared_ptr<Asm> index,   int scale,   int disp,   std::shared_ptr<Asm> dest) :
+    base(base), index(index), scale(scale), disp(disp), dest(dest) {}
+public: 
+  std::shared_ptr<Asm> base;
+  std::shared_ptr<Asm> index;
+  int scale;
+  int disp;
+  std::shared_ptr<Asm> dest;
+};
+
+class AsmImulImm {
+public: 
+  AsmImulImm(  int value,   std::shared_ptr<Asm> src,   std::shared_ptr<Asm> dest) :
+    value(value), src(src), dest(dest) {}
+public: 
+  int value;
+  std::shared_ptr<Asm> src;
+  std::shared_ptr<Asm> dest;
+};
+
+class AsmShift {
+public: 
+  AsmShift(  AsmShiftOp op,   int count,   std::shared_ptr<Asm> operand) :
+    op(op), count(count), operand(operand) {}
+public: 
+  AsmShiftOp op;
+  int count;
+  std::shared_ptr<Asm> operand;
+};
+
+class AsmImulHi {
+public: 
+  AsmImulHi(  std::shared_ptr<Asm> operand) :
+    operand(operand) {}
+public: 
+  std::shared_ptr<Asm> operand;
+};
+
 class AsmIdiv {
 public: 
   AsmIdiv(  std::shared_ptr<Asm> operand) :
@@ -112,11 +183,12 @@ public:
 
 class AsmJmpCC {
 public: 
-  AsmJmpCC(  AsmCondCode cond_code,   std::shared_ptr<Asm> target) :
-    cond_code(cond_code), target(target) {}
+  AsmJmpCC(  AsmCondCode cond_code,   std::shared_ptr<Asm> target,   int prob) :
+    cond_code(cond_code), target(target), prob(prob) {}
 public: 
   AsmCondCode cond_code;
   std::shared_ptr<Asm> target;
+  int prob;
 };
 
 class AsmSetCC {
@@ -128,6 +200,25 @@ public:
   std::shared_ptr<Asm> operand;
 };
 
+class AsmCMovCC {
+public: 
+  AsmCMovCC(  AsmCondCode cond_code,   std::shared_ptr<Asm> src,   std::shared_ptr<Asm> dest) :
+    cond_code(cond_code), src(src), dest(dest) {}
+public: 
+  AsmCondCode cond_code;
+  std::shared_ptr<Asm> src;
+  std::shared_ptr<Asm> dest;
+};
+
+class AsmJumpTable {
+public: 
+  AsmJumpTable(  std::shared_ptr<Asm> index,   std::vector<std::shared_ptr<Asm>> targets) :
+    index(index), targets(targets) {}
+public: 
+  std::shared_ptr<Asm> index;
+  std::vector<std::shared_ptr<Asm>> targets;
+};
+
 class AsmLabel {
 public: 
   AsmLabel(  std::string identifier) :
@@ -136,6 +227,32 @@ public:
   std::string identifier;
 };
 
+class AsmAlign {
+public: 
+  AsmAlign(  int log2,   int max_skip) :
+    log2(log2), max_skip(max_skip) {}
+public: 
+  int log2;
+  int max_skip;
+};
+
+class AsmSection {
+public: 
+  AsmSection(  std::string name,   std::string symbol) :
+    name(name), symbol(symbol) {}
+public: 
+  std::string name;
+  std::string symbol;
+};
+
+class AsmCount {
+public: 
+  AsmCount(  int counter) :
+    counter(counter) {}
+public: 
+  int counter;
+};
+
 class AsmMov {
 public: 
   AsmMov(  std::shared_ptr<Asm> src,   std::shared_ptr<Asm> dest) :
@@ -153,6 +270,14 @@ public:
   int size;
 };
 
+class AsmDeallocateStack {
+public: 
+  AsmDeallocateStack(  int size) :
+    size(size) {}
+public: 
+  int size;
+};
+
 class AsmReturn {
 public: 
   AsmReturn(  int dummy) :
@@ -12,8 +12,9 @@ class Conditional;
 class BinaryExpr;
 class LiteralExpr;
 class UnaryExpr;
+class Expect;
 class Variable;
-using Expr = std::variant<Assign, Conditional, BinaryExpr, LiteralExpr, UnaryExpr, Variable>;
+using Expr = std::variant<Assign, Conditional, BinaryExpr, LiteralExpr, UnaryExpr, Expect, Variable>;
 class Assign {
 public: 
   Assign(  std::unique_ptr<Expr> lvalue,   std::unique_ptr<Expr> value) :
@@ -61,6 +62,17 @@ public:
   std::unique_ptr<Expr> right;
 };
 
+class Expect {
+public: 
+  Expect(  Token keyword,   std::unique_ptr<Expr> value,   std::unique_ptr<Expr> expected,   bool expect_true) :
+    keyword(keyword), value(std::move(value)), expected(std::move(expected)), expect_true(expect_true) {}
+public: 
+  Token keyword;
+  std::unique_ptr<Expr> value;
+  std::unique_ptr<Expr> expected;
+  bool expect_true;
+};
+
 class Variable {
 public: 
   Variable(  Token name,   int level) :
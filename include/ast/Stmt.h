@@ -20,7 +20,10 @@ class Decl;
 class Null;
 class Break;
 class Continue;
-using Stmt = std::variant<Block, Expression, Function, If, Return, DoWhile, While, For, Decl, Null, Break, Continue>;
+class Switch;
+class Case;
+class Default;
+using Stmt = std::variant<Block, Expression, Function, If, Return, DoWhile, While, For, Decl, Null, Break, Continue, Switch, Case, Default>;
 class Block {
 public: 
   Block(  std::vector<std::unique_ptr<Stmt>> stmts) :
@@ -133,6 +136,41 @@ public:
   int loop_label;
 };
 
+class Switch {
+public: 
+  Switch(  Token loc,   std::unique_ptr<Expr> condition,   std::unique_ptr<Stmt> body,   int loop_label,   std::vector<int> cases,   bool has_default) :
+    loc(loc), condition(std::move(condition)), body(std::move(body)), loop_label(loop_label), cases(cases), has_default(has_default) {}
+public: 
+  Token loc;
+  std::unique_ptr<Expr> condition;
+  std::unique_ptr<Stmt> body;
+  int loop_label;
+  std::vector<int> cases;
+  bool has_default;
+};
+
+class Case {
+public: 
+  Case(  Token loc,   std::unique_ptr<Expr> value,   std::unique_ptr<Stmt> body,   int loop_label,   int index) :
+    loc(loc), value(std::move(value)), body(std::move(body)), loop_label(loop_label), index(index) {}
+public: 
+  Token loc;
+  std::unique_ptr<Expr> value;
+  std::unique_ptr<Stmt> body;
+  int loop_label;
+  int index;
+};
+
+class Default {
+public: 
+  Default(  Token loc,   std::unique_ptr<Stmt> body,   int loop_label) :
+    loc(loc), body(std::move(body)), loop_label(loop_label) {}
+public: 
+  Token loc;
+  std::unique_ptr<Stmt> body;
+  int loop_label;
+};
+
 } // end namespace
 
 #endif
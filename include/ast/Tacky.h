@@ -20,7 +20,10 @@ class TackyJump;
 class TackyJumpIfZero;
 class TackyJumpIfNotZero;
 class TackyLabel;
-using Tacky = std::variant<TackyProgram, TackyFunction, TackyUnary, TackyBinary, TackyConstant, TackyVar, TackyReturn, TackyCopy, TackyJump, TackyJumpIfZero, TackyJumpIfNotZero, TackyLabel>;
+class TackySelect;
+class TackyJumpTable;
+class TackyCount;
+using Tacky = std::variant<TackyProgram, TackyFunction, TackyUnary, TackyBinary, TackyConstant, TackyVar, TackyReturn, TackyCopy, TackyJump, TackyJumpIfZero, TackyJumpIfNotZero, TackyLabel, TackySelect, TackyJumpTable, TackyCount>;
 class TackyProgram {
 public: 
   TackyProgram(  std::vector<std::shared_ptr<Tacky>> functions) :
@@ -102,20 +105,22 @@ public:
 
 class TackyJumpIfZero {
 public: 
-  TackyJumpIfZero(  std::shared_ptr<Tacky> condition,   std::shared_ptr<Tacky> target) :
-    condition(condition), target(target) {}
+  TackyJumpIfZero(  std::shared_ptr<Tacky> condition,   std::shared_ptr<Tacky> target,   int prob) :
+    condition(condition), target(target), prob(prob) {}
 public: 
   std::shared_ptr<Tacky> condition;
   std::shared_ptr<Tacky> target;
+  int prob;
 };
 
 class TackyJumpIfNotZero {
 public: 
-  TackyJumpIfNotZero(  std::shared_ptr<Tacky> condition,   std::shared_ptr<Tacky> target) :
-    condition(condition), target(target) {}
+  TackyJumpIfNotZero(  std::shared_ptr<Tacky> condition,   std::shared_ptr<Tacky> target,   int prob) :
+    condition(condition), target(target), prob(prob) {}
 public: 
   std::shared_ptr<Tacky> condition;
   std::shared_ptr<Tacky> target;
+  int prob;
 };
 
 class TackyLabel {
@@ -126,6 +131,34 @@ public:
   std::string identifier;
 };
 
+class TackySelect {
+public: 
+  TackySelect(  std::shared_ptr<Tacky> condition,   std::shared_ptr<Tacky> src1,   std::shared_ptr<Tacky> src2,   std::shared_ptr<Tacky> dest) :
+    condition(condition), src1(src1), src2(src2), dest(dest) {}
+public: 
+  std::shared_ptr<Tacky> condition;
+  std::shared_ptr<Tacky> src1;
+  std::shared_ptr<Tacky> src2;
+  std::shared_ptr<Tacky> dest;
+};
+
+class TackyJumpTable {
+public: 
+  TackyJumpTable(  std::shared_ptr<Tacky> index,   std::vector<std::shared_ptr<Tacky>> targets) :
+    index(index), targets(targets) {}
+public: 
+  std::shared_ptr<Tacky> index;
+  std::vector<std::shared_ptr<Tacky>> targets;
+};
+
+class TackyCount {
+public: 
+  TackyCount(  int counter) :
+    counter(counter) {}
+public: 
+  int counter;
+};
+
 } // end namespace
 
 #endif
@@ -0,0 +1,162 @@
+#include "AsmCFG.h"
+#include <algorithm>
+
+using namespace ccomp;
+
+bool ccomp::ends_block(const Asm& inst) {
+  return std::holds_alternative<AsmJmp>(inst) ||
+    std::holds_alternative<AsmJmpCC>(inst) ||
+    std::holds_alternative<AsmReturn>(inst) ||
+    std::holds_alternative<AsmJumpTable>(inst);
+}
+
+bool ccomp::is_directive(const Asm& inst) {
+  return std::holds_alternative<AsmLabel>(inst) ||
+    std::holds_alternative<AsmAlign>(inst) ||
+    std::holds_alternative<AsmSection>(inst);
+}
+
+const std::string& ccomp::target_of(const std::shared_ptr<Asm>& target) {
+  return std::get<AsmLabel>(*target).identifier;
+}
+
+AsmCFG::AsmCFG(const std::vector<std::shared_ptr<Asm>>& instructions) {
+  split(instructions);
+  link(instructions);
+  compute_dominators();
+}
+
+int AsmCFG::find_block(const std::string& label) const {
+  auto it = label_to_block_.find(label);
+  return (it == label_to_block_.end()) ? -1 : it->second;
+}
+
+void AsmCFG::split(const std::vector<std::shared_ptr<Asm>>& instructions) {
+  size_t begin = 0, body = 0;
+  bool in_body = false;
+  for (size_t i = 0; i < instructions.size(); ++i) {
+    auto& inst = *instructions[i];
+    if (is_directive(inst)) {
+      if (in_body) {
+        blocks.push_back({begin, body, i, -1, {}});
+        begin = i;
+        in_body = false;
+      }
+      if (auto label = std::get_if<AsmLabel>(&inst)) {
+        label_to_block_[label->identifier] = blocks.size();
+      }
+      continue;
+    }
+    if (!in_body) {
+      body = i;
+      in_body = true;
+    }
+    if (ends_block(inst)) {
+      blocks.push_back({begin, body, i + 1, -1, {}});
+      begin = i + 1;
+      in_body = false;
+    }
+  }
+  if (begin < instructions.size()) {
+    blocks.push_back({begin, in_body ? body : instructions.size(),
+                      instructions.size(), -1, {}});
+  }
+}
+
+void AsmCFG::link(const std::vector<std::shared_ptr<Asm>>& instructions) {
+  preds.assign(blocks.size(), {});
+  for (size_t b = 0; b < blocks.size(); ++b) {
+    auto& block = blocks[b];
+    int next = (b + 1 < blocks.size()) ? b + 1 : -1;
+    auto last = (block.end > block.body) ?
+      instructions[block.end - 1].get() : nullptr;
+    if (last == nullptr || !ends_block(*last)) {
+      block.fall = next;
+    } else if (auto jmp = std::get_if<AsmJmp>(last)) {
+      block.succs.push_back(label_to_block_.at(target_of(jmp->target)));
+    } else if (auto jmpcc = std::get_if<AsmJmpCC>(last)) {
+      block.fall = next;
+      block.succs.push_back(label_to_block_.at(target_of(jmpcc->target)));
+    } else if (auto table = std::get_if<AsmJumpTable>(last)) {
+      for (auto& target : table->targets) {
+        block.succs.push_back(label_to_block_.at(target_of(target)));
+      }
+    }
+    // the fallthrough goes first, so ties keep the original order
+    if (block.fall != -1) {
+      block.succs.insert(block.succs.begin(), block.fall);
+    }
+    for (int succ : block.succs) {
+      preds[succ].push_back(b);
+    }
+  }
+}
+
+void AsmCFG::compute_dominators() {
+  rpo_index_.assign(blocks.size(), -1);
+  idom.assign(blocks.size(), -1);
+  if (blocks.empty()) {
+    return;
+  }
+
+  // reverse postorder from the entry block
+  std::vector<bool> visited(blocks.size(), false);
+  std::vector<std::pair<int, size_t>> stack = {{0, 0}};
+  visited[0] = true;
+  while (!stack.empty()) {
+    auto& [block, next] = stack.back();
+    if (next < blocks[block].succs.size()) {
+      int succ = blocks[block].succs[next++];
+      if (!visited[succ]) {
+        visited[succ] = true;
+        stack.push_back({succ, 0});
+      }
+    } else {
+      rpo.push_back(block);
+      stack.pop_back();
+    }
+  }
+  std::reverse(rpo.begin(), rpo.end());
+  for (size_t i = 0; i < rpo.size(); ++i) {
+    rpo_index_[rpo[i]] = i;
+  }
+
+  // Cooper, Harvey and Kennedy, as in TackyCFG
+  idom[0] = 0;
+  bool changed = true;
+  while (changed) {
+    changed = false;
+    for (size_t i = 1; i < rpo.size(); ++i) {
+      int block = rpo[i];
+      int new_idom = -1;
+      for (int pred : preds[block]) {
+        if (idom[pred] == -1) {
+          continue;
+        }
+        new_idom = (new_idom == -1) ? pred : intersect(pred, new_idom);
+      }
+      if (idom[block] != new_idom) {
+        idom[block] = new_idom;
+        changed = true;
+      }
+    }
+  }
+}
+
+int AsmCFG::intersect(int a, int b) const {
+  while (a != b) {
+    while (rpo_index_[a] > rpo_index_[b]) a = idom[a];
+    while (rpo_index_[b] > rpo_index_[a]) b = idom[b];
+  }
+  return a;
+}
+
+bool AsmCFG::dominates(int a, int b) const {
+  if (idom[b] == -1) {
+    return false;
+  }
+  while (b != a && b != 0) {
+    b = idom[b];
+  }
+  return b == a;
+}
@@ -1,7 +1,17 @@
 #include "AsmGen.h"
 #include "ast/Asm.h"
+#include "BlockLayout.h"
+#include "Peephole.h"
+#include "RegAlloc.h"
+#include "ShrinkWrap.h"
+#include "StoreForwarding.h"
+#include "TreeMatcher.h"
+#include "TackyCFG.h"
 #include "Util.h"
+#include <bit>
 #include <cassert>
+#include <cstdio>
+#include <format>
 #include <memory>
 #include <unordered_map>
 #include <variant>
@@ -9,15 +19,76 @@
 
 using namespace ccomp;
 
-AsmGen::AsmGen(Tacky* tackycode, ErrorHandler& errorHandler) :
-  tackycode_(tackycode), errorHandler_(errorHandler)
+AsmGen::AsmGen(Tacky* tackycode, const Options& options,
+               const Profile& profile, ErrorHandler& errorHandler) :
+  tackycode_(tackycode), options_(options), profile_(profile),
+  errorHandler_(errorHandler)
 {}
 
 std::shared_ptr<Asm> AsmGen::gen() {
   std::shared_ptr<Asm> prog = std::visit(*this, *tackycode_);
   instructions_.clear();
   assert(std::holds_alternative<AsmProgram>(*prog));
-  return replace_pseudo_regs(prog.get());
+  auto fixed = replace_pseudo_regs(prog.get());
+  for (auto& fn : std::get<AsmProgram>(*fixed).functions) {
+    auto& function = std::get<AsmFunction>(*fn);
+    if (options_.store_forwarding) {
+      StoreForwarding forwarding(function.instructions);
+      forwarding.run();
+    }
+    if (options_.peephole) {
+      Peephole peephole(function.instructions);
+      peephole.run();
+      if (options_.stats) {
+        fprintf(stderr, "%s: peephole", function.name.lexeme.c_str());
+        const char* sep = " ";
+        for (auto& [rule, count] : peephole.hits()) {
+          fprintf(stderr, "%s%s %d", sep, rule.c_str(), count);
+          sep = ", ";
+        }
+        fprintf(stderr, "\n");
+      }
+    }
+    if (options_.block_layout) {
+      // Only a profile can show that a function is never called: every
+      // function is global, so code outside this file may call it.
+      bool called = profile_.entry_count(function.name.lexeme) != 0;
+      BlockLayout layout(function.instructions, function.name.lexeme,
+                         options_.hot_cold_split && called);
+      layout.run();
+      if (options_.hot_cold_split) {
+        if (!called) {
+          function.section = ".text.unlikely";
+        } else if (layout.hot()) {
+          function.section = ".text.hot";
+        }
+      }
+      if (options_.stats) {
+        auto [before, after] = layout.taken_branches();
+        fprintf(stderr, "%s: layout taken branches %.2f -> %.2f per call, "
+                "%d cold blocks, %s\n", function.name.lexeme.c_str(), before,
+                after, layout.cold_blocks(), function.section.c_str());
+      }
+    }
+    // A frame in the red zone has no prologue to move.
+    int frame = 0;
+    for (auto& inst : function.instructions) {
+      if (auto alloc = std::get_if<AsmAllocateStack>(inst.get())) {
+        frame = alloc->size;
+      }
+    }
+    if (options_.shrink_wrap &&
+        (!options_.omit_frame_pointer || frame > kRedZone)) {
+      ShrinkWrap wrap(function.instructions);
+      wrap.run();
+      if (options_.stats) {
+        fprintf(stderr, "%s: shrink-wrap prologue %s, %d returns share the "
+                "epilogue\n", function.name.lexeme.c_str(),
+                wrap.moved() ? "moved" : "at entry", wrap.merged());
+      }
+    }
+  }
+  return fixed;
 }
 
 std::shared_ptr<Asm> AsmGen::gen(Tacky* expr) {
@@ -62,10 +133,21 @@ std::shared_ptr<Asm> AsmGen::replace_pseudo_regs(Asm* prog) {
       for (auto inst : fn.instructions) {
         auto fix_insts = fix_pseudo(inst.get());
       }
-      // stack allocation should be at the beginning
-      auto alloc_stack = make_asm<AsmAllocateStack>(fn_stack_size_);
-      instructions_.insert(instructions_.begin(), alloc_stack);
-      return make_asm<AsmFunction>(fn.name, std::move(instructions_));
+      // stack allocation should be at the beginning, and released before
+      // every return; ShrinkWrap may move both
+      if (fn_stack_size_ > 0) {
+        auto alloc_stack = make_asm<AsmAllocateStack>(fn_stack_size_);
+        instructions_.insert(instructions_.begin(), alloc_stack);
+        for (size_t i = 0; i < instructions_.size(); ++i) {
+          if (std::holds_alternative<AsmReturn>(*instructions_[i])) {
+            instructions_.insert(instructions_.begin() + i,
+              make_asm<AsmDeallocateStack>(fn_stack_size_));
+            ++i;
+          }
+        }
+      }
+      return make_asm<AsmFunction>(fn.name, std::move(instructions_),
+                                   fn.section);
     }
 
     std::shared_ptr<Asm> operator()(const AsmUnary& unary) {
@@ -82,6 +164,8 @@ std::shared_ptr<Asm> AsmGen::replace_pseudo_regs(Asm* prog) {
       switch (bin.op.type) {
         case TokenType::PLUS:
         case TokenType::MINUS:
+        case TokenType::AMPERSAND:
+        case TokenType::CARET:
           if (std::holds_alternative<AsmStack>(*operand1) &&
               std::holds_alternative<AsmStack>(*operand2)) {
             // movl -4(%rbp), %r10d
@@ -127,6 +211,80 @@ std::shared_ptr<Asm> AsmGen::replace_pseudo_regs(Asm* prog) {
       }
     }
 
+    std::shared_ptr<Asm> operator()(const AsmTest& test) {
+      auto operand1 = fix_pseudo(test.operand1.get());
+      auto operand2 = fix_pseudo(test.operand2.get());
+
+      // only emitted as Test(x, x), which in memory is Cmp(Imm(0), x)
+      if (std::holds_alternative<AsmStack>(*operand2)) {
+        return make_add_and_return<AsmCmp>(instructions_, make_asm<AsmImm>(0),
+                                           operand2);
+      }
+      return make_add_and_return<AsmTest>(instructions_, operand1, operand2);
+    }
+
+    std::shared_ptr<Asm> operator()(const AsmLea& lea) {
+      // the address takes registers and lea only writes a register
+      // movl -4(%rbp), %r10d
+      // movl -8(%rbp), %r11d
+      // leal 4(%r10,%r11,2), %r11d
+      // movl %r11d, -12(%rbp)
+      auto base = lea.base ? fix_pseudo(lea.base.get()) : nullptr;
+      auto index = lea.index ? fix_pseudo(lea.index.get()) : nullptr;
+      auto dest = fix_pseudo(lea.dest.get());
+      if (base && std::holds_alternative<AsmStack>(*base)) {
+        auto reg = make_asm<AsmRegister>(AsmReg::R10);
+        add_inst<AsmMov>(instructions_, base, reg);
+        base = reg;
+      }
+      if (index && std::holds_alternative<AsmStack>(*index)) {
+        auto reg = make_asm<AsmRegister>(AsmReg::R11);
+        add_inst<AsmMov>(instructions_, index, reg);
+        index = reg;
+      }
+      if (std::holds_alternative<AsmStack>(*dest)) {
+        auto reg = make_asm<AsmRegister>(AsmReg::R11);
+        add_inst<AsmLea>(instructions_, base, index, lea.scale, lea.disp, reg);
+        return make_add_and_return<AsmMov>(instructions_, reg, dest);
+      }
+      return make_add_and_return<AsmLea>(instructions_, base, index,
+                                         lea.scale, lea.disp, dest);
+    }
+
+    std::shared_ptr<Asm> operator()(const AsmImulImm& imul) {
+      auto src = fix_pseudo(imul.src.get());
+      auto dest = fix_pseudo(imul.dest.get());
+
+      if (std::holds_alternative<AsmStack>(*dest)) {
+        // imull $3, -4(%rbp), %r11d
+        // movl %r11d, -8(%rbp)
+        auto reg = make_asm<AsmRegister>(AsmReg::R11);
+        add_inst<AsmImulImm>(instructions_, imul.value, src, reg);
+        return make_add_and_return<AsmMov>(instructions_, reg, dest);
+      }
+      return make_add_and_return<AsmImulImm>(instructions_, imul.value, src,
+                                             dest);
+    }
+
+    std::shared_ptr<Asm> operator()(const AsmShift& shift) {
+      auto operand = fix_pseudo(shift.operand.get());
+      return make_add_and_return<AsmShift>(instructions_, shift.op,
+                                           shift.count, operand);
+    }
+
+    std::shared_ptr<Asm> operator()(const AsmImulHi& imul) {
+      auto operand = fix_pseudo(imul.operand.get());
+
+      if (std::holds_alternative<AsmImm>(*operand)) {
+        // movl $3, %r10d
+        // imull %r10d
+        auto reg = make_asm<AsmRegister>(AsmReg::R10);
+        add_inst<AsmMov>(instructions_, operand, reg);
+        return make_add_and_return<AsmImulHi>(instructions_, reg);
+      }
+      return make_add_and_return<AsmImulHi>(instructions_, operand);
+    }
+
     std::shared_ptr<Asm> operator()(const AsmIdiv& idiv) {
       // shouldn't be anything other than a single instruction
       auto operand = fix_pseudo(idiv.operand.get());
@@ -151,7 +309,8 @@ std::shared_ptr<Asm> AsmGen::replace_pseudo_regs(Asm* prog) {
     }
 
     std::shared_ptr<Asm> operator()(const AsmJmpCC& jmp) {
-      return make_add_and_return<AsmJmpCC>(instructions_, jmp.cond_code, jmp.target);
+      return make_add_and_return<AsmJmpCC>(instructions_, jmp.cond_code,
+                                           jmp.target, jmp.prob);
     }
 
     std::shared_ptr<Asm> operator()(const AsmSetCC& setcc) {
@@ -159,6 +318,37 @@ std::shared_ptr<Asm> AsmGen::replace_pseudo_regs(Asm* prog) {
       return make_add_and_return<AsmSetCC>(instructions_, setcc.cond_code, operand);
     }
 
+    std::shared_ptr<Asm> operator()(const AsmCMovCC& cmov) {
+      auto src = fix_pseudo(cmov.src.get());
+      auto dest = fix_pseudo(cmov.dest.get());
+
+      // cmov takes no immediate and only writes a register
+      if (std::holds_alternative<AsmImm>(*src)) {
+        auto reg = make_asm<AsmRegister>(AsmReg::R10);
+        add_inst<AsmMov>(instructions_, src, reg);
+        src = reg;
+      }
+      if (std::holds_alternative<AsmStack>(*dest)) {
+        // movl -4(%rbp), %r11d
+        // cmovl -8(%rbp), %r11d
+        // movl %r11d, -4(%rbp)
+        auto reg = make_asm<AsmRegister>(AsmReg::R11);
+        add_inst<AsmMov>(instructions_, dest, reg);
+        add_inst<AsmCMovCC>(instructions_, cmov.cond_code, src, reg);
+        return make_add_and_return<AsmMov>(instructions_, reg, dest);
+      }
+      return make_add_and_return<AsmCMovCC>(instructions_, cmov.cond_code, src, dest);
+    }
+
+    std::shared_ptr<Asm> operator()(const AsmJumpTable& table) {
+      // the table is indexed with the zero-extended index in %r10
+      // movl -4(%rbp), %r10d
+      auto index = fix_pseudo(table.index.get());
+      auto reg = make_asm<AsmRegister>(AsmReg::R10);
+      add_inst<AsmMov>(instructions_, index, reg);
+      return make_add_and_return<AsmJumpTable>(instructions_, reg, table.targets);
+    }
+
     std::shared_ptr<Asm> operator()(const AsmLabel& label) {
       return make_add_and_return<AsmLabel>(instructions_, label.identifier);
     }
@@ -177,11 +367,30 @@ std::shared_ptr<Asm> AsmGen::replace_pseudo_regs(Asm* prog) {
       }
     }
 
+    std::shared_ptr<Asm> operator()(const AsmAlign&) {
+      assert(0);
+      return nullptr;
+    }
+
+    std::shared_ptr<Asm> operator()(const AsmSection&) {
+      assert(0);
+      return nullptr;
+    }
+
+    std::shared_ptr<Asm> operator()(const AsmCount& count) {
+      return make_add_and_return<AsmCount>(instructions_, count.counter);
+    }
+
     std::shared_ptr<Asm> operator()(const AsmAllocateStack&) {
       assert(0);
       return nullptr;
     }
 
+    std::shared_ptr<Asm> operator()(const AsmDeallocateStack&) {
+      assert(0);
+      return nullptr;
+    }
+
     std::shared_ptr<Asm> operator()(const AsmReturn& ret) {
       return make_add_and_return<AsmReturn>(instructions_, ret.dummy);
     }
@@ -229,10 +438,208 @@ std::shared_ptr<Asm> AsmGen::operator()(const TackyProgram& prog) {
 
 std::shared_ptr<Asm> AsmGen::operator()(const TackyFunction& fn) {
   instructions_.clear();
-  for (auto& p : fn.instructions) {
-    gen(p.get());
+  // a value read only by the instruction right after the one writing it
+  // never needs to be materialized, and unrolled copies may reuse its name
+  nonlocal_.clear();
+  pending_.clear();
+  for (size_t i = 0; i < fn.instructions.size(); ++i) {
+    auto prev = (i > 0) ? var_name(tacky_dest(*fn.instructions[i - 1])) : nullptr;
+    for (auto& src : tacky_srcs(*fn.instructions[i])) {
+      auto name = var_name(src);
+      if (name && (prev == nullptr || *prev != *name)) {
+        nonlocal_.insert(*name);
+      }
+    }
+  }
+  for (size_t i = 0; i < fn.instructions.size(); ++i) {
+    if (i + 1 < fn.instructions.size() &&
+        fuse_compare(*fn.instructions[i], *fn.instructions[i + 1])) {
+      ++i;
+      continue;
+    }
+    if (i + 1 < fn.instructions.size() &&
+        defer(*fn.instructions[i], *fn.instructions[i + 1])) {
+      auto& bin = std::get<TackyBinary>(*fn.instructions[i]);
+      pending_[std::get<TackyVar>(*bin.dest).identifier] = tree(bin);
+      continue;
+    }
+    gen(fn.instructions[i].get());
+  }
+
+  // pseudos left over by the allocator go on the stack later
+  RegAlloc regalloc(options_.alloc_regs);
+  auto allocated = regalloc.allocate(instructions_);
+  if (options_.stats) {
+    auto& stats = regalloc.stats();
+    fprintf(stderr, "%s: %d pseudos, %d in registers, %d spilled into %d "
+            "stack slots, frame %d bytes (%d without slot sharing)\n",
+            fn.name.lexeme.c_str(), stats.pseudos, stats.registers,
+            stats.spilled, stats.slots, stats.slots * 4, stats.spilled * 4);
+  }
+  return make_asm<AsmFunction>(fn.name, std::move(allocated), ".text");
+}
+
+AsmCondCode AsmGen::cond_code(TokenType op) {
+  switch (op) {
+    case TokenType::EQUAL_EQUAL:
+      return AsmCondCode::E;
+    case TokenType::BANG_EQUAL:
+      return AsmCondCode::NE;
+    case TokenType::GREATER:
+      return AsmCondCode::G;
+    case TokenType::GREATER_EQUAL:
+      return AsmCondCode::GE;
+    case TokenType::LESS:
+      return AsmCondCode::L;
+    case TokenType::LESS_EQUAL:
+      return AsmCondCode::LE;
+    default:
+      assert(0);
+      return AsmCondCode::E;
+  }
+}
+
+// condition code that holds exactly when cc does not
+AsmCondCode AsmGen::invert(AsmCondCode cc) {
+  switch (cc) {
+    case AsmCondCode::E: return AsmCondCode::NE;
+    case AsmCondCode::NE: return AsmCondCode::E;
+    case AsmCondCode::G: return AsmCondCode::LE;
+    case AsmCondCode::GE: return AsmCondCode::L;
+    case AsmCondCode::L: return AsmCondCode::GE;
+    case AsmCondCode::LE: return AsmCondCode::G;
+  }
+  return cc;
+}
+
+// condition code for the same comparison with the operands swapped
+AsmCondCode AsmGen::swap(AsmCondCode cc) {
+  switch (cc) {
+    case AsmCondCode::G: return AsmCondCode::L;
+    case AsmCondCode::GE: return AsmCondCode::LE;
+    case AsmCondCode::L: return AsmCondCode::G;
+    case AsmCondCode::LE: return AsmCondCode::GE;
+    default: return cc;
+  }
+}
+
+AsmCondCode AsmGen::gen_compare(const std::shared_ptr<Tacky>& src1,
+                                const std::shared_ptr<Tacky>& src2,
+                                AsmCondCode cc) {
+  auto const1 = std::get_if<TackyConstant>(src1.get());
+  auto const2 = std::get_if<TackyConstant>(src2.get());
+  if (const1 && !const2) {
+    // c REL x is x REL' c, with the immediate where cmpl takes it
+    return gen_compare(src2, src1, swap(cc));
   }
-  return make_asm<AsmFunction>(fn.name, std::move(instructions_));
+  if (const2 && const2->value == 0 && !const1) {
+    // Test(x, x)
+    auto operand = gen(src1.get());
+    add_inst<AsmTest>(instructions_, operand, operand);
+    return cc;
+  }
+  // Cmp(src2, src1)
+  add_inst<AsmCmp>(instructions_, gen(src2.get()), gen(src1.get()));
+  return cc;
+}
+
+bool AsmGen::defer(const Tacky& inst, const Tacky& next) const {
+  // t = a op b; d = t op' c, and nothing else reads t
+  auto arithmetic = [](const TackyBinary* bin) {
+    return bin && one_of(bin->op.type, {TokenType::PLUS, TokenType::MINUS,
+                                        TokenType::STAR});
+  };
+  auto bin = std::get_if<TackyBinary>(&inst);
+  auto user = std::get_if<TackyBinary>(&next);
+  if (!arithmetic(bin) || !arithmetic(user)) {
+    return false;
+  }
+  auto name = var_name(bin->dest);
+  if (name == nullptr || nonlocal_.contains(*name)) {
+    return false;
+  }
+  auto reads = [name](const std::shared_ptr<Tacky>& src) {
+    auto src_name = var_name(src);
+    return src_name && *src_name == *name;
+  };
+  // a tree cannot share the operand
+  return reads(user->src1) != reads(user->src2);
+}
+
+std::unique_ptr<TreeMatcher::Node> AsmGen::tree(const TackyBinary& bin) {
+  auto node = std::make_unique<TreeMatcher::Node>();
+  node->value = bin.dest;
+  node->op = bin.op.type;
+  node->left = tree(bin.src1);
+  node->right = tree(bin.src2);
+  return node;
+}
+
+std::unique_ptr<TreeMatcher::Node> AsmGen::tree(const std::shared_ptr<Tacky>& value) {
+  if (auto name = var_name(value)) {
+    auto it = pending_.find(*name);
+    if (it != pending_.end()) {
+      auto node = std::move(it->second);
+      pending_.erase(it);
+      return node;
+    }
+  }
+  auto leaf = std::make_unique<TreeMatcher::Node>();
+  leaf->value = value;
+  return leaf;
+}
+
+bool AsmGen::fuse_compare(const Tacky& inst, const Tacky& next) {
+  // c = a REL b; JumpIfZero|JumpIfNotZero(c, target) or Select(c, ...),
+  // nothing else reads c
+  std::shared_ptr<Tacky> condition, target;
+  bool jump_if_zero = false;
+  int prob = kUnknownProb;
+  auto select = std::get_if<TackySelect>(&next);
+  if (auto jz = std::get_if<TackyJumpIfZero>(&next)) {
+    condition = jz->condition;
+    target = jz->target;
+    jump_if_zero = true;
+    prob = jz->prob;
+  } else if (auto jnz = std::get_if<TackyJumpIfNotZero>(&next)) {
+    condition = jnz->condition;
+    target = jnz->target;
+    prob = jnz->prob;
+  } else if (select) {
+    condition = select->condition;
+  } else {
+    return false;
+  }
+  auto var = std::get_if<TackyVar>(condition.get());
+  if (var == nullptr || nonlocal_.contains(var->identifier)) {
+    return false;
+  }
+
+  AsmCondCode cc;
+  if (auto bin = std::get_if<TackyBinary>(&inst);
+      bin && isRelationalOp(bin->op.type) && bin->dest == condition) {
+    // Cmp(src2, src1)
+    // JmpCC(relational_operator, target)
+    cc = gen_compare(bin->src1, bin->src2, cond_code(bin->op.type));
+  } else if (auto unary = std::get_if<TackyUnary>(&inst);
+             unary && unary->op.type == TokenType::BANG &&
+             unary->dest == condition) {
+    // Cmp(Imm(0), src)
+    // JmpCC(E, target)
+    cc = gen_compare(unary->src, make_tacky<TackyConstant>(0), AsmCondCode::E);
+  } else {
+    return false;
+  }
+
+  if (select) {
+    gen_select(cc, *select);
+    return true;
+  }
+
+  // JumpIfZero takes the branch when the comparison is false
+  add_inst<AsmJmpCC>(instructions_, jump_if_zero ? invert(cc) : cc,
+                     get_label(target), prob);
+  return true;
 }
 
 std::shared_ptr<Asm> AsmGen::operator()(const TackyBinary& bin) {
@@ -243,37 +650,17 @@ std::shared_ptr<Asm> AsmGen::operator()(const TackyBinary& bin) {
 
   TokenType optype = bin.op.type;
   if (isRelationalOp(optype)) {
-    AsmCondCode cc = AsmCondCode::E;
-    switch (optype) {
-      case TokenType::EQUAL_EQUAL:
-        cc = AsmCondCode::E;
-        break;
-      case TokenType::BANG_EQUAL:
-        cc = AsmCondCode::NE;
-        break;
-      case TokenType::GREATER:
-        cc = AsmCondCode::G;
-        break;
-      case TokenType::GREATER_EQUAL:
-        cc = AsmCondCode::GE;
-        break;
-      case TokenType::LESS:
-        cc = AsmCondCode::L;
-        break;
-      case TokenType::LESS_EQUAL:
-        cc = AsmCondCode::LE;
-        break;
-      default:
-        assert(0);
-        break;
-    }
-
     // Cmp(src2, src1)
     // Mov(Imm(0), dst)
     // SetCC(relational_operator, dst)
-    add_inst<AsmCmp>(instructions_, src2, src1);
+    AsmCondCode cc = gen_compare(bin.src1, bin.src2, cond_code(optype));
     add_inst<AsmMov>(instructions_, make_asm<AsmImm>(0), dest);
     return make_add_and_return<AsmSetCC>(instructions_, cc, dest);
+  } else if (((optype == TokenType::SLASH) ||
+              (optype == TokenType::PERCENT)) &&
+             std::holds_alternative<TackyConstant>(*bin.src2) &&
+             gen_divide(bin, std::get<TackyConstant>(*bin.src2).value)) {
+    return nullptr;
   } else if ((optype == TokenType::SLASH) ||
       (optype == TokenType::PERCENT)) {
     // division and remainder
@@ -287,24 +674,152 @@ std::shared_ptr<Asm> AsmGen::operator()(const TackyBinary& bin) {
     add_inst<AsmIdiv>(instructions_, src2);
     return make_add_and_return<AsmMov>(instructions_, make_asm<AsmRegister>(reg), dest);
   } else { // everything else
-    // Mov(src1, dst)
-    // Binary(op, src2, dst)
-    add_inst<AsmMov>(instructions_, src1, dest);
-    return make_add_and_return<AsmBinary>(instructions_, bin.op, src2, dest);
+    // the tree of this and the pending instructions feeding it
+    TreeMatcher matcher(instructions_);
+    matcher.emit(*tree(bin));
   }
 
   return nullptr;
 }
 
+std::shared_ptr<Asm> AsmGen::temp() {
+  return make_asm<AsmPseudo>(std::format("asm.{}", next_temp_++));
+}
+
+// Multiplier and shift for signed division by d, |d| >= 2 and not a power
+// of two: q = hi32(m * x) (+ or - x when m has the wrong sign) >> s, plus
+// one if that is negative.
+static void magic(int d, int& multiplier, int& shift) {
+  const unsigned two31 = 0x80000000u;
+  unsigned ad = (d < 0) ? 0u - (unsigned)d : (unsigned)d;
+  unsigned t = two31 + ((unsigned)d >> 31);
+  // |nc|, the largest multiple of d minus one that fits
+  unsigned anc = t - 1 - t % ad;
+  int p = 31;
+  unsigned q1 = two31 / anc, r1 = two31 - q1 * anc;
+  unsigned q2 = two31 / ad, r2 = two31 - q2 * ad;
+  unsigned delta;
+  do {
+    ++p;
+    q1 *= 2;
+    r1 *= 2;
+    if (r1 >= anc) {
+      ++q1;
+      r1 -= anc;
+    }
+    q2 *= 2;
+    r2 *= 2;
+    if (r2 >= ad) {
+      ++q2;
+      r2 -= ad;
+    }
+    delta = ad - r2;
+  } while (q1 < delta || (q1 == delta && r1 == 0));
+  multiplier = (int)(q2 + 1);
+  if (d < 0) {
+    multiplier = -multiplier;
+  }
+  shift = p - 32;
+}
+
+bool AsmGen::gen_divide(const TackyBinary& bin, int divisor) {
+  if (divisor == 0) {
+    return false;
+  }
+  auto x = gen(bin.src1.get());
+  auto dest = gen(bin.dest.get());
+  bool remainder = bin.op.type == TokenType::PERCENT;
+  auto imm = [](int value) { return make_asm<AsmImm>(value); };
+
+  if (divisor == 1 || divisor == -1) {
+    // x % 1 == 0, x / 1 == x, x / -1 == -x
+    if (remainder) {
+      add_inst<AsmMov>(instructions_, imm(0), dest);
+    } else {
+      add_inst<AsmMov>(instructions_, x, dest);
+      if (divisor == -1) {
+        add_inst<AsmUnary>(instructions_, make_op(TokenType::MINUS), dest);
+      }
+    }
+    return true;
+  }
+
+  unsigned magnitude = (divisor < 0) ? 0u - (unsigned)divisor : divisor;
+  if ((magnitude & (magnitude - 1)) == 0) {
+    // |d| = 2^k: bias a negative x by 2^k - 1 so the shift rounds to zero
+    // Mov(x, t)
+    // Shift(SAR, 31, t)      (k > 1)
+    // Shift(SHR, 32 - k, t)
+    // Binary(+, x, t)
+    int k = std::countr_zero(magnitude);
+    auto t = temp();
+    add_inst<AsmMov>(instructions_, x, t);
+    if (k > 1) {
+      add_inst<AsmShift>(instructions_, AsmShiftOp::SAR, 31, t);
+    }
+    add_inst<AsmShift>(instructions_, AsmShiftOp::SHR, 32 - k, t);
+    add_inst<AsmBinary>(instructions_, make_op(TokenType::PLUS), x, t);
+    if (remainder) {
+      // x - (t & -2^k)
+      add_inst<AsmBinary>(instructions_, make_op(TokenType::AMPERSAND),
+                          imm(-(int)(magnitude - 1) - 1), t);
+      add_inst<AsmMov>(instructions_, x, dest);
+      add_inst<AsmBinary>(instructions_, make_op(TokenType::MINUS), t, dest);
+    } else {
+      // t >> k, negated for d < 0
+      add_inst<AsmShift>(instructions_, AsmShiftOp::SAR, k, t);
+      if (divisor < 0) {
+        add_inst<AsmUnary>(instructions_, make_op(TokenType::MINUS), t);
+      }
+      add_inst<AsmMov>(instructions_, t, dest);
+    }
+    return true;
+  }
+
+  // Mov(Imm(m), Reg(AX))
+  // ImulHi(x)
+  // Mov(Reg(DX), q)
+  // Binary(+|-, x, q)         (m and d of different signs)
+  // Shift(SAR, s, q)
+  // q += q >>> 31
+  int multiplier, shift;
+  magic(divisor, multiplier, shift);
+  auto q = temp(), sign = temp();
+  add_inst<AsmMov>(instructions_, imm(multiplier), make_asm<AsmRegister>(AsmReg::AX));
+  add_inst<AsmImulHi>(instructions_, x);
+  add_inst<AsmMov>(instructions_, make_asm<AsmRegister>(AsmReg::DX), q);
+  if (divisor > 0 && multiplier < 0) {
+    add_inst<AsmBinary>(instructions_, make_op(TokenType::PLUS), x, q);
+  } else if (divisor < 0 && multiplier > 0) {
+    add_inst<AsmBinary>(instructions_, make_op(TokenType::MINUS), x, q);
+  }
+  if (shift > 0) {
+    add_inst<AsmShift>(instructions_, AsmShiftOp::SAR, shift, q);
+  }
+  add_inst<AsmMov>(instructions_, q, sign);
+  add_inst<AsmShift>(instructions_, AsmShiftOp::SHR, 31, sign);
+  add_inst<AsmBinary>(instructions_, make_op(TokenType::PLUS), sign, q);
+  if (remainder) {
+    // x - q * d
+    add_inst<AsmImulImm>(instructions_, divisor, q, q);
+    add_inst<AsmMov>(instructions_, x, dest);
+    add_inst<AsmBinary>(instructions_, make_op(TokenType::MINUS), q, dest);
+  } else {
+    add_inst<AsmMov>(instructions_, q, dest);
+  }
+  return true;
+}
+
 std::shared_ptr<Asm> AsmGen::operator()(const TackyUnary& unary) {
   // src and dest can only be constants or var
   auto src = gen(unary.src.get());
   auto dest = gen(unary.dest.get());
 
   if (unary.op.type == TokenType::BANG) {
-    add_inst<AsmCmp>(instructions_, make_asm<AsmImm>(0), src);
+    auto cc = gen_compare(unary.src, make_tacky<TackyConstant>(0),
+                          AsmCondCode::E);
     add_inst<AsmMov>(instructions_, make_asm<AsmImm>(0), dest);
-    return make_add_and_return<AsmSetCC>(instructions_, AsmCondCode::E, dest);
+    return make_add_and_return<AsmSetCC>(instructions_, cc, dest);
   } else {
     add_inst<AsmMov>(instructions_, src, dest);
     return make_add_and_return<AsmUnary>(instructions_, unary.op, dest);
@@ -349,17 +864,66 @@ std::shared_ptr<Asm> AsmGen::operator()(const TackyJump& jmp) {
 }
 
 std::shared_ptr<Asm> AsmGen::operator()(const TackyJumpIfZero& jmp) {
-  auto cond = gen(jmp.condition.get());
   auto target = get_label(jmp.target);
-  add_inst<AsmCmp>(instructions_, make_asm<AsmImm>(0), cond);
-  return make_add_and_return<AsmJmpCC>(instructions_, AsmCondCode::E, target);
+  auto cc = gen_compare(jmp.condition, make_tacky<TackyConstant>(0),
+                        AsmCondCode::E);
+  return make_add_and_return<AsmJmpCC>(instructions_, cc, target, jmp.prob);
 }
 
 std::shared_ptr<Asm> AsmGen::operator()(const TackyJumpIfNotZero& jmp) {
-  auto cond = gen(jmp.condition.get());
   auto target = get_label(jmp.target);
-  add_inst<AsmCmp>(instructions_, make_asm<AsmImm>(0), cond);
-  return make_add_and_return<AsmJmpCC>(instructions_, AsmCondCode::NE, target);
+  auto cc = gen_compare(jmp.condition, make_tacky<TackyConstant>(0),
+                        AsmCondCode::NE);
+  return make_add_and_return<AsmJmpCC>(instructions_, cc, target, jmp.prob);
+}
+
+std::shared_ptr<Asm> AsmGen::operator()(const TackyJumpTable& table) {
+  auto index = gen(table.index.get());
+  std::vector<std::shared_ptr<Asm>> targets;
+  for (auto& target : table.targets) {
+    targets.push_back(get_label(target));
+  }
+  return make_add_and_return<AsmJumpTable>(instructions_, index, targets);
+}
+
+std::shared_ptr<Asm> AsmGen::operator()(const TackyCount& count) {
+  return make_add_and_return<AsmCount>(instructions_, count.counter);
+}
+
+void AsmGen::gen_select(AsmCondCode cc, const TackySelect& select) {
+  auto src1 = gen(select.src1.get());
+  auto src2 = gen(select.src2.get());
+  auto dest = gen(select.dest.get());
+  auto same = [&select](const std::shared_ptr<Tacky>& src) {
+    auto var = std::get_if<TackyVar>(src.get());
+    return var && var->identifier ==
+      std::get<TackyVar>(*select.dest).identifier;
+  };
+
+  // moves leave the flags alone
+  if (same(select.src1)) {
+    // CMovCC(!cc, src2, dst)
+    if (!same(select.src2)) {
+      add_inst<AsmCMovCC>(instructions_, invert(cc), src2, dest);
+    }
+  } else if (same(select.src2)) {
+    // CMovCC(cc, src1, dst)
+    add_inst<AsmCMovCC>(instructions_, cc, src1, dest);
+  } else {
+    // Mov(src2, dst)
+    // CMovCC(cc, src1, dst)
+    add_inst<AsmMov>(instructions_, src2, dest);
+    add_inst<AsmCMovCC>(instructions_, cc, src1, dest);
+  }
+}
+
+std::shared_ptr<Asm> AsmGen::operator()(const TackySelect& select) {
+  // Cmp(Imm(0), c)
+  // <select on NE>
+  auto cc = gen_compare(select.condition, make_tacky<TackyConstant>(0),
+                        AsmCondCode::NE);
+  gen_select(cc, select);
+  return nullptr;
 }
 
 std::shared_ptr<Asm> AsmGen::operator()(const TackyLabel& label) {
@@ -2,6 +2,7 @@
 #include <fstream>
 #include <iostream>
 #include <string>
+#include <tuple>
 #include <vector>
 
 namespace ccomp {
@@ -181,6 +182,7 @@ int main(int argc, char **argv) {
          "BinaryExpr      : std::unique_ptr<Expr> left, Token Operator, std::unique_ptr<Expr> right",
          "LiteralExpr     : TokenType type, std::string value",
          "UnaryExpr       : Token Operator, std::unique_ptr<Expr> right",
+         "Expect          : Token keyword, std::unique_ptr<Expr> value, std::unique_ptr<Expr> expected, bool expect_true",
          "Variable        : Token name, int level"},
         {},
         {"\"Token.h\"", "<memory>", "<string>", "<variant>"}};
@@ -200,7 +202,10 @@ int main(int argc, char **argv) {
             "Decl       : std::unique_ptr<Expr> name, std::unique_ptr<Expr> init",
             "Null       : Token loc",
             "Break     : Token loc, int loop_label",
-            "Continue  : Token loc, int loop_label"},
+            "Continue  : Token loc, int loop_label",
+            "Switch     : Token loc, std::unique_ptr<Expr> condition, std::unique_ptr<Stmt> body, int loop_label, std::vector<int> cases, bool has_default",
+            "Case       : Token loc, std::unique_ptr<Expr> value, std::unique_ptr<Stmt> body, int loop_label, int index",
+            "Default    : Token loc, std::unique_ptr<Stmt> body, int loop_label"},
         {},
         {"\"Token.h\"", "\"Expr.h\"", "<memory>", "<vector>", "<variant>"}};
     AstGen stmtGenerator(outDir, stmtSpec);
@@ -217,9 +222,12 @@ int main(int argc, char **argv) {
             "TackyReturn : std::shared_ptr<Tacky> value",
             "TackyCopy : std::shared_ptr<Tacky> src, std::shared_ptr<Tacky> dest",
             "TackyJump : std::shared_ptr<Tacky> target",
-            "TackyJumpIfZero : std::shared_ptr<Tacky> condition, std::shared_ptr<Tacky> target",
-            "TackyJumpIfNotZero : std::shared_ptr<Tacky> condition, std::shared_ptr<Tacky> target",
-            "TackyLabel : std::string identifier"},
+            "TackyJumpIfZero : std::shared_ptr<Tacky> condition, std::shared_ptr<Tacky> target, int prob",
+            "TackyJumpIfNotZero : std::shared_ptr<Tacky> condition, std::shared_ptr<Tacky> target, int prob",
+            "TackyLabel : std::string identifier",
+            "TackySelect : std::shared_ptr<Tacky> condition, std::shared_ptr<Tacky> src1, std::shared_ptr<Tacky> src2, std::shared_ptr<Tacky> dest",
+            "TackyJumpTable : std::shared_ptr<Tacky> index, std::vector<std::shared_ptr<Tacky>> targets",
+            "TackyCount : int counter"},
         {},
         {"\"Token.h\"", "<memory>", "<string>", "<vector>", "<variant>"}};
     AstGen tackyGenerator(outDir, tackySpec);
@@ -228,25 +236,37 @@ int main(int argc, char **argv) {
     const AstSpecification asmSpec = {
         "Asm",
         {"AsmProgram     : std::vector<std::shared_ptr<Asm>> functions",
-                "AsmFunction    : Token name, std::vector<std::shared_ptr<Asm>> instructions",
+                "AsmFunction    : Token name, std::vector<std::shared_ptr<Asm>> instructions, std::string section",
                 "AsmUnary       : Token op, std::shared_ptr<Asm> operand",
                 "AsmBinary      : Token op, std::shared_ptr<Asm> operand1, std::shared_ptr<Asm> operand2",
                 "AsmCmp         : std::shared_ptr<Asm> operand1, std::shared_ptr<Asm> operand2",
+                "AsmTest        : std::shared_ptr<Asm> operand1, std::shared_ptr<Asm> operand2",
+                "AsmLea         : std::shared_ptr<Asm> base, std::shared_ptr<Asm> index, int scale, int disp, std::shared_ptr<Asm> dest",
+                "AsmImulImm     : int value, std::shared_ptr<Asm> src, std::shared_ptr<Asm> dest",
+                "AsmShift       : AsmShiftOp op, int count, std::shared_ptr<Asm> operand",
+                "AsmImulHi      : std::shared_ptr<Asm> operand",
                 "AsmIdiv        : std::shared_ptr<Asm> operand",
                 "AsmCdq         : int dummy",
                 "AsmJmp         : std::shared_ptr<Asm> target",
-                "AsmJmpCC       : AsmCondCode cond_code, std::shared_ptr<Asm> target",
+                "AsmJmpCC       : AsmCondCode cond_code, std::shared_ptr<Asm> target, int prob",
                 "AsmSetCC       : AsmCondCode cond_code, std::shared_ptr<Asm> operand",
+                "AsmCMovCC      : AsmCondCode cond_code, std::shared_ptr<Asm> src, std::shared_ptr<Asm> dest",
+                "AsmJumpTable   : std::shared_ptr<Asm> index, std::vector<std::shared_ptr<Asm>> targets",
                 "AsmLabel      : std::string identifier",
+                "AsmAlign       : int log2, int max_skip",
+                "AsmSection     : std::string name, std::string symbol",
+                "AsmCount       : int counter",
                 "AsmMov         : std::shared_ptr<Asm> src, std::shared_ptr<Asm> dest",
                 "AsmAllocateStack : int size",
+                "AsmDeallocateStack : int size",
                 "AsmReturn      : int dummy",
                 "AsmImm         : int value",
                 "AsmRegister    : AsmReg reg",
                 "AsmPseudo      : std::string identifier",
                 "AsmStack       : int offset"},
         {{"CondCode", {"E", "NE", "G", "GE", "L", "LE"}},
-                {"Reg", {"AX", "DX", "R10", "R11"}}},
+                {"Reg", {"AX", "CX", "DX", "SI", "DI", "R8", "R9", "R10", "R11"}},
+                {"ShiftOp", {"SAL", "SAR", "SHR"}}},
         {"\"Token.h\"", "<memory>", "<vector>", "<string>", "<variant>"}};
     AstGen asmGenerator(outDir, asmSpec);
     asmGenerator.generate();
@@ -0,0 +1,393 @@
+#include "BlockLayout.h"
+#include "AsmCFG.h"
+#include "TackyCFG.h"
+#include "Util.h"
+#include <algorithm>
+#include <unordered_map>
+
+using namespace ccomp;
+
+// Ball and Larus, "Branch Prediction for Free": how likely a conditional
+// branch goes the way each heuristic predicts
+static const double kBackEdgeProb = 0.88;
+static const double kLoopStayProb = 0.80;
+static const double kAvoidReturnProb = 0.72;
+// An edge at most this likely leads to cold code: __builtin_expect gives the
+// other side 90%, and a return of a negative error code is as unlikely.
+static const double kColdProb = 0.10;
+// assumed iterations of every loop
+static const double kLoopScale = 8;
+// Falling through in place of an unconditional jump removes an instruction,
+// so such edges win ties; a loop whose latch jumps back to its exit test is
+// rotated to test at the bottom.
+static const double kJumpBonus = 1.01;
+// .p2align 4,,10 as gcc does: 16-byte alignment unless that needs more
+// than 10 bytes of padding
+static const int kLoopAlign = 4;
+static const int kLoopMaxSkip = 10;
+
+BlockLayout::BlockLayout(std::vector<std::shared_ptr<Asm>>& instructions,
+                         const std::string& name, bool split) :
+  instructions_(instructions), name_(name), split_(split), cfg_(instructions)
+{}
+
+void BlockLayout::run() {
+  split();
+  if (blocks_.size() < 2) {
+    return;
+  }
+  find_loops();
+  weigh();
+  classify();
+
+  std::vector<int> original(blocks_.size());
+  for (size_t b = 0; b < blocks_.size(); ++b) {
+    original[b] = b;
+  }
+  // the greedy placement can lose to the source order; keep the better one
+  auto order = place();
+  auto source = original;
+  if (split_) {
+    auto hot = [this](int b) { return !cold_[b]; };
+    std::stable_partition(source.begin(), source.end(), hot);
+    std::stable_partition(order.begin(), order.end(), hot);
+  }
+  taken_ = {taken(original, false), taken(order, split_)};
+  if (taken(source, split_) <= taken_.second) {
+    order = source;
+    taken_.second = taken(source, split_);
+  }
+  emit(order);
+}
+
+std::pair<double, double> BlockLayout::taken_branches() const {
+  return taken_;
+}
+
+bool BlockLayout::hot() const {
+  return !loops_.empty();
+}
+
+int BlockLayout::cold_blocks() const {
+  return split_ ? std::count(cold_.begin(), cold_.end(), true) : 0;
+}
+
+void BlockLayout::split() {
+  for (auto& from : cfg_.blocks) {
+    Block block;
+    for (size_t i = from.begin; i < from.body; ++i) {
+      if (auto label = std::get_if<AsmLabel>(instructions_[i].get())) {
+        block.labels.push_back(label->identifier);
+      }
+    }
+    block.body.assign(instructions_.begin() + from.body,
+                      instructions_.begin() + from.end);
+    block.fall = from.fall;
+    block.succs = from.succs;
+    blocks_.push_back(std::move(block));
+  }
+}
+
+void BlockLayout::find_loops() {
+  std::unordered_map<int, size_t> header_to_loop;
+  for (int block : cfg_.rpo) {
+    for (int succ : blocks_[block].succs) {
+      if (!cfg_.dominates(succ, block)) {
+        continue;
+      }
+      // back edge block -> succ: the natural loop is everything reaching
+      // block without passing through succ
+      auto [it, inserted] = header_to_loop.insert({succ, loops_.size()});
+      if (inserted) {
+        Loop loop{succ, std::vector<bool>(blocks_.size(), false), 1};
+        loop.contains[succ] = true;
+        loops_.push_back(std::move(loop));
+      }
+      auto& loop = loops_[it->second];
+      std::vector<int> worklist = {block};
+      while (!worklist.empty()) {
+        int cur = worklist.back();
+        worklist.pop_back();
+        if (loop.contains[cur]) {
+          continue;
+        }
+        loop.contains[cur] = true;
+        ++loop.size;
+        for (int pred : cfg_.preds[cur]) {
+          worklist.push_back(pred);
+        }
+      }
+    }
+  }
+
+  innermost_.assign(blocks_.size(), -1);
+  for (size_t l = 0; l < loops_.size(); ++l) {
+    for (size_t b = 0; b < blocks_.size(); ++b) {
+      int cur = innermost_[b];
+      if (loops_[l].contains[b] &&
+          (cur == -1 || loops_[l].size < loops_[cur].size)) {
+        innermost_[b] = l;
+      }
+    }
+  }
+}
+
+double BlockLayout::taken_probability(int block, int taken) const {
+  // a hint from __builtin_expect overrides the heuristics
+  auto& jmpcc = std::get<AsmJmpCC>(*blocks_[block].body.back());
+  if (jmpcc.prob != kUnknownProb) {
+    return jmpcc.prob / 100.0;
+  }
+  int fall = blocks_[block].fall;
+  auto back = [this, block](int succ) { return cfg_.dominates(succ, block); };
+  auto exits = [this, block](int succ) {
+    int loop = innermost_[block];
+    return loop != -1 && !loops_[loop].contains[succ];
+  };
+  auto returns = [this](int succ) {
+    auto& body = blocks_[succ].body;
+    return !body.empty() && std::holds_alternative<AsmReturn>(*body.back());
+  };
+
+  if (returns_error(taken) != returns_error(fall)) {
+    return returns_error(taken) ? kColdProb : 1 - kColdProb;
+  } else if (back(taken) != back(fall)) {
+    return back(taken) ? kBackEdgeProb : 1 - kBackEdgeProb;
+  } else if (exits(taken) != exits(fall)) {
+    return exits(taken) ? 1 - kLoopStayProb : kLoopStayProb;
+  } else if (returns(taken) != returns(fall)) {
+    return returns(taken) ? 1 - kAvoidReturnProb : kAvoidReturnProb;
+  }
+  return 0.5;
+}
+
+// whether block returns a negative constant, an error code
+bool BlockLayout::returns_error(int block) const {
+  auto& body = blocks_[block].body;
+  if (body.size() < 2 || !std::holds_alternative<AsmReturn>(*body.back())) {
+    return false;
+  }
+  // the epilogue may come between the result and the ret
+  size_t at = body.size() - 2;
+  if (at > 0 && std::holds_alternative<AsmDeallocateStack>(*body[at])) {
+    --at;
+  }
+  auto mov = std::get_if<AsmMov>(body[at].get());
+  if (mov == nullptr || !std::holds_alternative<AsmImm>(*mov->src)) {
+    return false;
+  }
+  auto reg = std::get_if<AsmRegister>(mov->dest.get());
+  return reg && reg->reg == AsmReg::AX && std::get<AsmImm>(*mov->src).value < 0;
+}
+
+// Blocks the entry reaches without an unlikely conditional edge are hot,
+// the rest cold.
+void BlockLayout::classify() {
+  cold_.assign(blocks_.size(), true);
+  cold_[0] = false;
+  std::vector<int> worklist = {0};
+  while (!worklist.empty()) {
+    int b = worklist.back();
+    worklist.pop_back();
+    auto& block = blocks_[b];
+    bool conditional = block.succs.size() == 2 && block.fall != -1;
+    for (size_t i = 0; i < block.succs.size(); ++i) {
+      int succ = block.succs[i];
+      if (cold_[succ] && !(conditional && block.probs[i] <= kColdProb)) {
+        cold_[succ] = false;
+        worklist.push_back(succ);
+      }
+    }
+  }
+}
+
+void BlockLayout::weigh() {
+  for (size_t b = 0; b < blocks_.size(); ++b) {
+    auto& block = blocks_[b];
+    size_t count = block.succs.size();
+    if (count == 2 && block.fall != -1 &&
+        std::holds_alternative<AsmJmpCC>(*block.body.back())) {
+      double taken = taken_probability(b, block.succs[1]);
+      block.probs = {1 - taken, taken};
+    } else {
+      block.probs.assign(count, 1.0 / count);
+    }
+  }
+
+  // Propagate frequencies in reverse postorder, over forward edges only.
+  // A loop header runs kLoopScale times per entry.
+  std::vector<bool> header(blocks_.size(), false);
+  for (auto& loop : loops_) {
+    header[loop.header] = true;
+  }
+  for (int b : cfg_.rpo) {
+    double freq = (b == 0) ? 1 : 0;
+    for (int pred : cfg_.preds[b]) {
+      if (cfg_.dominates(b, pred)) {
+        continue;
+      }
+      auto& from = blocks_[pred];
+      for (size_t i = 0; i < from.succs.size(); ++i) {
+        if (from.succs[i] == b) {
+          freq += from.freq * from.probs[i];
+        }
+      }
+    }
+    blocks_[b].freq = header[b] ? freq * kLoopScale : freq;
+  }
+}
+
+std::vector<int> BlockLayout::place() const {
+  struct Edge {
+    int from, to;
+    double weight;
+    double prob;
+  };
+  std::vector<Edge> edges;
+  for (size_t b = 0; b < blocks_.size(); ++b) {
+    auto& block = blocks_[b];
+    auto& body = block.body;
+    // only jumps and fallthroughs can become fallthroughs
+    if (!body.empty() && std::holds_alternative<AsmJumpTable>(*body.back())) {
+      continue;
+    }
+    double bonus = (block.succs.size() == 1) ? kJumpBonus : 1;
+    for (size_t i = 0; i < block.succs.size(); ++i) {
+      edges.push_back({(int)b, block.succs[i],
+                       block.freq * block.probs[i] * bonus, block.probs[i]});
+    }
+  }
+  std::stable_sort(edges.begin(), edges.end(), [](auto& a, auto& b) {
+    return a.weight > b.weight;
+  });
+
+  // Grow chains along the heaviest edges; the entry block stays first. An
+  // unlikely successor never falls through, even when the likely one went
+  // to another chain, so it stays out of the hot path.
+  std::vector<std::vector<int>> chains(blocks_.size());
+  std::vector<int> chain_of(blocks_.size());
+  for (size_t b = 0; b < blocks_.size(); ++b) {
+    chains[b] = {(int)b};
+    chain_of[b] = b;
+  }
+  for (auto& edge : edges) {
+    int from = chain_of[edge.from], to = chain_of[edge.to];
+    if (from == to || edge.to == 0 || chains[from].back() != edge.from ||
+        chains[to].front() != edge.to || edge.prob < 0.5) {
+      continue;
+    }
+    for (int b : chains[to]) {
+      chains[from].push_back(b);
+      chain_of[b] = from;
+    }
+    chains[to].clear();
+  }
+
+  // then place the chain most jumped to from what is placed already
+  std::vector<int> order;
+  std::vector<bool> placed(blocks_.size(), false);
+  int next = chain_of[0];
+  while (next != -1) {
+    for (int b : chains[next]) {
+      order.push_back(b);
+      placed[b] = true;
+    }
+    chains[next].clear();
+
+    std::vector<double> pull(blocks_.size(), 0);
+    for (auto& edge : edges) {
+      if (placed[edge.from] && !placed[edge.to]) {
+        pull[chain_of[edge.to]] += edge.weight;
+      }
+    }
+    next = -1;
+    for (size_t c = 0; c < chains.size(); ++c) {
+      if (!chains[c].empty() && (next == -1 || pull[c] > pull[next])) {
+        next = c;
+      }
+    }
+  }
+  return order;
+}
+
+double BlockLayout::taken(const std::vector<int>& order, bool split) const {
+  double total = 0;
+  for (size_t k = 0; k < order.size(); ++k) {
+    auto& block = blocks_[order[k]];
+    int next = (k + 1 < order.size()) ? order[k + 1] : -1;
+    if (next != -1 && split && cold_[next] != cold_[order[k]]) {
+      next = -1;
+    }
+    for (size_t i = 0; i < block.succs.size(); ++i) {
+      if (block.succs[i] != next) {
+        total += block.freq * block.probs[i];
+      }
+    }
+  }
+  return total;
+}
+
+void BlockLayout::emit(const std::vector<int>& order) {
+  // nothing falls through between the hot and cold parts
+  std::vector<int> next(blocks_.size(), -1);
+  for (size_t k = 0; k + 1 < order.size(); ++k) {
+    if (!split_ || cold_[order[k]] == cold_[order[k + 1]]) {
+      next[order[k]] = order[k + 1];
+    }
+  }
+  // blocks reached by a jump the new layout adds need a label
+  for (int b : order) {
+    int fall = blocks_[b].fall;
+    if (fall != -1 && next[b] != fall && blocks_[fall].labels.empty()) {
+      blocks_[fall].labels.push_back(TackyCFG::unique_label("layout"));
+    }
+  }
+  auto label = [this](int block) {
+    return make_asm<AsmLabel>(blocks_[block].labels.front());
+  };
+
+  std::vector<bool> aligned(blocks_.size(), false);
+  for (auto& loop : loops_) {
+    auto first = std::find_if(order.begin(), order.end(), [&loop](int b) {
+      return loop.contains[b];
+    });
+    aligned[*first] = true;
+  }
+
+  instructions_.clear();
+  bool hot = true;
+  for (int b : order) {
+    auto& block = blocks_[b];
+    if (split_ && hot && cold_[b]) {
+      add_inst<AsmSection>(instructions_, ".text.unlikely", name_ + ".cold");
+      hot = false;
+    }
+    if (aligned[b]) {
+      add_inst<AsmAlign>(instructions_, kLoopAlign, kLoopMaxSkip);
+    }
+    for (auto& name : block.labels) {
+      add_inst<AsmLabel>(instructions_, name);
+    }
+    instructions_.insert(instructions_.end(), block.body.begin(),
+                         block.body.end());
+    auto last = block.body.empty() ? nullptr : block.body.back().get();
+    if (last == nullptr || !ends_block(*last)) {
+      if (block.fall != -1 && next[b] != block.fall) {
+        add_inst<AsmJmp>(instructions_, label(block.fall));
+      }
+    } else if (std::holds_alternative<AsmJmp>(*last)) {
+      if (next[b] == block.succs[0]) {
+        instructions_.pop_back();
+      }
+    } else if (auto jmpcc = std::get_if<AsmJmpCC>(last);
+               jmpcc && block.fall != -1 && next[b] != block.fall) {
+      if (next[b] == block.succs[1]) {
+        instructions_.back() = make_asm<AsmJmpCC>(invert(jmpcc->cond_code),
+                                                  label(block.fall),
+                                                  invert_prob(jmpcc->prob));
+      } else {
+        add_inst<AsmJmp>(instructions_, label(block.fall));
+      }
+    }
+  }
+}
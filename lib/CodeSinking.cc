@@ -0,0 +1,176 @@
+#include "CodeSinking.h"
+#include "Util.h"
+#include <algorithm>
+
+using namespace ccomp;
+
+CodeSinking::CodeSinking(TackyCFG& cfg) : cfg_(cfg)
+{}
+
+bool CodeSinking::run() {
+  defs_.clear();
+  uses_.clear();
+  for (size_t b = 0; b < cfg_.blocks.size(); ++b) {
+    auto& insts = cfg_.blocks[b].instructions;
+    for (size_t i = 0; i < insts.size(); ++i) {
+      if (auto dest = var_name(tacky_dest(*insts[i]))) {
+        defs_[*dest].push_back({b, i});
+      }
+      for (auto& src : tacky_srcs(*insts[i])) {
+        if (auto name = var_name(src)) {
+          uses_[*name].push_back(b);
+        }
+      }
+    }
+  }
+
+  // Users before the values they read, so whole expressions sink together.
+  // A block's targets come after it in reverse postorder, so they were
+  // swept already. Moving an instruction only shifts the ones after it in
+  // its block, which keeps the order of the recorded indices, so the maps
+  // are only updated for the instruction that moved.
+  bool changed = false;
+  for (auto it = cfg_.rpo.rbegin(); it != cfg_.rpo.rend(); ++it) {
+    auto& insts = cfg_.blocks[*it].instructions;
+    for (int i = insts.size() - 1; i >= 0; --i) {
+      int target = sink_target(*it, i);
+      if (target < 0) {
+        continue;
+      }
+      auto inst = insts[i];
+      insts.erase(insts.begin() + i);
+      auto& dest = cfg_.blocks[target].instructions;
+      dest.insert(dest.begin(), inst);
+      changed = true;
+
+      defs_[*var_name(tacky_dest(*inst))] = {{target, 0}};
+      for (auto& src : tacky_srcs(*inst)) {
+        if (auto name = var_name(src)) {
+          auto& uses = uses_[*name];
+          *std::find(uses.begin(), uses.end(), *it) = target;
+        }
+      }
+    }
+  }
+  return changed;
+}
+
+int CodeSinking::sink_target(int block, int index) const {
+  auto& inst = cfg_.blocks[block].instructions[index];
+  if (!std::holds_alternative<TackyUnary>(*inst) &&
+      !std::holds_alternative<TackyBinary>(*inst) &&
+      !std::holds_alternative<TackyCopy>(*inst)) {
+    return -1;
+  }
+  if (auto bin = std::get_if<TackyBinary>(inst.get());
+      bin && one_of(bin->op.type, {TokenType::SLASH, TokenType::PERCENT})) {
+    auto divisor = std::get_if<TackyConstant>(bin->src2.get());
+    if (divisor == nullptr || divisor->value == 0 || divisor->value == -1) {
+      return -1;
+    }
+  }
+
+  // a value with a single definition, read only in blocks below this one
+  auto dest = var_name(tacky_dest(*inst));
+  auto srcs = tacky_srcs(*inst);
+  auto uses = uses_.find(*dest);
+  if (defs_.at(*dest).size() != 1 || uses == uses_.end()) {
+    return -1;
+  }
+  for (auto& src : srcs) {
+    if (auto name = var_name(src); name && *name == *dest) {
+      return -1;
+    }
+  }
+  int target = -1;
+  for (int use : uses->second) {
+    if (use == block || !cfg_.dominates(block, use)) {
+      return -1;
+    }
+    if (target == -1) {
+      target = use;
+    }
+    while (!cfg_.dominates(target, use)) {
+      target = cfg_.idom[target];
+    }
+  }
+
+  // stay out of loops the instruction is not already in
+  bool moved = true;
+  while (moved) {
+    moved = false;
+    for (auto& loop : cfg_.loops) {
+      if (cfg_.in_loop(loop, target) && !cfg_.in_loop(loop, block)) {
+        target = cfg_.idom[loop.header];
+        moved = true;
+      }
+    }
+  }
+  if (target == block || !avoids(block, target)) {
+    return -1;
+  }
+
+  // the operands must still hold the same values at the new position
+  auto on_path = between(block, target);
+  for (auto& src : srcs) {
+    auto name = var_name(src);
+    auto defs = name ? defs_.find(*name) : defs_.end();
+    if (defs == defs_.end()) {
+      continue;
+    }
+    for (auto [b, i] : defs->second) {
+      if (on_path[b] || (b == block && i > index)) {
+        return -1;
+      }
+    }
+  }
+  return target;
+}
+
+bool CodeSinking::avoids(int from, int to) const {
+  std::vector<bool> seen(cfg_.blocks.size(), false);
+  std::vector<int> worklist(cfg_.succs[from].begin(), cfg_.succs[from].end());
+  while (!worklist.empty()) {
+    int block = worklist.back();
+    worklist.pop_back();
+    if (block == to || seen[block]) {
+      continue;
+    }
+    seen[block] = true;
+    if (cfg_.succs[block].empty()) {
+      return true;
+    }
+    for (int succ : cfg_.succs[block]) {
+      worklist.push_back(succ);
+    }
+  }
+  return false;
+}
+
+std::vector<bool> CodeSinking::between(int from, int to) const {
+  auto reach = [this](const std::vector<int>& start,
+                      const std::vector<std::vector<int>>& edges) {
+    std::vector<bool> seen(cfg_.blocks.size(), false);
+    std::vector<int> worklist = start;
+    while (!worklist.empty()) {
+      int block = worklist.back();
+      worklist.pop_back();
+      if (seen[block]) {
+        continue;
+      }
+      seen[block] = true;
+      for (int next : edges[block]) {
+        worklist.push_back(next);
+      }
+    }
+    return seen;
+  };
+
+  auto forward = reach(cfg_.succs[from], cfg_.succs);
+  auto backward = reach(cfg_.preds[to], cfg_.preds);
+  std::vector<bool> on_path(cfg_.blocks.size());
+  for (size_t i = 0; i < on_path.size(); ++i) {
+    on_path[i] = forward[i] && backward[i];
+  }
+  return on_path;
+}
@@ -1,5 +1,6 @@
 #include "Codegen.h"
 #include "Token.h"
+#include "Util.h"
 #include <cassert>
 #include <format>
 #include <sstream>
@@ -7,9 +8,26 @@
 
 using namespace ccomp;
 
-Codegen::Codegen(const Asm* program,
-                 ErrorHandler& errorHandler) :
-  program_(program), errorHandler_(errorHandler)
+// the contents of an assembler string literal holding `text`
+static std::string escape(const std::string& text) {
+  std::string out;
+  for (unsigned char c : text) {
+    if (c == '"' || c == '\\') {
+      out += '\\';
+      out += c;
+    } else if (c < ' ' || c > '~') {
+      out += std::format("\\{:03o}", c);
+    } else {
+      out += c;
+    }
+  }
+  return out;
+}
+
+Codegen::Codegen(const Asm* program, const Options& options,
+                 const Profile& profile, ErrorHandler& errorHandler) :
+  program_(program), options_(options), profile_(profile),
+  errorHandler_(errorHandler)
 {}
 
 std::string Codegen::code() {
@@ -33,18 +51,100 @@ std::string Codegen::operator()(const AsmProgram& prog) {
   for (auto fn : prog.functions) {
     ss << code(fn) << '\n';
   }
+  if (profile_.generating()) {
+    ss << profile_runtime() << '\n';
+  }
   ss << ".section .note.GNU-stack,\"\",@progbits";
   return ss.str();
 }
 
+std::string Codegen::profile_runtime() const {
+  // .fini_array runs the hook when main returns or exit() is called. It
+  // makes the system calls itself, so the program needs nothing from libc.
+  std::stringstream ss;
+  auto write = [&ss](const std::string& data, size_t size) {
+    ss << "  movl $1, %eax\n"
+       << "  movl %ebx, %edi\n"
+       << "  leaq " << data << "(%rip), %rsi\n"
+       << "  movq $" << size << ", %rdx\n"
+       << "  syscall\n";
+  };
+  ss << "  .bss\n"
+     << "  .p2align 3\n";
+  for (auto& fn : profile_.counters()) {
+    ss << ".L_prof_" << fn.function << ":\n"
+       << "  .zero " << fn.size * 8 << '\n';
+  }
+  ss << "  .data\n"
+     << ".L_prof_magic:\n"
+     << "  .ascii \"" << Profile::kMagic << "\"\n";
+  for (auto& fn : profile_.counters()) {
+    ss << ".L_prof_header_" << fn.function << ":\n"
+       << "  .quad " << fn.checksum << ", " << fn.size << ", "
+       << fn.function.size() << '\n'
+       << "  .ascii \"" << fn.function << "\"\n";
+  }
+  ss << ".L_prof_path:\n"
+     << "  .asciz \"" << escape(profile_.output()) << "\"\n";
+
+  // fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644)
+  ss << "  .text\n"
+     << "  .p2align 4\n"
+     << "__ccomp_profile_write:\n"
+     << "  pushq %rbx\n"
+     << "  movl $2, %eax\n"
+     << "  leaq .L_prof_path(%rip), %rdi\n"
+     << "  movl $577, %esi\n"
+     << "  movl $420, %edx\n"
+     << "  syscall\n"
+     << "  testl %eax, %eax\n"
+     << "  js .L_prof_done\n"
+     << "  movl %eax, %ebx\n";
+  write(".L_prof_magic", 8);
+  for (auto& fn : profile_.counters()) {
+    write(".L_prof_header_" + fn.function, 24 + fn.function.size());
+    write(".L_prof_" + fn.function, fn.size * 8);
+  }
+  ss << "  movl $3, %eax\n"
+     << "  movl %ebx, %edi\n"
+     << "  syscall\n"
+     << ".L_prof_done:\n"
+     << "  popq %rbx\n"
+     << "  ret\n"
+     << "  .section .fini_array,\"aw\"\n"
+     << "  .p2align 3\n"
+     << "  .quad __ccomp_profile_write";
+  return ss.str();
+}
+
 std::string Codegen::operator()(const AsmFunction& fn) {
   std::stringstream ss;
   auto name = fn.name.toString();
+  function_ = name;
+  // every function names its section, as the one before may end elsewhere
+  if (fn.section == ".text") {
+    ss << "  .text\n";
+  } else {
+    ss << "  .section " << fn.section << ",\"ax\",@progbits\n";
+  }
   ss << ".globl " << name << '\n'
+     << "  .p2align 4\n"
      << name << ":\n";
-  ss << "  pushq %rbp\n  movq %rsp, %rbp\n";
+  int frame = 0;
+  for (auto& inst : fn.instructions) {
+    if (auto alloc = std::get_if<AsmAllocateStack>(inst.get())) {
+      frame = alloc->size;
+    }
+  }
+  // Every function is a leaf, as there are no calls, so a frame that fits
+  // in the red zone needs no stack adjustment.
+  frame_pointer_ = !options_.omit_frame_pointer;
+  rsp_offset_ = (frame_pointer_ || frame <= kRedZone) ? 0 : frame;
   for (auto inst : fn.instructions) {
     auto inst_code = code(inst);
+    if (inst_code.empty()) {
+      continue;
+    }
     // need special handling for assembly labels
     if (std::holds_alternative<AsmLabel>(*inst)) {
       ss << inst_code << ":\n";
@@ -79,6 +179,10 @@ std::string Codegen::operator()(const AsmBinary& bin) {
       return std::format("subl {}, {}", operand1, operand2);
     case TokenType::STAR:
       return std::format("imull {}, {}", operand1, operand2);
+    case TokenType::AMPERSAND:
+      return std::format("andl {}, {}", operand1, operand2);
+    case TokenType::CARET:
+      return std::format("xorl {}, {}", operand1, operand2);
     default:
       assert(0);
       break;
@@ -92,6 +196,51 @@ std::string Codegen::operator()(const AsmCmp& cmp) {
   return std::format("cmpl {}, {}", operand1, operand2);
 }
 
+std::string Codegen::operator()(const AsmTest& test) {
+  auto operand1 = code(test.operand1);
+  auto operand2 = code(test.operand2);
+  return std::format("testl {}, {}", operand1, operand2);
+}
+
+std::string Codegen::operator()(const AsmLea& lea) {
+  // the address uses the 64-bit registers; the low 32 bits of the sum do not
+  // depend on the upper halves
+  std::string addr = lea.disp ? std::to_string(lea.disp) : "";
+  addr += "(";
+  if (lea.base) {
+    addr += quad_reg(lea.base);
+  }
+  if (lea.index) {
+    addr += std::format(",{},{}", quad_reg(lea.index), lea.scale);
+  }
+  addr += ")";
+  return std::format("leal {}, {}", addr, code(lea.dest));
+}
+
+std::string Codegen::operator()(const AsmImulImm& imul) {
+  auto src = code(imul.src);
+  auto dest = code(imul.dest);
+  return std::format("imull ${}, {}, {}", imul.value, src, dest);
+}
+
+std::string Codegen::operator()(const AsmShift& shift) {
+  auto operand = code(shift.operand);
+  switch (shift.op) {
+    case AsmShiftOp::SAL:
+      return std::format("sall ${}, {}", shift.count, operand);
+    case AsmShiftOp::SAR:
+      return std::format("sarl ${}, {}", shift.count, operand);
+    case AsmShiftOp::SHR:
+      return std::format("shrl ${}, {}", shift.count, operand);
+  }
+  return nullptr;
+}
+
+std::string Codegen::operator()(const AsmImulHi& imul) {
+  auto operand = code(imul.operand);
+  return std::format("imull {}", operand);
+}
+
 std::string Codegen::operator()(const AsmIdiv& idiv) {
   auto operand = code(idiv.operand);
   return std::format("idivl {}", operand);
@@ -132,7 +281,11 @@ std::string Codegen::operator()(const AsmSetCC& setcc) {
      {AsmCondCode::G, "setg"},
      {AsmCondCode::GE, "setge"}};
 
+  // setCC writes a single byte
   auto operand = code(setcc.operand);
+  if (auto reg = std::get_if<AsmRegister>(setcc.operand.get())) {
+    operand = byte_reg(reg->reg);
+  }
   auto it = code_to_inst.find(setcc.cond_code);
   if (it != code_to_inst.end()) {
     return std::format("{} {}", it->second, operand);
@@ -142,10 +295,63 @@ std::string Codegen::operator()(const AsmSetCC& setcc) {
   }
 }
 
+std::string Codegen::operator()(const AsmCMovCC& cmov) {
+  static std::unordered_map<AsmCondCode, std::string> code_to_inst =
+    {{AsmCondCode::E, "cmove"},
+     {AsmCondCode::NE, "cmovne"},
+     {AsmCondCode::L, "cmovl"},
+     {AsmCondCode::LE, "cmovle"},
+     {AsmCondCode::G, "cmovg"},
+     {AsmCondCode::GE, "cmovge"}};
+
+  auto src = code(cmov.src);
+  auto dest = code(cmov.dest);
+  auto it = code_to_inst.find(cmov.cond_code);
+  if (it != code_to_inst.end()) {
+    return std::format("{} {}, {}", it->second, src, dest);
+  } else {
+    errorHandler_.add(0, "asm cmov gen", "");
+    return nullptr;
+  }
+}
+
+std::string Codegen::operator()(const AsmJumpTable& table) {
+  // AsmGen leaves the index in %r10; the table holds 32-bit offsets from
+  // its own start, so the code stays position independent
+  assert(std::holds_alternative<AsmRegister>(*table.index));
+  auto name = std::format(".L_table{}", jump_tables_++);
+  std::stringstream ss;
+  ss << "leaq " << name << "(%rip), %r11\n"
+     << "  movslq (%r11,%r10,4), %r10\n"
+     << "  addq %r11, %r10\n"
+     << "  jmp *%r10\n"
+     << "  .pushsection .rodata\n"
+     << "  .p2align 2\n"
+     << name << ":\n";
+  for (auto& target : table.targets) {
+    ss << "  .long " << code(target) << " - " << name << '\n';
+  }
+  ss << "  .popsection";
+  return ss.str();
+}
+
 std::string Codegen::operator()(const AsmLabel& label) {
   return std::format(".L_{}", label.identifier);
 }
 
+std::string Codegen::operator()(const AsmAlign& align) {
+  return std::format(".p2align {},,{}", align.log2, align.max_skip);
+}
+
+std::string Codegen::operator()(const AsmSection& section) {
+  return std::format(".section {},\"ax\",@progbits\n{}:", section.name,
+                     section.symbol);
+}
+
+std::string Codegen::operator()(const AsmCount& count) {
+  return std::format("incq .L_prof_{}+{}(%rip)", function_, count.counter * 8);
+}
+
 std::string Codegen::operator()(const AsmMov& mov) {
   auto src = code(mov.src);
   auto dest = code(mov.dest);
@@ -153,7 +359,22 @@ std::string Codegen::operator()(const AsmMov& mov) {
 }
 
 std::string Codegen::operator()(const AsmAllocateStack& alloc) {
-  return std::format("subq ${}, %rsp", alloc.size);
+  if (frame_pointer_) {
+    return std::format("pushq %rbp\n  movq %rsp, %rbp\n  subq ${}, %rsp",
+                       alloc.size);
+  } else if (rsp_offset_ > 0) {
+    return std::format("subq ${}, %rsp", alloc.size);
+  }
+  return "";
+}
+
+std::string Codegen::operator()(const AsmDeallocateStack&) {
+  if (frame_pointer_) {
+    return "movq %rbp, %rsp\n  popq %rbp";
+  } else if (rsp_offset_ > 0) {
+    return std::format("addq ${}, %rsp", rsp_offset_);
+  }
+  return "";
 }
 
 std::string Codegen::operator()(const AsmImm& imm) {
@@ -161,7 +382,7 @@ std::string Codegen::operator()(const AsmImm& imm) {
 }
 
 std::string Codegen::operator()(const AsmReturn&) {
-  return std::format("movq %rbp, %rsp\n  popq %rbp\n  ret");
+  return "ret";
 }
 
 std::string Codegen::operator()(const AsmRegister& reg) {
@@ -174,8 +395,18 @@ std::string Codegen::operator()(const AsmRegister& reg) {
     case 2:
       return std::string("%ecx");
     */
+    case AsmReg::CX:
+      return std::string("%ecx");
     case AsmReg::DX:
       return std::string("%edx");
+    case AsmReg::SI:
+      return std::string("%esi");
+    case AsmReg::DI:
+      return std::string("%edi");
+    case AsmReg::R8:
+      return std::string("%r8d");
+    case AsmReg::R9:
+      return std::string("%r9d");
     case AsmReg::R10:
       return std::string("%r10d");
     case AsmReg::R11:
@@ -186,6 +417,36 @@ std::string Codegen::operator()(const AsmRegister& reg) {
   return nullptr;
 }
 
+std::string Codegen::byte_reg(AsmReg reg) {
+  switch (reg) {
+    case AsmReg::AX: return "%al";
+    case AsmReg::CX: return "%cl";
+    case AsmReg::DX: return "%dl";
+    case AsmReg::SI: return "%sil";
+    case AsmReg::DI: return "%dil";
+    case AsmReg::R8: return "%r8b";
+    case AsmReg::R9: return "%r9b";
+    case AsmReg::R10: return "%r10b";
+    case AsmReg::R11: return "%r11b";
+  }
+  return nullptr;
+}
+
+std::string Codegen::quad_reg(const std::shared_ptr<Asm>& operand) {
+  switch (std::get<AsmRegister>(*operand).reg) {
+    case AsmReg::AX: return "%rax";
+    case AsmReg::CX: return "%rcx";
+    case AsmReg::DX: return "%rdx";
+    case AsmReg::SI: return "%rsi";
+    case AsmReg::DI: return "%rdi";
+    case AsmReg::R8: return "%r8";
+    case AsmReg::R9: return "%r9";
+    case AsmReg::R10: return "%r10";
+    case AsmReg::R11: return "%r11";
+  }
+  return nullptr;
+}
+
 std::string Codegen::operator()(const AsmPseudo&) {
   assert(0);
   return nullptr;
@@ -193,5 +454,8 @@ std::string Codegen::operator()(const AsmPseudo&) {
 
 std::string Codegen::operator()(const AsmStack& st) {
   // -ve offset from rbp
-  return std::format("-{}(%rbp)", st.offset);
+  if (frame_pointer_) {
+    return std::format("-{}(%rbp)", st.offset);
+  }
+  return std::format("{}(%rsp)", rsp_offset_ - st.offset);
 }
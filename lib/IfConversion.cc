@@ -0,0 +1,247 @@
+#include "IfConversion.h"
+#include "Util.h"
+#include <algorithm>
+
+using namespace ccomp;
+
+IfConversion::IfConversion(TackyCFG& cfg, const Options& options) :
+  cfg_(cfg), options_(options)
+{}
+
+bool IfConversion::run() {
+  if (options_.cmov_miss_cost <= 0) {
+    return false;
+  }
+  bool changed = false;
+  while (convert_all()) {
+    changed = true;
+  }
+  return changed;
+}
+
+bool IfConversion::safe_arm(int block, const std::string& cond,
+                            std::string& var) const {
+  auto& insts = cfg_.blocks[block].instructions;
+  if (insts.size() < 2) {
+    return false;
+  }
+
+  for (size_t i = 0; i + 1 < insts.size(); ++i) {
+    auto& inst = insts[i];
+    if (!std::holds_alternative<TackyUnary>(*inst) &&
+        !std::holds_alternative<TackyBinary>(*inst) &&
+        !std::holds_alternative<TackyCopy>(*inst)) {
+      return false;
+    }
+    // runs whether or not the arm is taken, so it must not trap
+    if (auto bin = std::get_if<TackyBinary>(inst.get());
+        bin && one_of(bin->op.type, {TokenType::SLASH, TokenType::PERCENT})) {
+      auto divisor = std::get_if<TackyConstant>(bin->src2.get());
+      if (divisor == nullptr || divisor->value == 0 || divisor->value == -1) {
+        return false;
+      }
+    }
+    for (auto& src : tacky_srcs(*inst)) {
+      if (auto name = var_name(src)) {
+        if (*name == cond) {
+          return false;
+        }
+      }
+    }
+  }
+
+  // the last instruction assigns var...
+  auto dest = var_name(tacky_dest(*insts[insts.size() - 2]));
+  if (var.empty()) {
+    var = *dest;
+  } else if (*dest != var) {
+    return false;
+  }
+
+  // ...and everything before it only feeds temporaries that never live
+  // across blocks, so clobbering them on the other path is harmless
+  for (size_t i = 0; i + 2 < insts.size(); ++i) {
+    auto temp = var_name(tacky_dest(*insts[i]));
+    if (*temp == var || *temp == cond || live_in_.contains(*temp)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool IfConversion::reads_any(const Tacky& inst,
+                             const std::vector<std::shared_ptr<Tacky>>& defs) {
+  for (auto& src : tacky_srcs(inst)) {
+    auto name = var_name(src);
+    for (auto& def : defs) {
+      auto dest = var_name(tacky_dest(*def));
+      if (name && *name == *dest) {
+        return true;
+      }
+    }
+  }
+  return false;
+}
+
+IfConversion::Arm IfConversion::speculate(int block) const {
+  auto& insts = cfg_.blocks[block].instructions;
+  Arm arm;
+  arm.block = block;
+  arm.speculated.assign(insts.begin(), insts.end() - 2);
+
+  // x = y just selects y
+  auto& last = insts[insts.size() - 2];
+  if (auto copy = std::get_if<TackyCopy>(last.get())) {
+    arm.value = copy->src;
+    return arm;
+  }
+  arm.value = make_tacky<TackyVar>(TackyCFG::unique_var());
+  if (auto unary = std::get_if<TackyUnary>(last.get())) {
+    arm.speculated.emplace_back(
+      make_tacky<TackyUnary>(unary->op, unary->src, arm.value));
+  } else if (auto bin = std::get_if<TackyBinary>(last.get())) {
+    arm.speculated.emplace_back(
+      make_tacky<TackyBinary>(bin->op, bin->src1, bin->src2, arm.value));
+  }
+  return arm;
+}
+
+bool IfConversion::convert_all() {
+  live_in_.clear();
+  for (auto& block : cfg_.blocks) {
+    std::unordered_set<std::string> defined;
+    for (auto& inst : block.instructions) {
+      for (auto& src : tacky_srcs(*inst)) {
+        if (auto name = var_name(src); name && !defined.contains(*name)) {
+          live_in_.insert(*name);
+        }
+      }
+      if (auto dest = var_name(tacky_dest(*inst))) {
+        defined.insert(*dest);
+      }
+    }
+  }
+
+  // the block only reached from `a`, and the label it jumps to
+  auto arm_target = [this](int a, int block) -> const std::string* {
+    if (block == a || cfg_.preds[block].size() != 1 ||
+        cfg_.preds[block][0] != a) {
+      return nullptr;
+    }
+    auto jmp = std::get_if<TackyJump>(cfg_.blocks[block].instructions.back().get());
+    return jmp ? &std::get<TackyLabel>(*jmp->target).identifier : nullptr;
+  };
+
+  // A converted branch leaves its arms unreachable and its join with a
+  // stale predecessor list, which only makes later candidates in the same
+  // sweep look less convertible, so the CFG is updated once at the end.
+  bool changed = false;
+  for (size_t a = 0; a < cfg_.blocks.size(); ++a) {
+    TackyBranch branch;
+    if (!cond_branch(cfg_.blocks[a], branch) ||
+        var_name(branch.condition) == nullptr ||
+        branch.if_true == branch.if_false) {
+      continue;
+    }
+    auto& cond = *var_name(branch.condition);
+    int t = cfg_.find_block(branch.if_true);
+    int f = cfg_.find_block(branch.if_false);
+    auto t_target = arm_target(a, t);
+    auto f_target = arm_target(a, f);
+
+    // if (c) x = ...; else x = ...;  or  if (c) x = ...;
+    std::string join, var;
+    bool has_true = false, has_false = false;
+    if (t_target && f_target && *t_target == *f_target) {
+      join = *t_target;
+      has_true = has_false = true;
+    } else if (t_target && *t_target == branch.if_false) {
+      join = branch.if_false;
+      has_true = true;
+    } else if (f_target && *f_target == branch.if_true) {
+      join = branch.if_true;
+      has_false = true;
+    } else {
+      continue;
+    }
+    if ((has_true && !safe_arm(t, cond, var)) ||
+        (has_false && !safe_arm(f, cond, var))) {
+      continue;
+    }
+
+    // both arms run, plus the cmov and a possible mov in front of it
+    int cost = 2;
+    if (has_true) {
+      cost += cfg_.blocks[t].instructions.size() - 1;
+    }
+    if (has_false) {
+      cost += cfg_.blocks[f].instructions.size() - 1;
+    }
+    // A branch going one way p of the time mispredicts about min(p, 1 - p)
+    // of the time, so one that __builtin_expect or the profile shows
+    // biased is worth less speculation than a coin flip.
+    int budget = options_.cmov_miss_cost;
+    if (branch.prob != kUnknownProb) {
+      budget = budget * std::min(branch.prob, 100 - branch.prob) / 50;
+    }
+    if (cost > budget) {
+      continue;
+    }
+
+    Arm if_true, if_false;
+    std::shared_ptr<Tacky> dest;
+    if (has_true) {
+      if_true = speculate(t);
+      auto& insts = cfg_.blocks[t].instructions;
+      dest = tacky_dest(*insts[insts.size() - 2]);
+    }
+    if (has_false) {
+      if_false = speculate(f);
+      auto& insts = cfg_.blocks[f].instructions;
+      dest = tacky_dest(*insts[insts.size() - 2]);
+    }
+    if (!has_true) {
+      if_true.value = dest;
+    }
+    if (!has_false) {
+      if_false.value = dest;
+    }
+
+    // keep the compare next to the select so the two fuse
+    auto& insts = cfg_.blocks[a].instructions;
+    insts.resize(insts.size() - 2);
+    std::shared_ptr<Tacky> compare;
+    if (!insts.empty()) {
+      auto last = var_name(tacky_dest(*insts.back()));
+      if (last && *last == cond &&
+          !reads_any(*insts.back(), if_true.speculated) &&
+          !reads_any(*insts.back(), if_false.speculated)) {
+        compare = insts.back();
+        insts.pop_back();
+      }
+    }
+    insts.insert(insts.end(), if_true.speculated.begin(), if_true.speculated.end());
+    insts.insert(insts.end(), if_false.speculated.begin(), if_false.speculated.end());
+    if (compare) {
+      insts.push_back(compare);
+    }
+    // x = Select(c, t, f)
+    // Jump(join)
+    insts.emplace_back(make_tacky<TackySelect>(
+      branch.condition, if_true.value, if_false.value, dest));
+    insts.emplace_back(make_tacky<TackyJump>(make_tacky<TackyLabel>(join)));
+    // the select may read the variable's old value before this block
+    // writes it
+    for (auto& value : {if_true.value, if_false.value}) {
+      if (auto name = var_name(value)) {
+        live_in_.insert(*name);
+      }
+    }
+    changed = true;
+  }
+  if (changed) {
+    cfg_.analyze();
+    cfg_.remove_unreachable();
+  }
+  return changed;
+}
@@ -0,0 +1,204 @@
+#include "JumpThreading.h"
+#include "Util.h"
+#include <algorithm>
+#include <unordered_set>
+
+using namespace ccomp;
+
+JumpThreading::JumpThreading(TackyCFG& cfg, const Options& options) :
+  cfg_(cfg), options_(options)
+{}
+
+bool JumpThreading::run() {
+  if (options_.thread_max_size < 0) {
+    return false;
+  }
+
+  // every thread adds at most one small block; the cap keeps threading
+  // around a cycle with a known condition from running away
+  size_t limit = 0;
+  for (auto& block : cfg_.blocks) {
+    limit += block.instructions.size();
+  }
+  bool changed = false;
+  while (limit > 0 && thread_all(limit)) {
+    changed = true;
+  }
+  if (changed) {
+    remove_dead_copies();
+    forward_empty_blocks();
+  }
+  return changed;
+}
+
+void JumpThreading::forward_empty_blocks() {
+  // Jump(L) and JumpIfZero(c, L) Jump(L) both just mean Jump(L)
+  for (auto& block : cfg_.blocks) {
+    TackyBranch branch;
+    if (cond_branch(block, branch) && branch.if_true == branch.if_false) {
+      block.instructions.resize(block.instructions.size() - 2);
+      block.instructions.emplace_back(
+        make_tacky<TackyJump>(make_tacky<TackyLabel>(branch.if_true)));
+    }
+  }
+
+  for (size_t i = 1; i < cfg_.blocks.size(); ++i) {
+    auto& insts = cfg_.blocks[i].instructions;
+    auto jmp = (insts.size() == 1) ?
+      std::get_if<TackyJump>(insts[0].get()) : nullptr;
+    if (jmp == nullptr) {
+      continue;
+    }
+    auto& label = cfg_.blocks[i].label;
+    auto& target = std::get<TackyLabel>(*jmp->target).identifier;
+    if (target == label) {
+      continue;
+    }
+    for (auto& other : cfg_.blocks) {
+      retarget(other, label, target);
+    }
+  }
+  cfg_.analyze();
+  cfg_.remove_unreachable();
+}
+
+void JumpThreading::remove_dead_copies() {
+  // the 0/1 results nobody tests any more
+  std::unordered_set<std::string> used;
+  for (auto& block : cfg_.blocks) {
+    for (auto& inst : block.instructions) {
+      for (auto& src : tacky_srcs(*inst)) {
+        if (auto name = var_name(src)) {
+          used.insert(*name);
+        }
+      }
+    }
+  }
+  for (auto& block : cfg_.blocks) {
+    std::erase_if(block.instructions, [&used](auto& inst) {
+      auto copy = std::get_if<TackyCopy>(inst.get());
+      return copy && !used.contains(*var_name(copy->dest));
+    });
+  }
+}
+
+JumpThreading::Known JumpThreading::known_on_edge(
+    int block, const std::string& succ, const std::string& var, int depth,
+    std::vector<int>& path) const {
+  path.push_back(block);
+  // the edge is one side of a branch on var
+  auto& b = cfg_.blocks[block];
+  TackyBranch branch;
+  if (cond_branch(b, branch) && branch.if_true != branch.if_false) {
+    auto cond = var_name(branch.condition);
+    if (cond && *cond == var) {
+      return (succ == branch.if_true) ? Known::NONZERO : Known::ZERO;
+    }
+  }
+
+  // var = constant
+  for (auto it = b.instructions.rbegin(); it != b.instructions.rend(); ++it) {
+    auto dest = var_name(tacky_dest(**it));
+    if (dest == nullptr || *dest != var) {
+      continue;
+    }
+    auto copy = std::get_if<TackyCopy>(it->get());
+    auto constant = copy ? std::get_if<TackyConstant>(copy->src.get()) : nullptr;
+    if (constant == nullptr) {
+      return Known::UNKNOWN;
+    }
+    return constant->value ? Known::NONZERO : Known::ZERO;
+  }
+
+  if (depth > 0 && cfg_.preds[block].size() == 1) {
+    return known_on_edge(cfg_.preds[block][0], b.label, var, depth - 1,
+                         path);
+  }
+  return Known::UNKNOWN;
+}
+
+bool JumpThreading::thread_all(size_t& limit) {
+  // A thread changes the predecessors of the block it leaves and of its
+  // target, and the jump of the predecessor it retargets, and what an edge
+  // is known to carry depends on the blocks on its path. Threads that
+  // change nothing another one depends on are applied together.
+  std::vector<bool> changed_block(cfg_.blocks.size(), false);
+  std::vector<bool> depended_on(cfg_.blocks.size(), false);
+  // copies of branching blocks, to go after the predecessor jumping to them
+  std::vector<std::vector<TackyBlock>> copies(cfg_.blocks.size());
+  bool changed = false;
+  for (size_t s = 0; s < cfg_.blocks.size() && limit > 0; ++s) {
+    // threading into a loop header would give the loop a second entry
+    bool header = std::any_of(cfg_.loops.begin(), cfg_.loops.end(),
+      [s](const TackyLoop& loop) { return loop.header == (int)s; });
+    TackyBranch branch;
+    if (header || !cond_branch(cfg_.blocks[s], branch) ||
+        var_name(branch.condition) == nullptr) {
+      continue;
+    }
+
+    // the instructions in front of the branch, which must leave c alone
+    auto& cond = *var_name(branch.condition);
+    auto& insts = cfg_.blocks[s].instructions;
+    std::vector<std::shared_ptr<Tacky>> body(insts.begin(), insts.end() - 2);
+    if ((int)body.size() > options_.thread_max_size ||
+        std::any_of(body.begin(), body.end(), [&cond](auto& inst) {
+          auto dest = var_name(tacky_dest(*inst));
+          return dest && *dest == cond;
+        })) {
+      continue;
+    }
+
+    auto label = cfg_.blocks[s].label;
+    for (int pred : cfg_.preds[s]) {
+      if (limit == 0) {
+        break;
+      }
+      std::vector<int> path;
+      auto known = known_on_edge(pred, label, cond, 4, path);
+      if (known == Known::UNKNOWN) {
+        continue;
+      }
+      auto& target = (known == Known::NONZERO) ?
+        branch.if_true : branch.if_false;
+      int t = cfg_.find_block(target);
+      if (depended_on[s] || depended_on[t] || depended_on[pred] ||
+          std::any_of(path.begin(), path.end(),
+                      [&](int b) { return changed_block[b]; })) {
+        continue;
+      }
+      changed_block[s] = changed_block[t] = changed_block[pred] = true;
+      for (int b : path) {
+        depended_on[b] = true;
+      }
+
+      if (body.empty()) {
+        retarget(cfg_.blocks[pred], label, target);
+      } else {
+        // pred -> copy of the block -> target
+        TackyBlock copy{TackyCFG::unique_label("thread"), body};
+        copy.instructions.emplace_back(
+          make_tacky<TackyJump>(make_tacky<TackyLabel>(target)));
+        retarget(cfg_.blocks[pred], label, copy.label);
+        copies[pred].push_back(std::move(copy));
+      }
+      --limit;
+      changed = true;
+    }
+  }
+  if (!changed) {
+    return false;
+  }
+
+  std::vector<TackyBlock> blocks;
+  for (size_t b = 0; b < cfg_.blocks.size(); ++b) {
+    blocks.push_back(std::move(cfg_.blocks[b]));
+    for (auto& copy : copies[b]) {
+      blocks.push_back(std::move(copy));
+    }
+  }
+  cfg_.blocks = std::move(blocks);
+  cfg_.analyze();
+  cfg_.remove_unreachable();
+  return true;
+}
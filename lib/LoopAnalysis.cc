@@ -0,0 +1,242 @@
+#include "LoopAnalysis.h"
+#include "Util.h"
+#include <algorithm>
+#include <climits>
+#include <unordered_set>
+
+using namespace ccomp;
+
+// a REL b  <=>  b swap(REL) a
+TokenType ccomp::swap_relational(TokenType op) {
+  switch (op) {
+    case TokenType::LESS: return TokenType::GREATER;
+    case TokenType::LESS_EQUAL: return TokenType::GREATER_EQUAL;
+    case TokenType::GREATER: return TokenType::LESS;
+    case TokenType::GREATER_EQUAL: return TokenType::LESS_EQUAL;
+    default: return op;
+  }
+}
+
+// !(a REL b)  <=>  a negate(REL) b
+TokenType ccomp::negate_relational(TokenType op) {
+  switch (op) {
+    case TokenType::LESS: return TokenType::GREATER_EQUAL;
+    case TokenType::LESS_EQUAL: return TokenType::GREATER;
+    case TokenType::GREATER: return TokenType::LESS_EQUAL;
+    case TokenType::GREATER_EQUAL: return TokenType::LESS;
+    case TokenType::EQUAL_EQUAL: return TokenType::BANG_EQUAL;
+    default: return TokenType::EQUAL_EQUAL;
+  }
+}
+
+bool ccomp::eval_relational(TokenType op, int64_t a, int64_t b) {
+  switch (op) {
+    case TokenType::LESS: return a < b;
+    case TokenType::LESS_EQUAL: return a <= b;
+    case TokenType::GREATER: return a > b;
+    case TokenType::GREATER_EQUAL: return a >= b;
+    case TokenType::EQUAL_EQUAL: return a == b;
+    default: return a != b;
+  }
+}
+
+static const std::string& target_label(const std::shared_ptr<Tacky>& target) {
+  return std::get<TackyLabel>(*target).identifier;
+}
+
+// If inst computes `dest = var + c` or `dest = var - c`, returns the step.
+static bool step_of(const Tacky& inst, const std::string& var, int* step) {
+  auto bin = std::get_if<TackyBinary>(&inst);
+  if (bin == nullptr) {
+    return false;
+  }
+
+  auto c1 = std::get_if<TackyConstant>(bin->src1.get());
+  auto c2 = std::get_if<TackyConstant>(bin->src2.get());
+  auto v1 = var_name(bin->src1);
+  auto v2 = var_name(bin->src2);
+  if (bin->op.type == TokenType::PLUS) {
+    if (v1 && *v1 == var && c2) {
+      *step = c2->value;
+      return true;
+    } else if (v2 && *v2 == var && c1) {
+      *step = c1->value;
+      return true;
+    }
+  } else if (bin->op.type == TokenType::MINUS && v1 && *v1 == var && c2 &&
+             c2->value != INT_MIN) {
+    *step = -c2->value;
+    return true;
+  }
+  return false;
+}
+
+int ccomp::count_uses(const TackyCFG& cfg, const std::string& var) {
+  int uses = 0;
+  for (auto& block : cfg.blocks) {
+    for (auto& inst : block.instructions) {
+      for (auto& src : tacky_srcs(*inst)) {
+        if (auto name = var_name(src); name && *name == var) {
+          ++uses;
+        }
+      }
+    }
+  }
+  return uses;
+}
+
+bool ccomp::entry_value(const TackyCFG& cfg, const TackyLoop& loop,
+                        const std::string& var, int* value) {
+  std::vector<int> entries;
+  for (int pred : cfg.preds[loop.header]) {
+    if (!cfg.in_loop(loop, pred)) {
+      entries.push_back(pred);
+    }
+  }
+  if (entries.size() != 1) {
+    return false;
+  }
+
+  // walk back through straight-line predecessors to the reaching definition
+  std::unordered_set<int> seen;
+  int block = entries[0];
+  while (!cfg.in_loop(loop, block) && seen.insert(block).second) {
+    auto& insts = cfg.blocks[block].instructions;
+    for (auto it = insts.rbegin(); it != insts.rend(); ++it) {
+      auto dest = tacky_dest(**it);
+      if (auto name = var_name(dest); name && *name == var) {
+        auto copy = std::get_if<TackyCopy>(it->get());
+        auto constant =
+          copy ? std::get_if<TackyConstant>(copy->src.get()) : nullptr;
+        if (constant == nullptr) {
+          return false;
+        }
+        *value = constant->value;
+        return true;
+      }
+    }
+    if (cfg.preds[block].size() != 1) {
+      return false;
+    }
+    block = cfg.preds[block][0];
+  }
+  return false;
+}
+
+bool ccomp::find_counted_loop(const TackyCFG& cfg, const TackyLoop& loop,
+                             CountedLoop& counted) {
+  auto dominates_latches = [&](int block) {
+    return std::all_of(loop.latches.begin(), loop.latches.end(),
+                       [&](int latch) { return cfg.dominates(block, latch); });
+  };
+
+  for (int block : loop.blocks) {
+    // exit test: JumpIfZero|JumpIfNotZero(c, taken) Jump(other)
+    auto& insts = cfg.blocks[block].instructions;
+    if (insts.size() < 2 || !dominates_latches(block)) {
+      continue;
+    }
+    auto jmp = std::get_if<TackyJump>(insts.back().get());
+    auto& cond_jump = insts[insts.size() - 2];
+    std::shared_ptr<Tacky> condition, target;
+    bool jump_if_zero = false;
+    if (auto jz = std::get_if<TackyJumpIfZero>(cond_jump.get())) {
+      condition = jz->condition;
+      target = jz->target;
+      jump_if_zero = true;
+    } else if (auto jnz = std::get_if<TackyJumpIfNotZero>(cond_jump.get())) {
+      condition = jnz->condition;
+      target = jnz->target;
+    }
+    auto cond = var_name(condition);
+    if (jmp == nullptr || cond == nullptr) {
+      continue;
+    }
+
+    const std::string& taken = target_label(target);
+    const std::string& other = target_label(jmp->target);
+    bool taken_in = cfg.in_loop(loop, cfg.find_block(taken));
+    bool other_in = cfg.in_loop(loop, cfg.find_block(other));
+    if (taken_in == other_in) {
+      continue;
+    }
+    counted.exiting = block;
+    counted.stay = taken_in ? taken : other;
+    counted.exit = taken_in ? other : taken;
+    counted.stay_if_true = jump_if_zero ? !taken_in : taken_in;
+
+    // c = a REL b, the last definition of c in this block
+    int cmp_index = -1;
+    for (int i = insts.size() - 3; i >= 0; --i) {
+      auto dest = tacky_dest(*insts[i]);
+      if (auto name = var_name(dest); name && *name == *cond) {
+        cmp_index = i;
+        break;
+      }
+    }
+    auto cmp = (cmp_index >= 0) ?
+      std::get_if<TackyBinary>(insts[cmp_index].get()) : nullptr;
+    if (cmp == nullptr || !isRelationalOp(cmp->op.type)) {
+      continue;
+    }
+
+    // one side is the induction variable, the other is loop invariant
+    for (bool swapped : {false, true}) {
+      auto iv = var_name(swapped ? cmp->src2 : cmp->src1);
+      auto bound = swapped ? cmp->src1 : cmp->src2;
+      if (iv == nullptr) {
+        continue;
+      }
+
+      int defs = 0, def_block = -1, def_index = -1;
+      bool bound_invariant = true;
+      auto bound_name = var_name(bound);
+      for (int b : loop.blocks) {
+        auto& binsts = cfg.blocks[b].instructions;
+        for (size_t i = 0; i < binsts.size(); ++i) {
+          auto dest = var_name(tacky_dest(*binsts[i]));
+          if (dest && *dest == *iv) {
+            ++defs;
+            def_block = b;
+            def_index = i;
+          }
+          if (dest && bound_name && *dest == *bound_name) {
+            bound_invariant = false;
+          }
+        }
+      }
+      if (defs != 1 || !bound_invariant || !dominates_latches(def_block)) {
+        continue;
+      }
+
+      // iv = iv + c, or t = iv + c; iv = t
+      auto& dinsts = cfg.blocks[def_block].instructions;
+      int step = 0;
+      bool found = step_of(*dinsts[def_index], *iv, &step);
+      if (!found) {
+        auto copy = std::get_if<TackyCopy>(dinsts[def_index].get());
+        auto tmp = copy ? var_name(copy->src) : nullptr;
+        for (int i = def_index - 1; tmp && i >= 0; --i) {
+          auto dest = var_name(tacky_dest(*dinsts[i]));
+          if (dest && *dest == *tmp) {
+            found = step_of(*dinsts[i], *iv, &step);
+            break;
+          }
+        }
+      }
+      if (!found || step == 0) {
+        continue;
+      }
+
+      counted.iv = *iv;
+      counted.step = step;
+      counted.rel = swapped ? swap_relational(cmp->op.type) : cmp->op.type;
+      counted.bound = bound;
+      counted.step_before_test = (def_block == block) ?
+        def_index < cmp_index : cfg.dominates(def_block, block);
+      counted.compare = (count_uses(cfg, *cond) == 1) ? insts[cmp_index] : nullptr;
+      return true;
+    }
+  }
+  return false;
+}
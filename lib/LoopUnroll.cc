@@ -0,0 +1,263 @@
+#include "LoopUnroll.h"
+#include "Util.h"
+#include <algorithm>
+#include <climits>
+#include <unordered_map>
+
+using namespace ccomp;
+
+LoopUnroll::LoopUnroll(TackyCFG& cfg, const Options& options) :
+  cfg_(cfg), options_(options)
+{}
+
+bool LoopUnroll::run() {
+  if (options_.unroll_max_size <= 0) {
+    return false;
+  }
+
+  bool changed = false;
+  bool progress = true;
+  while (progress) {
+    progress = false;
+    for (auto& loop : cfg_.loops) {
+      auto& header = cfg_.blocks[loop.header].label;
+      if (!loop.innermost || done_.contains(header)) {
+        continue;
+      }
+      done_.insert(header);
+      // unrolling rebuilds the loop list
+      if (unroll(loop)) {
+        changed = progress = true;
+        break;
+      }
+    }
+  }
+  return changed;
+}
+
+int LoopUnroll::loop_size(const TackyLoop& loop) const {
+  int size = 0;
+  for (int block : loop.blocks) {
+    for (auto& inst : cfg_.blocks[block].instructions) {
+      if (!is_terminator(*inst)) {
+        ++size;
+      }
+    }
+  }
+  return std::max(size, 1);
+}
+
+std::vector<TackyBlock> LoopUnroll::clone(const TackyLoop& loop,
+    const CountedLoop& counted,
+    const std::unordered_map<std::string, std::string>& rename,
+    const std::string& next_header, const std::string& exit_to) {
+  auto& header = cfg_.blocks[loop.header].label;
+  std::vector<TackyBlock> copy;
+  for (int block : loop.blocks) {
+    auto& orig = cfg_.blocks[block];
+    TackyBlock nb{rename.at(orig.label), {}};
+    for (auto& inst : orig.instructions) {
+      if (block != counted.exiting || inst != counted.compare) {
+        nb.instructions.push_back(inst);
+      }
+    }
+
+    // the exit test is known to stay in the loop, or to leave it
+    if (block == counted.exiting) {
+      nb.instructions.resize(nb.instructions.size() - 2);
+      nb.instructions.emplace_back(make_tacky<TackyJump>(
+        make_tacky<TackyLabel>(exit_to.empty() ? counted.stay : exit_to)));
+    }
+
+    for (auto& succ : successors(orig)) {
+      if (succ == header) {
+        retarget(nb, succ, next_header);
+      } else if (auto it = rename.find(succ); it != rename.end()) {
+        retarget(nb, succ, it->second);
+      }
+    }
+    copy.emplace_back(std::move(nb));
+  }
+  return copy;
+}
+
+void LoopUnroll::insert_before(const TackyLoop& loop,
+                               std::vector<TackyBlock> blocks,
+                               bool keep_loop) {
+  auto header = cfg_.blocks[loop.header].label;
+  for (int pred : cfg_.preds[loop.header]) {
+    if (!cfg_.in_loop(loop, pred)) {
+      retarget(cfg_.blocks[pred], header, blocks.front().label);
+    }
+  }
+
+  std::vector<TackyBlock> layout;
+  for (size_t i = 0; i < cfg_.blocks.size(); ++i) {
+    if ((int)i == loop.blocks.front()) {
+      std::move(blocks.begin(), blocks.end(), std::back_inserter(layout));
+    }
+    if (keep_loop || !cfg_.in_loop(loop, i)) {
+      layout.emplace_back(std::move(cfg_.blocks[i]));
+    }
+  }
+  cfg_.blocks = std::move(layout);
+  cfg_.analyze();
+}
+
+std::unordered_map<std::string, std::string>
+LoopUnroll::fresh_labels(const TackyLoop& loop) const {
+  std::unordered_map<std::string, std::string> rename;
+  for (int block : loop.blocks) {
+    rename[cfg_.blocks[block].label] = TackyCFG::unique_label("unroll");
+  }
+  return rename;
+}
+
+bool LoopUnroll::unroll(const TackyLoop& loop) {
+  CountedLoop counted;
+  if (!find_counted_loop(cfg_, loop, counted)) {
+    return false;
+  }
+
+  int size = loop_size(loop);
+  int start = 0, bound = 0;
+  auto bound_const = std::get_if<TackyConstant>(counted.bound.get());
+  bool known_bound = bound_const != nullptr;
+  if (bound_const) {
+    bound = bound_const->value;
+  } else {
+    known_bound = entry_value(cfg_, loop, *var_name(counted.bound), &bound);
+  }
+
+  // count the iterations that stay in the loop
+  if (known_bound && entry_value(cfg_, loop, counted.iv, &start)) {
+    int max_trips = options_.unroll_max_size / size - 1;
+    for (int trips = 0; trips <= max_trips; ++trips) {
+      int64_t value = start +
+        (int64_t)(trips + counted.step_before_test) * counted.step;
+      if (!fits_int(value)) {
+        break;
+      }
+      if (eval_relational(counted.rel, value, bound) != counted.stay_if_true) {
+        return full_unroll(loop, counted, trips);
+      }
+    }
+  }
+
+  int factor = std::min(options_.unroll_factor,
+                        options_.unroll_max_size / size);
+  if (factor < 2) {
+    return false;
+  }
+  // With a known exit probability the loop runs 1 / P(exit) times per
+  // entry; if that is less than a round of copies, the unrolled loop would
+  // never be entered.
+  TackyBranch exit_test;
+  if (cond_branch(cfg_.blocks[counted.exiting], exit_test) &&
+      exit_test.prob != kUnknownProb) {
+    int stay = (exit_test.if_true == counted.stay) ?
+      exit_test.prob : invert_prob(exit_test.prob);
+    if (100 < factor * (100 - stay)) {
+      return false;
+    }
+  }
+  if (known_bound) {
+    counted.bound = make_tacky<TackyConstant>(bound);
+  }
+  return partial_unroll(loop, counted, factor);
+}
+
+bool LoopUnroll::full_unroll(const TackyLoop& loop, const CountedLoop& counted,
+                             int trip_count) {
+  // trip_count full copies, then the part of the loop up to the exit test
+  std::vector<std::unordered_map<std::string, std::string>> renames;
+  for (int i = 0; i <= trip_count; ++i) {
+    renames.push_back(fresh_labels(loop));
+  }
+
+  auto& header = cfg_.blocks[loop.header].label;
+  std::vector<TackyBlock> blocks;
+  for (int i = 0; i <= trip_count; ++i) {
+    bool last = (i == trip_count);
+    // the last copy never reaches its back edges
+    auto next = last ? counted.exit : renames[i + 1].at(header);
+    auto copy = clone(loop, counted, renames[i], next,
+                      last ? counted.exit : "");
+    std::move(copy.begin(), copy.end(), std::back_inserter(blocks));
+  }
+
+  insert_before(loop, std::move(blocks), false);
+  cfg_.remove_unreachable();
+  return true;
+}
+
+bool LoopUnroll::partial_unroll(const TackyLoop& loop,
+                                const CountedLoop& counted, int factor) {
+  // All `factor` copies stay in the loop iff the exit test of the last one
+  // does, since the induction variable moves monotonically toward the bound.
+  TokenType rel = counted.stay_if_true ?
+    counted.rel : negate_relational(counted.rel);
+  bool up = (rel == TokenType::LESS || rel == TokenType::LESS_EQUAL);
+  bool down = (rel == TokenType::GREATER || rel == TokenType::GREATER_EQUAL);
+  if (!(up && counted.step > 0) && !(down && counted.step < 0)) {
+    return false;
+  }
+
+  // iv + delta REL bound  <=>  iv REL bound - delta
+  int64_t delta = (int64_t)(factor - 1 + counted.step_before_test) *
+    counted.step;
+  if (!fits_int(delta)) {
+    return false;
+  }
+
+  auto& header = cfg_.blocks[loop.header].label;
+  std::vector<TackyBlock> blocks;
+  std::shared_ptr<Tacky> limit;
+  auto main_header = TackyCFG::unique_label("unroll_main");
+  if (auto bound = std::get_if<TackyConstant>(counted.bound.get())) {
+    if (!fits_int(bound->value - delta)) {
+      return false;
+    }
+    limit = make_tacky<TackyConstant>((int)(bound->value - delta));
+  } else {
+    // limit = bound - delta, unless that would wrap around
+    limit = make_tacky<TackyVar>(TackyCFG::unique_var());
+    auto wraps = make_tacky<TackyVar>(TackyCFG::unique_var());
+    TackyBlock guard{TackyCFG::unique_label("unroll_guard"), {}};
+    guard.instructions = {
+      make_tacky<TackyBinary>(
+        make_op(up ? TokenType::LESS : TokenType::GREATER), counted.bound,
+        make_tacky<TackyConstant>((int)((up ? INT_MIN : INT_MAX) + delta)), wraps),
+      make_tacky<TackyJumpIfNotZero>(wraps, make_tacky<TackyLabel>(header),
+                                     kUnknownProb),
+      make_tacky<TackyBinary>(make_op(TokenType::MINUS), counted.bound,
+                              make_tacky<TackyConstant>((int)delta), limit),
+      make_tacky<TackyJump>(make_tacky<TackyLabel>(main_header))};
+    blocks.emplace_back(std::move(guard));
+  }
+
+  std::vector<std::unordered_map<std::string, std::string>> renames;
+  for (int i = 0; i < factor; ++i) {
+    renames.push_back(fresh_labels(loop));
+  }
+
+  // the main loop leaves for the original loop, which finishes the job
+  auto test = make_tacky<TackyVar>(TackyCFG::unique_var());
+  TackyBlock main{main_header, {
+    make_tacky<TackyBinary>(make_op(rel),
+      make_tacky<TackyVar>(counted.iv), limit, test),
+    make_tacky<TackyJumpIfZero>(test, make_tacky<TackyLabel>(header),
+                                kUnknownProb),
+    make_tacky<TackyJump>(make_tacky<TackyLabel>(renames[0].at(header)))}};
+  blocks.emplace_back(std::move(main));
+
+  for (int i = 0; i < factor; ++i) {
+    auto next = (i + 1 < factor) ? renames[i + 1].at(header) : main_header;
+    auto copy = clone(loop, counted, renames[i], next, "");
+    std::move(copy.begin(), copy.end(), std::back_inserter(blocks));
+  }
+
+  done_.insert(main_header);
+  insert_before(loop, std::move(blocks), true);
+  return true;
+}
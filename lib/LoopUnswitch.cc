@@ -0,0 +1,209 @@
+#include "LoopUnswitch.h"
+#include "LoopAnalysis.h"
+#include "Util.h"
+#include <algorithm>
+#include <numeric>
+#include <unordered_map>
+
+using namespace ccomp;
+
+LoopUnswitch::LoopUnswitch(TackyCFG& cfg, const Options& options) :
+  cfg_(cfg), options_(options)
+{}
+
+bool LoopUnswitch::run() {
+  if (options_.unswitch_max_growth <= 0) {
+    return false;
+  }
+
+  bool changed = false;
+  bool progress = true;
+  while (progress) {
+    progress = false;
+    // outer loops first, so that a test is hoisted as far as it can go
+    std::vector<size_t> order(cfg_.loops.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(), [this](size_t a, size_t b) {
+      return cfg_.loops[a].blocks.size() > cfg_.loops[b].blocks.size();
+    });
+    for (size_t i : order) {
+      // unswitching rebuilds the loop list
+      if (unswitch(cfg_.loops[i])) {
+        changed = progress = true;
+        break;
+      }
+    }
+  }
+  return changed;
+}
+
+bool LoopUnswitch::invariant_chain(const TackyLoop& loop,
+                                   const std::string& var, int block,
+                                   int index,
+                                   std::vector<std::shared_ptr<Tacky>>& chain) const {
+  int defs = 0, def_block = -1, def_index = -1;
+  for (int b : loop.blocks) {
+    auto& insts = cfg_.blocks[b].instructions;
+    for (size_t i = 0; i < insts.size(); ++i) {
+      auto dest = var_name(tacky_dest(*insts[i]));
+      if (dest && *dest == var) {
+        ++defs;
+        def_block = b;
+        def_index = i;
+      }
+    }
+  }
+  if (defs == 0) {
+    return true;
+  } else if (defs > 1) {
+    return false;
+  }
+
+  // the value read must come from this iteration's definition
+  bool reaches = (def_block == block) ?
+    def_index < index : cfg_.dominates(def_block, block);
+  if (!reaches) {
+    return false;
+  }
+  auto& inst = cfg_.blocks[def_block].instructions[def_index];
+  if (std::find(chain.begin(), chain.end(), inst) != chain.end()) {
+    return true;
+  }
+  if (!std::holds_alternative<TackyUnary>(*inst) &&
+      !std::holds_alternative<TackyBinary>(*inst) &&
+      !std::holds_alternative<TackyCopy>(*inst)) {
+    return false;
+  }
+
+  // hoisting must not make a division trap on a path that did not divide
+  if (auto bin = std::get_if<TackyBinary>(inst.get());
+      bin && one_of(bin->op.type, {TokenType::SLASH, TokenType::PERCENT})) {
+    return false;
+  }
+  for (auto& src : tacky_srcs(*inst)) {
+    auto name = var_name(src);
+    if (name && !invariant_chain(loop, *name, def_block, def_index, chain)) {
+      return false;
+    }
+  }
+  chain.push_back(inst);
+  return true;
+}
+
+bool LoopUnswitch::unswitch(const TackyLoop& loop) {
+  int size = 0;
+  for (int block : loop.blocks) {
+    for (auto& inst : cfg_.blocks[block].instructions) {
+      if (!is_terminator(*inst)) {
+        ++size;
+      }
+    }
+  }
+  if (growth_ + size > options_.unswitch_max_growth) {
+    return false;
+  }
+
+  for (int block : loop.blocks) {
+    auto& insts = cfg_.blocks[block].instructions;
+    TackyBranch branch;
+    if (!cond_branch(cfg_.blocks[block], branch) ||
+        branch.if_true == branch.if_false) {
+      continue;
+    }
+    auto condition = branch.condition;
+    auto cond = var_name(condition);
+    std::vector<std::shared_ptr<Tacky>> chain;
+    if (cond == nullptr ||
+        !invariant_chain(loop, *cond, block, insts.size() - 2, chain)) {
+      continue;
+    }
+    auto& if_true = branch.if_true;
+    auto& if_false = branch.if_false;
+
+    // the compare goes away with the branch if nothing else reads it
+    std::shared_ptr<Tacky> dead;
+    if (!chain.empty() && count_uses(cfg_, *cond) == 1) {
+      dead = chain.back();
+    }
+
+    // test the condition once, on fresh temporaries
+    auto& header = cfg_.blocks[loop.header].label;
+    std::unordered_map<std::string, std::shared_ptr<Tacky>> hoisted;
+    auto subst = [&hoisted](const std::shared_ptr<Tacky>& val) {
+      auto name = var_name(val);
+      auto it = name ? hoisted.find(*name) : hoisted.end();
+      return (it == hoisted.end()) ? val : it->second;
+    };
+    TackyBlock test{TackyCFG::unique_label("unswitch"), {}};
+    for (auto& inst : chain) {
+      auto dest = make_tacky<TackyVar>(TackyCFG::unique_var());
+      if (auto unary = std::get_if<TackyUnary>(inst.get())) {
+        test.instructions.emplace_back(
+          make_tacky<TackyUnary>(unary->op, subst(unary->src), dest));
+      } else if (auto bin = std::get_if<TackyBinary>(inst.get())) {
+        test.instructions.emplace_back(make_tacky<TackyBinary>(
+          bin->op, subst(bin->src1), subst(bin->src2), dest));
+      } else if (auto copy = std::get_if<TackyCopy>(inst.get())) {
+        test.instructions.emplace_back(
+          make_tacky<TackyCopy>(subst(copy->src), dest));
+      }
+      hoisted[*var_name(tacky_dest(*inst))] = dest;
+    }
+
+    // the copy takes the true side, the original loop the false side
+    std::unordered_map<std::string, std::string> rename;
+    for (int b : loop.blocks) {
+      rename[cfg_.blocks[b].label] = TackyCFG::unique_label("unswitch");
+    }
+    test.instructions.emplace_back(make_tacky<TackyJumpIfZero>(
+      subst(condition), make_tacky<TackyLabel>(header),
+      invert_prob(branch.prob)));
+    test.instructions.emplace_back(
+      make_tacky<TackyJump>(make_tacky<TackyLabel>(rename.at(header))));
+
+    auto fold = [&](TackyBlock& b, bool is_branch, const std::string& to) {
+      if (is_branch) {
+        b.instructions.resize(b.instructions.size() - 2);
+        b.instructions.emplace_back(
+          make_tacky<TackyJump>(make_tacky<TackyLabel>(to)));
+      }
+      std::erase(b.instructions, dead);
+    };
+
+    std::vector<TackyBlock> blocks = {std::move(test)};
+    for (int b : loop.blocks) {
+      auto& orig = cfg_.blocks[b];
+      TackyBlock copy{rename.at(orig.label), orig.instructions};
+      fold(copy, b == block, if_true);
+      for (auto& succ : successors(orig)) {
+        if (auto it = rename.find(succ); it != rename.end()) {
+          retarget(copy, succ, it->second);
+        }
+      }
+      blocks.emplace_back(std::move(copy));
+    }
+    for (int b : loop.blocks) {
+      fold(cfg_.blocks[b], b == block, if_false);
+    }
+
+    // enter through the test
+    for (int pred : cfg_.preds[loop.header]) {
+      if (!cfg_.in_loop(loop, pred)) {
+        retarget(cfg_.blocks[pred], header, blocks.front().label);
+      }
+    }
+    std::vector<TackyBlock> layout;
+    for (size_t i = 0; i < cfg_.blocks.size(); ++i) {
+      if ((int)i == loop.blocks.front()) {
+        std::move(blocks.begin(), blocks.end(), std::back_inserter(layout));
+      }
+      layout.emplace_back(std::move(cfg_.blocks[i]));
+    }
+    growth_ += size + (int)chain.size();
+    cfg_.blocks = std::move(layout);
+    cfg_.analyze();
+    cfg_.remove_unreachable();
+    return true;
+  }
+  return false;
+}
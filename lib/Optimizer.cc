@@ -0,0 +1,56 @@
+#include "Optimizer.h"
+#include "CodeSinking.h"
+#include "IfConversion.h"
+#include "JumpThreading.h"
+#include "LoopUnroll.h"
+#include "LoopUnswitch.h"
+#include "Reassociate.h"
+#include "ScalarEvolution.h"
+#include "TackyCFG.h"
+#include <cassert>
+
+using namespace ccomp;
+
+Optimizer::Optimizer(Tacky* tackycode, const Options& options,
+                     Profile& profile, ErrorHandler& errorHandler) :
+  tackycode_(tackycode), options_(options), profile_(profile),
+  errorHandler_(errorHandler)
+{}
+
+void Optimizer::optimize() {
+  auto prog = std::get_if<TackyProgram>(tackycode_);
+  assert(prog != nullptr);
+  for (auto& fn : prog->functions) {
+    optimize(std::get<TackyFunction>(*fn));
+  }
+}
+
+void Optimizer::optimize(TackyFunction& fn) {
+  TackyCFG cfg(fn.instructions);
+  // the return 0 TackyGen appends is dead when every path returned already
+  cfg.remove_unreachable();
+  profile_.apply(fn.name.lexeme, cfg);
+
+  JumpThreading threading(cfg, options_);
+  threading.run();
+
+  LoopUnswitch unswitch(cfg, options_);
+  unswitch.run();
+
+  ScalarEvolution scev(cfg);
+  scev.run();
+
+  LoopUnroll unroll(cfg, options_);
+  unroll.run();
+
+  Reassociate reassociate(cfg, options_);
+  reassociate.run();
+
+  CodeSinking sinking(cfg);
+  sinking.run();
+
+  IfConversion ifconv(cfg, options_);
+  ifconv.run();
+
+  fn.instructions = cfg.instructions();
+}
@@ -88,6 +88,15 @@ std::unique_ptr<Stmt> Parser::statement() {
   case TokenType::FOR:
     match({TokenType::FOR});
     return forStatement();
+  case TokenType::SWITCH:
+    match({TokenType::SWITCH});
+    return switchStatement();
+  case TokenType::CASE:
+    match({TokenType::CASE});
+    return caseStatement();
+  case TokenType::DEFAULT:
+    match({TokenType::DEFAULT});
+    return defaultStatement();
   case TokenType::BREAK:
     match({TokenType::BREAK});
     consume(TokenType::SEMICOLON, "Expected ';' after break.");
@@ -191,6 +200,39 @@ std::unique_ptr<Stmt> Parser::forStatement() {
   return body;
 }
 
+std::unique_ptr<Stmt> Parser::switchStatement() {
+  // switch (condition)
+  //   statement
+  Token keyword = previous();
+  consume(TokenType::LEFT_PAREN, "need '(' in condition for switch");
+  auto condition = expression();
+  consume(TokenType::RIGHT_PAREN, "need ')' in condition for switch");
+
+  auto body = statement();
+  return std::make_unique<Stmt>(
+    Switch(keyword, std::move(condition), std::move(body), -1, {}, false));
+}
+
+std::unique_ptr<Stmt> Parser::caseStatement() {
+  // case constant: statement
+  // the constant is folded by the resolver
+  Token keyword = previous();
+  auto value = conditional_ternary();
+  consume(TokenType::COLON, "Expected ':' after case value");
+
+  auto body = statement();
+  return std::make_unique<Stmt>(
+    Case(keyword, std::move(value), std::move(body), -1, -1));
+}
+
+std::unique_ptr<Stmt> Parser::defaultStatement() {
+  Token keyword = previous();
+  consume(TokenType::COLON, "Expected ':' after default");
+
+  auto body = statement();
+  return std::make_unique<Stmt>(Default(keyword, std::move(body), -1));
+}
+
 Block Parser::blockStatement() {
   std::vector<std::unique_ptr<Stmt>> stmts;
 
@@ -376,12 +418,29 @@ std::unique_ptr<Expr> Parser::primary() {
     // return std::static_pointer_cast<Expr>(std::make_unique<GroupingExpr>(expr));
   }
   if (match({TokenType::IDENTIFIER})) {
+    if (previous().lexeme == "__builtin_expect" &&
+        check(TokenType::LEFT_PAREN)) {
+      return builtinExpect();
+    }
     return std::make_unique<Expr>(Variable(previous(), -1));
   }
   throw error(peek(), "Expected expression.");
   return nullptr;
 }
 
+std::unique_ptr<Expr> Parser::builtinExpect() {
+  // __builtin_expect(value, expected)
+  // the expected value is folded by the resolver
+  Token keyword = previous();
+  consume(TokenType::LEFT_PAREN, "Expected '(' after __builtin_expect");
+  auto value = expression();
+  consume(TokenType::COMMA, "Expected ',' in __builtin_expect");
+  auto expected = expression();
+  consume(TokenType::RIGHT_PAREN, "Expected ')' after __builtin_expect");
+  return std::make_unique<Expr>(
+    Expect(keyword, std::move(value), std::move(expected), false));
+}
+
 std::vector<std::unique_ptr<Stmt>> Parser::parse() {
   std::vector<std::unique_ptr<Stmt>> stmts;
 
@@ -448,6 +507,7 @@ void Parser::synchronize() {
     case TokenType::FOR:
     case TokenType::IF:
     case TokenType::WHILE:
+    case TokenType::SWITCH:
     case TokenType::PRINT:
     case TokenType::RETURN:
       return;
@@ -0,0 +1,522 @@
+#include "Peephole.h"
+#include "Superopt.h"
+#include "Util.h"
+#include <unordered_set>
+
+using namespace ccomp;
+
+const std::vector<Peephole::Rule> Peephole::kRules = {
+  {"jump-to-next", &Peephole::jump_to_next},
+  {"jump-over-jump", &Peephole::jump_over_jump},
+  {"jump-chain", &Peephole::jump_chain},
+  {"unreachable", &Peephole::unreachable},
+  {"unused-label", &Peephole::unused_label},
+  {"self-move", &Peephole::self_move},
+  {"move-back", &Peephole::move_back},
+  {"zero-setcc", &Peephole::zero_setcc},
+  {"redundant-test", &Peephole::redundant_test},
+  {"superopt", &Peephole::superopt},
+};
+
+// the label a Jmp or JmpCC goes to, or null
+static const std::string* jump_target(const Asm& inst) {
+  if (auto jmp = std::get_if<AsmJmp>(&inst)) {
+    return &std::get<AsmLabel>(*jmp->target).identifier;
+  } else if (auto jmpcc = std::get_if<AsmJmpCC>(&inst)) {
+    return &std::get<AsmLabel>(*jmpcc->target).identifier;
+  }
+  return nullptr;
+}
+
+static bool same_operand(const std::shared_ptr<Asm>& a,
+                         const std::shared_ptr<Asm>& b) {
+  if (auto ra = std::get_if<AsmRegister>(a.get())) {
+    auto rb = std::get_if<AsmRegister>(b.get());
+    return rb && ra->reg == rb->reg;
+  } else if (auto sa = std::get_if<AsmStack>(a.get())) {
+    auto sb = std::get_if<AsmStack>(b.get());
+    return sb && sa->offset == sb->offset;
+  }
+  return false;
+}
+
+// control never falls through to the next instruction
+static bool ends_flow(const Asm& inst) {
+  return std::holds_alternative<AsmJmp>(inst) ||
+    std::holds_alternative<AsmReturn>(inst) ||
+    std::holds_alternative<AsmJumpTable>(inst);
+}
+
+static bool writes_flags(const Asm& inst) {
+  if (auto unary = std::get_if<AsmUnary>(&inst)) {
+    return unary->op.type == TokenType::MINUS;
+  }
+  return std::holds_alternative<AsmCmp>(inst) ||
+    std::holds_alternative<AsmTest>(inst) ||
+    std::holds_alternative<AsmBinary>(inst) ||
+    std::holds_alternative<AsmShift>(inst) ||
+    std::holds_alternative<AsmImulImm>(inst) ||
+    std::holds_alternative<AsmImulHi>(inst) ||
+    std::holds_alternative<AsmIdiv>(inst) ||
+    std::holds_alternative<AsmCount>(inst);
+}
+
+Peephole::Peephole(std::vector<std::shared_ptr<Asm>>& instructions) :
+  instructions_(instructions), hits_(kRules.size(), 0)
+{}
+
+std::vector<std::pair<std::string, int>> Peephole::hits() const {
+  std::vector<std::pair<std::string, int>> result;
+  for (size_t r = 0; r < kRules.size(); ++r) {
+    result.emplace_back(kRules[r].name, hits_[r]);
+  }
+  return result;
+}
+
+void Peephole::run() {
+  bool changed = true;
+  while (changed) {
+    changed = false;
+    index();
+    for (size_t i = 0; i < instructions_.size(); ++i) {
+      for (size_t r = 0; r < kRules.size() && i < instructions_.size(); ++r) {
+        if ((this->*kRules[r].apply)(i)) {
+          ++hits_[r];
+          changed = true;
+          index();
+        }
+      }
+    }
+  }
+}
+
+void Peephole::index() {
+  labels_.clear();
+  refs_.clear();
+  for (size_t i = 0; i < instructions_.size(); ++i) {
+    auto& inst = *instructions_[i];
+    if (auto label = std::get_if<AsmLabel>(&inst)) {
+      labels_[label->identifier] = i;
+    } else if (auto target = jump_target(inst)) {
+      ++refs_[*target];
+    } else if (auto table = std::get_if<AsmJumpTable>(&inst)) {
+      for (auto& entry : table->targets) {
+        ++refs_[std::get<AsmLabel>(*entry).identifier];
+      }
+    }
+  }
+}
+
+void Peephole::replace(size_t i, size_t count,
+                       std::vector<std::shared_ptr<Asm>> with) {
+  auto at = instructions_.begin() + i;
+  instructions_.erase(at, at + count);
+  instructions_.insert(instructions_.begin() + i, with.begin(), with.end());
+}
+
+bool Peephole::flags_only_zero(size_t i) const {
+  auto zero_test = [](AsmCondCode cc) {
+    return cc == AsmCondCode::E || cc == AsmCondCode::NE;
+  };
+  for (size_t j = i + 1; j < instructions_.size(); ++j) {
+    auto& inst = *instructions_[j];
+    if (auto jmpcc = std::get_if<AsmJmpCC>(&inst)) {
+      if (!zero_test(jmpcc->cond_code)) {
+        return false;
+      }
+    } else if (auto setcc = std::get_if<AsmSetCC>(&inst)) {
+      if (!zero_test(setcc->cond_code)) {
+        return false;
+      }
+    } else if (auto cmov = std::get_if<AsmCMovCC>(&inst)) {
+      if (!zero_test(cmov->cond_code)) {
+        return false;
+      }
+    } else if (std::holds_alternative<AsmLabel>(inst) || ends_flow(inst) ||
+               writes_flags(inst)) {
+      return true;
+    }
+  }
+  return true;
+}
+
+bool Peephole::flags_dead(size_t i) const {
+  for (size_t j = i; j < instructions_.size(); ++j) {
+    auto& inst = *instructions_[j];
+    if (std::holds_alternative<AsmJmpCC>(inst) ||
+        std::holds_alternative<AsmSetCC>(inst) ||
+        std::holds_alternative<AsmCMovCC>(inst)) {
+      return false;
+    } else if (std::holds_alternative<AsmLabel>(inst) || ends_flow(inst) ||
+               writes_flags(inst)) {
+      return true;
+    }
+  }
+  return true;
+}
+
+std::string Peephole::final_target(const std::string& label) const {
+  // follow L: jmp M until it ends, giving up on cycles
+  std::unordered_set<std::string> seen;
+  std::string cur = label;
+  while (seen.insert(cur).second) {
+    size_t j = labels_.at(cur);
+    while (j < instructions_.size() &&
+           std::holds_alternative<AsmLabel>(*instructions_[j])) {
+      ++j;
+    }
+    if (j == instructions_.size() ||
+        !std::holds_alternative<AsmJmp>(*instructions_[j])) {
+      return cur;
+    }
+    cur = *jump_target(*instructions_[j]);
+  }
+  return label;
+}
+
+// Jmp|JmpCC(L); Label(L) => Label(L)
+bool Peephole::jump_to_next(size_t i) {
+  auto target = jump_target(*instructions_[i]);
+  if (target == nullptr) {
+    return false;
+  }
+  for (size_t j = i + 1; j < instructions_.size(); ++j) {
+    auto label = std::get_if<AsmLabel>(instructions_[j].get());
+    if (label == nullptr) {
+      return false;
+    }
+    if (label->identifier == *target) {
+      replace(i, 1, {});
+      return true;
+    }
+  }
+  return false;
+}
+
+// JmpCC(cc, L1); Jmp(L2); Label(L1) => JmpCC(!cc, L2); Label(L1)
+bool Peephole::jump_over_jump(size_t i) {
+  if (i + 2 >= instructions_.size()) {
+    return false;
+  }
+  auto jmpcc = std::get_if<AsmJmpCC>(instructions_[i].get());
+  auto jmp = std::get_if<AsmJmp>(instructions_[i + 1].get());
+  auto label = std::get_if<AsmLabel>(instructions_[i + 2].get());
+  if (!jmpcc || !jmp || !label ||
+      label->identifier != *jump_target(*instructions_[i])) {
+    return false;
+  }
+  replace(i, 2, {make_asm<AsmJmpCC>(invert(jmpcc->cond_code), jmp->target,
+                                    invert_prob(jmpcc->prob))});
+  return true;
+}
+
+// Jmp|JmpCC|JumpTable(L) with L: Jmp(M) => Jmp|JmpCC|JumpTable(M)
+bool Peephole::jump_chain(size_t i) {
+  auto retarget = [this](const std::shared_ptr<Asm>& target) {
+    auto& label = std::get<AsmLabel>(*target).identifier;
+    auto final = final_target(label);
+    return (final == label) ? target : make_asm<AsmLabel>(final);
+  };
+  auto& inst = instructions_[i];
+  std::shared_ptr<Asm> rewritten;
+  if (auto jmp = std::get_if<AsmJmp>(inst.get())) {
+    if (auto target = retarget(jmp->target); target != jmp->target) {
+      rewritten = make_asm<AsmJmp>(target);
+    }
+  } else if (auto jmpcc = std::get_if<AsmJmpCC>(inst.get())) {
+    if (auto target = retarget(jmpcc->target); target != jmpcc->target) {
+      rewritten = make_asm<AsmJmpCC>(jmpcc->cond_code, target, jmpcc->prob);
+    }
+  } else if (auto table = std::get_if<AsmJumpTable>(inst.get())) {
+    std::vector<std::shared_ptr<Asm>> targets;
+    bool changed = false;
+    for (auto& target : table->targets) {
+      targets.push_back(retarget(target));
+      changed |= targets.back() != target;
+    }
+    if (changed) {
+      rewritten = make_asm<AsmJumpTable>(table->index, targets);
+    }
+  }
+  if (rewritten == nullptr) {
+    return false;
+  }
+  replace(i, 1, {rewritten});
+  return true;
+}
+
+// Jmp|Return|JumpTable; <no label>... => Jmp|Return|JumpTable
+bool Peephole::unreachable(size_t i) {
+  if (!ends_flow(*instructions_[i])) {
+    return false;
+  }
+  size_t j = i + 1;
+  while (j < instructions_.size() &&
+         !std::holds_alternative<AsmLabel>(*instructions_[j])) {
+    ++j;
+  }
+  if (j == i + 1) {
+    return false;
+  }
+  replace(i + 1, j - i - 1, {});
+  return true;
+}
+
+// Label(L) that nothing jumps to => nothing
+bool Peephole::unused_label(size_t i) {
+  auto label = std::get_if<AsmLabel>(instructions_[i].get());
+  if (label == nullptr || refs_.contains(label->identifier)) {
+    return false;
+  }
+  replace(i, 1, {});
+  return true;
+}
+
+// Mov(x, x) => nothing
+bool Peephole::self_move(size_t i) {
+  auto mov = std::get_if<AsmMov>(instructions_[i].get());
+  if (mov == nullptr || !same_operand(mov->src, mov->dest)) {
+    return false;
+  }
+  replace(i, 1, {});
+  return true;
+}
+
+// Mov(a, b); Mov(b, a) => Mov(a, b)
+bool Peephole::move_back(size_t i) {
+  if (i + 1 >= instructions_.size()) {
+    return false;
+  }
+  auto first = std::get_if<AsmMov>(instructions_[i].get());
+  auto second = std::get_if<AsmMov>(instructions_[i + 1].get());
+  if (!first || !second || !same_operand(first->src, second->dest) ||
+      !same_operand(first->dest, second->src)) {
+    return false;
+  }
+  replace(i + 1, 1, {});
+  return true;
+}
+
+// Cmp|Test(a, b); Mov(Imm(0), r); SetCC(cc, r) =>
+//   Binary(^, r, r); Cmp|Test(a, b); SetCC(cc, r)
+// with r a register the compare does not read
+bool Peephole::zero_setcc(size_t i) {
+  if (i + 2 >= instructions_.size()) {
+    return false;
+  }
+  auto& compare = instructions_[i];
+  std::shared_ptr<Asm> a, b;
+  if (auto cmp = std::get_if<AsmCmp>(compare.get())) {
+    a = cmp->operand1;
+    b = cmp->operand2;
+  } else if (auto test = std::get_if<AsmTest>(compare.get())) {
+    a = test->operand1;
+    b = test->operand2;
+  } else {
+    return false;
+  }
+  auto mov = std::get_if<AsmMov>(instructions_[i + 1].get());
+  auto setcc = std::get_if<AsmSetCC>(instructions_[i + 2].get());
+  if (!mov || !setcc || !std::holds_alternative<AsmRegister>(*mov->dest) ||
+      !same_operand(mov->dest, setcc->operand)) {
+    return false;
+  }
+  auto imm = std::get_if<AsmImm>(mov->src.get());
+  if (imm == nullptr || imm->value != 0 || same_operand(a, mov->dest) ||
+      same_operand(b, mov->dest)) {
+    return false;
+  }
+  auto zero = make_asm<AsmBinary>(make_op(TokenType::CARET), mov->dest,
+                                  mov->dest);
+  replace(i, 3, {zero, compare, instructions_[i + 2]});
+  return true;
+}
+
+// Binary|Unary|Shift(..., x); Test(x, x)|Cmp(Imm(0), x) => Binary|...
+// when the flags are only read for equality: the operation already set ZF
+// from x
+bool Peephole::redundant_test(size_t i) {
+  if (i + 1 >= instructions_.size()) {
+    return false;
+  }
+  std::shared_ptr<Asm> written;
+  auto& inst = *instructions_[i];
+  if (auto bin = std::get_if<AsmBinary>(&inst);
+      bin && bin->op.type != TokenType::STAR) {
+    written = bin->operand2;
+  } else if (auto unary = std::get_if<AsmUnary>(&inst);
+             unary && unary->op.type == TokenType::MINUS) {
+    written = unary->operand;
+  } else if (auto shift = std::get_if<AsmShift>(&inst)) {
+    written = shift->operand;
+  } else {
+    return false;
+  }
+
+  auto& next = *instructions_[i + 1];
+  if (auto test = std::get_if<AsmTest>(&next)) {
+    if (!same_operand(test->operand1, written) ||
+        !same_operand(test->operand2, written)) {
+      return false;
+    }
+  } else if (auto cmp = std::get_if<AsmCmp>(&next)) {
+    auto imm = std::get_if<AsmImm>(cmp->operand1.get());
+    if (!imm || imm->value != 0 || !same_operand(cmp->operand2, written)) {
+      return false;
+    }
+  } else {
+    return false;
+  }
+  if (!flags_only_zero(i + 1)) {
+    return false;
+  }
+  replace(i + 1, 1, {});
+  return true;
+}
+
+namespace {
+// Registers bound to the pattern registers A and B of a superopt rule.
+struct Binding {
+  std::shared_ptr<Asm> a, b;
+
+  bool bind(const std::shared_ptr<Asm>& pattern,
+            const std::shared_ptr<Asm>& actual) {
+    if (pattern == nullptr || actual == nullptr) {
+      return pattern == actual;
+    } else if (auto imm = std::get_if<AsmImm>(pattern.get())) {
+      auto other = std::get_if<AsmImm>(actual.get());
+      return other && other->value == imm->value;
+    }
+    auto reg = std::get_if<AsmRegister>(actual.get());
+    if (reg == nullptr) {
+      return false;
+    }
+    bool is_a = std::get<AsmPseudo>(*pattern).identifier == "A";
+    auto& mine = is_a ? a : b;
+    auto& theirs = is_a ? b : a;
+    if (mine != nullptr) {
+      return same_operand(mine, actual);
+    } else if (theirs != nullptr && same_operand(theirs, actual)) {
+      return false;
+    }
+    mine = actual;
+    return true;
+  }
+
+  bool match(const Asm& pattern, const Asm& actual) {
+    if (pattern.index() != actual.index()) {
+      return false;
+    }
+    if (auto mov = std::get_if<AsmMov>(&pattern)) {
+      auto& other = std::get<AsmMov>(actual);
+      return bind(mov->src, other.src) && bind(mov->dest, other.dest);
+    } else if (auto bin = std::get_if<AsmBinary>(&pattern)) {
+      auto& other = std::get<AsmBinary>(actual);
+      return bin->op.type == other.op.type &&
+        bind(bin->operand1, other.operand1) &&
+        bind(bin->operand2, other.operand2);
+    } else if (auto unary = std::get_if<AsmUnary>(&pattern)) {
+      auto& other = std::get<AsmUnary>(actual);
+      return unary->op.type == other.op.type &&
+        bind(unary->operand, other.operand);
+    } else if (auto shift = std::get_if<AsmShift>(&pattern)) {
+      auto& other = std::get<AsmShift>(actual);
+      return shift->op == other.op && shift->count == other.count &&
+        bind(shift->operand, other.operand);
+    } else if (auto lea = std::get_if<AsmLea>(&pattern)) {
+      auto& other = std::get<AsmLea>(actual);
+      return lea->scale == other.scale && lea->disp == other.disp &&
+        bind(lea->base, other.base) && bind(lea->index, other.index) &&
+        bind(lea->dest, other.dest);
+    } else if (auto imul = std::get_if<AsmImulImm>(&pattern)) {
+      auto& other = std::get<AsmImulImm>(actual);
+      return imul->value == other.value && bind(imul->src, other.src) &&
+        bind(imul->dest, other.dest);
+    }
+    return false;
+  }
+
+  // the operand a replacement names, or nullptr if it names an unbound
+  // register
+  std::shared_ptr<Asm> operand(const std::shared_ptr<Asm>& pattern) const {
+    auto pseudo = pattern ? std::get_if<AsmPseudo>(pattern.get()) : nullptr;
+    if (pseudo == nullptr) {
+      return pattern;
+    }
+    return (pseudo->identifier == "A") ? a : b;
+  }
+
+  std::shared_ptr<Asm> instantiate(const Asm& inst) const {
+    auto filled = [this](const std::shared_ptr<Asm>& pattern, bool& ok) {
+      auto result = operand(pattern);
+      ok &= (pattern == nullptr) == (result == nullptr);
+      return result;
+    };
+    bool ok = true;
+    std::shared_ptr<Asm> result;
+    if (auto mov = std::get_if<AsmMov>(&inst)) {
+      result = make_asm<AsmMov>(filled(mov->src, ok), filled(mov->dest, ok));
+    } else if (auto bin = std::get_if<AsmBinary>(&inst)) {
+      result = make_asm<AsmBinary>(bin->op, filled(bin->operand1, ok),
+                                   filled(bin->operand2, ok));
+    } else if (auto unary = std::get_if<AsmUnary>(&inst)) {
+      result = make_asm<AsmUnary>(unary->op, filled(unary->operand, ok));
+    } else if (auto shift = std::get_if<AsmShift>(&inst)) {
+      result = make_asm<AsmShift>(shift->op, shift->count,
+                                  filled(shift->operand, ok));
+    } else if (auto lea = std::get_if<AsmLea>(&inst)) {
+      result = make_asm<AsmLea>(filled(lea->base, ok), filled(lea->index, ok),
+                                lea->scale, lea->disp, filled(lea->dest, ok));
+    } else if (auto imul = std::get_if<AsmImulImm>(&inst)) {
+      result = make_asm<AsmImulImm>(imul->value, filled(imul->src, ok),
+                                    filled(imul->dest, ok));
+    }
+    return ok ? result : nullptr;
+  }
+};
+}
+
+// <pattern of a superopt rule> => <its replacement>
+// with A and B bound to distinct registers and the flags dead afterwards,
+// since the replacement may set them differently
+bool Peephole::superopt(size_t i) {
+  // rules by the kind of their first instruction
+  static const auto by_first = [] {
+    std::unordered_map<size_t, std::vector<const SuperoptRule*>> rules;
+    for (auto& rule : superopt_rules()) {
+      rules[rule.pattern.front()->index()].push_back(&rule);
+    }
+    return rules;
+  }();
+  auto it = by_first.find(instructions_[i]->index());
+  if (it == by_first.end()) {
+    return false;
+  }
+  for (auto rule : it->second) {
+    size_t length = rule->pattern.size();
+    if (i + length > instructions_.size()) {
+      continue;
+    }
+    Binding binding;
+    bool matched = true;
+    for (size_t k = 0; k < length && matched; ++k) {
+      matched = binding.match(*rule->pattern[k], *instructions_[i + k]);
+    }
+    if (!matched || !flags_dead(i + length)) {
+      continue;
+    }
+    std::vector<std::shared_ptr<Asm>> with;
+    for (auto& inst : rule->replacement) {
+      with.push_back(binding.instantiate(*inst));
+      if (with.back() == nullptr) {
+        break;
+      }
+    }
+    if (!with.empty() && with.back() == nullptr) {
+      continue;
+    }
+    replace(i, length, with);
+    return true;
+  }
+  return false;
+}
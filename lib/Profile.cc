@@ -0,0 +1,192 @@
+#include "Profile.h"
+#include "Util.h"
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+
+using namespace ccomp;
+
+Profile::Profile(const Options& options) :
+  options_(options)
+{}
+
+bool Profile::load() {
+  auto& path = options_.profile_use;
+  std::ifstream file(path, std::ios::binary);
+  if (!file.is_open()) {
+    fprintf(stderr, "warning: cannot open profile %s\n", path.c_str());
+    return false;
+  }
+  std::vector<char> data((std::istreambuf_iterator<char>(file)),
+                         std::istreambuf_iterator<char>());
+
+  size_t pos = 0;
+  auto read = [&data, &pos](void* out, size_t size) {
+    if (data.size() - pos < size) {
+      return false;
+    }
+    memcpy(out, data.data() + pos, size);
+    pos += size;
+    return true;
+  };
+  char magic[8];
+  bool ok = read(magic, sizeof(magic)) && memcmp(magic, kMagic, 8) == 0;
+  while (ok && pos < data.size()) {
+    FunctionCounts fn;
+    uint64_t size, length;
+    ok = read(&fn.checksum, 8) && read(&size, 8) && read(&length, 8) &&
+      length <= data.size() - pos;
+    if (!ok) {
+      break;
+    }
+    std::string name(data.data() + pos, length);
+    pos += length;
+    ok = size <= (data.size() - pos) / 8;
+    if (ok) {
+      fn.counts.resize(size);
+      read(fn.counts.data(), size * 8);
+      loaded_[name] = std::move(fn);
+    }
+  }
+  if (!ok) {
+    fprintf(stderr, "warning: profile %s is corrupt, ignoring it\n",
+            path.c_str());
+    loaded_.clear();
+  }
+  return ok;
+}
+
+uint64_t Profile::checksum(const TackyCFG& cfg) {
+  // FNV-1a over the shape of the CFG and the kinds of its instructions;
+  // labels and names are left out, as they are numbered program-wide
+  uint64_t hash = 14695981039346656037ull;
+  auto mix = [&hash](uint64_t value) {
+    hash = (hash ^ value) * 1099511628211ull;
+  };
+  mix(cfg.blocks.size());
+  for (size_t b = 0; b < cfg.blocks.size(); ++b) {
+    mix(cfg.blocks[b].instructions.size());
+    for (auto& inst : cfg.blocks[b].instructions) {
+      mix(inst->index());
+    }
+    for (int succ : cfg.succs[b]) {
+      mix(succ);
+    }
+  }
+  return hash;
+}
+
+void Profile::apply(const std::string& name, TackyCFG& cfg) {
+  auto sum = checksum(cfg);
+  std::vector<int> branches;
+  for (size_t b = 0; b < cfg.blocks.size(); ++b) {
+    TackyBranch branch;
+    if (cond_branch(cfg.blocks[b], branch)) {
+      branches.push_back(b);
+    }
+  }
+  if (!options_.profile_use.empty()) {
+    annotate(name, sum, branches, cfg);
+  }
+  if (!options_.profile_generate.empty()) {
+    instrument(branches, cfg);
+    counters_.push_back({name, sum, 1 + 2 * (int)branches.size()});
+  }
+}
+
+void Profile::annotate(const std::string& name, uint64_t sum,
+                       const std::vector<int>& branches, TackyCFG& cfg) {
+  auto it = loaded_.find(name);
+  if (it == loaded_.end()) {
+    return;
+  }
+  auto& counts = it->second.counts;
+  if (it->second.checksum != sum || counts.size() != 1 + 2 * branches.size()) {
+    fprintf(stderr, "warning: profile of %s does not match its code, "
+            "ignoring it\n", name.c_str());
+    return;
+  }
+  entries_[name] = counts[0];
+
+  int annotated = 0;
+  for (size_t k = 0; k < branches.size(); ++k) {
+    uint64_t if_false = counts[2 * k + 1], if_true = counts[2 * k + 2];
+    uint64_t total = if_false + if_true;
+    // a branch that never ran keeps the static heuristics
+    if (total == 0) {
+      continue;
+    }
+    int prob = (if_true * 100 + total / 2) / total;
+    auto& insts = cfg.blocks[branches[k]].instructions;
+    auto& jump = insts[insts.size() - 2];
+    if (auto jz = std::get_if<TackyJumpIfZero>(jump.get())) {
+      jump = make_tacky<TackyJumpIfZero>(jz->condition, jz->target,
+                                         invert_prob(prob));
+    } else if (auto jnz = std::get_if<TackyJumpIfNotZero>(jump.get())) {
+      jump = make_tacky<TackyJumpIfNotZero>(jnz->condition, jnz->target, prob);
+    }
+    ++annotated;
+  }
+  if (options_.stats) {
+    fprintf(stderr, "%s: profile %llu calls, %d of %zu branches annotated\n",
+            name.c_str(), (unsigned long long)counts[0], annotated,
+            branches.size());
+  }
+}
+
+void Profile::instrument(const std::vector<int>& branches, TackyCFG& cfg) {
+  // Every edge out of a branch gets a block bumping its counter; the one
+  // the branch's final Jump takes goes right after it, to fall through.
+  std::vector<std::vector<TackyBlock>> edges(cfg.blocks.size());
+  for (size_t k = 0; k < branches.size(); ++k) {
+    auto& block = cfg.blocks[branches[k]];
+    TackyBranch branch;
+    cond_branch(block, branch);
+    auto& jmp = std::get<TackyJump>(*block.instructions.back());
+    auto& fall = std::get<TackyLabel>(*jmp.target).identifier;
+    std::vector<std::pair<std::string, int>> targets = {
+      {branch.if_false, (int)(2 * k + 1)}, {branch.if_true, (int)(2 * k + 2)}};
+    if (fall == branch.if_true) {
+      std::swap(targets[0], targets[1]);
+    }
+    for (auto& [target, counter] : targets) {
+      // both edges go the same way
+      if (branch.if_true == branch.if_false && counter == 2 * (int)k + 1) {
+        continue;
+      }
+      TackyBlock edge{TackyCFG::unique_label("prof"), {
+        make_tacky<TackyCount>(counter),
+        make_tacky<TackyJump>(make_tacky<TackyLabel>(target))}};
+      retarget(block, target, edge.label);
+      edges[branches[k]].emplace_back(std::move(edge));
+    }
+  }
+
+  std::vector<TackyBlock> layout;
+  for (size_t b = 0; b < cfg.blocks.size(); ++b) {
+    layout.emplace_back(std::move(cfg.blocks[b]));
+    std::move(edges[b].begin(), edges[b].end(), std::back_inserter(layout));
+  }
+  auto& entry = layout[0].instructions;
+  entry.insert(entry.begin(), make_tacky<TackyCount>(0));
+  cfg.blocks = std::move(layout);
+  cfg.analyze();
+}
+
+int64_t Profile::entry_count(const std::string& name) const {
+  auto it = entries_.find(name);
+  return (it == entries_.end()) ? -1 : it->second;
+}
+
+bool Profile::generating() const {
+  return !options_.profile_generate.empty();
+}
+
+const std::vector<Profile::Counters>& Profile::counters() const {
+  return counters_;
+}
+
+const std::string& Profile::output() const {
+  return options_.profile_generate;
+}
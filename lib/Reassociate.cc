@@ -0,0 +1,204 @@
+#include "Reassociate.h"
+#include "Util.h"
+#include <algorithm>
+#include <cstdint>
+
+using namespace ccomp;
+
+static bool associative(const Tacky& inst, TokenType& op) {
+  auto bin = std::get_if<TackyBinary>(&inst);
+  if (bin == nullptr ||
+      !one_of(bin->op.type, {TokenType::PLUS, TokenType::STAR})) {
+    return false;
+  }
+  op = bin->op.type;
+  return true;
+}
+
+Reassociate::Reassociate(TackyCFG& cfg, const Options& options) :
+  cfg_(cfg), options_(options)
+{}
+
+bool Reassociate::run() {
+  if (!options_.reassociate) {
+    return false;
+  }
+  // Unrolled copies of a block reuse its temporaries, so a variable is
+  // local if every block touching it defines it once and reads it once
+  // after that.
+  std::unordered_map<std::string, bool> local;
+  for (auto& block : cfg_.blocks) {
+    std::unordered_map<std::string, std::pair<int, int>> counts;
+    for (auto& inst : block.instructions) {
+      for (auto& src : tacky_srcs(*inst)) {
+        if (auto name = var_name(src)) {
+          auto& [defs, uses] = counts[*name];
+          local[*name] = local.try_emplace(*name, true).first->second &&
+            defs == 1;
+          ++uses;
+        }
+      }
+      if (auto dest = var_name(tacky_dest(*inst))) {
+        ++counts[*dest].first;
+      }
+    }
+    for (auto& [name, count] : counts) {
+      auto& [defs, uses] = count;
+      local[name] = local.try_emplace(name, true).first->second &&
+        defs == 1 && uses == 1;
+    }
+  }
+  local_.clear();
+  for (auto& [name, is_local] : local) {
+    if (is_local) {
+      local_.insert(name);
+    }
+  }
+
+  bool changed = false;
+  for (auto& block : cfg_.blocks) {
+    changed = run(block) || changed;
+  }
+  return changed;
+}
+
+bool Reassociate::run(TackyBlock& block) {
+  auto& insts = block.instructions;
+  // single-use temporaries defined by a + or * in this block
+  std::unordered_map<std::string, int> def_at;
+  std::vector<bool> inner(insts.size(), false);
+  for (size_t i = 0; i < insts.size(); ++i) {
+    TokenType op;
+    if (!associative(*insts[i], op)) {
+      continue;
+    }
+    for (auto& src : tacky_srcs(*insts[i])) {
+      auto name = var_name(src);
+      TokenType src_op;
+      if (name && def_at.count(*name) &&
+          associative(*insts[def_at[*name]], src_op) && src_op == op) {
+        inner[def_at[*name]] = true;
+      }
+    }
+    auto dest = var_name(tacky_dest(*insts[i]));
+    if (local_.count(*dest)) {
+      def_at[*dest] = i;
+    }
+  }
+
+  std::unordered_map<int, std::vector<std::shared_ptr<Tacky>>> rewrites;
+  std::vector<bool> removed(insts.size(), false);
+  for (size_t i = 0; i < insts.size(); ++i) {
+    TokenType op;
+    if (inner[i] || !associative(*insts[i], op)) {
+      continue;
+    }
+    Chain chain{op, {}, {}, {}, {}};
+    collect(block, i, def_at, chain);
+    if (chain.ops.size() < 2 && chain.constants.size() < 2) {
+      continue;
+    }
+    std::sort(chain.ops.begin(), chain.ops.end());
+    // every operand is read again where the root is, so none may change
+    // after the operation that read it
+    bool stable = true;
+    for (int k = chain.ops.front(); k < (int)i && stable; ++k) {
+      auto dest = var_name(tacky_dest(*insts[k]));
+      for (size_t v = 0; dest && v < chain.vars.size(); ++v) {
+        auto name = var_name(chain.vars[v]);
+        stable = stable && !(*name == *dest && chain.readers[v] < k);
+      }
+    }
+    if (!stable) {
+      continue;
+    }
+
+    // fold the constants, and drop them if they are the identity
+    int64_t folded = (op == TokenType::PLUS) ? 0 : 1;
+    for (int value : chain.constants) {
+      folded = (op == TokenType::PLUS) ? wrap(folded + value) :
+        wrap(folded * value);
+    }
+    bool identity = folded == ((op == TokenType::PLUS) ? 0 : 1);
+    auto dest = tacky_dest(*insts[i]);
+    auto& out = rewrites[i];
+    // x * 0 is 0 whatever x is
+    if (op == TokenType::STAR && folded == 0) {
+      chain.vars.clear();
+    }
+    if (chain.vars.empty()) {
+      out.emplace_back(
+        make_tacky<TackyCopy>(make_tacky<TackyConstant>(folded), dest));
+    } else {
+      // a canonical order, so equal chains come out the same
+      std::stable_sort(chain.vars.begin(), chain.vars.end(),
+        [](auto& a, auto& b) { return *var_name(a) < *var_name(b); });
+      auto value = balance(op, chain.vars, 0, chain.vars.size(),
+                           identity ? dest : nullptr, out);
+      if (!identity) {
+        out.emplace_back(make_tacky<TackyBinary>(
+          make_op(op), value, make_tacky<TackyConstant>(folded), dest));
+      } else if (value != dest) {
+        out.emplace_back(make_tacky<TackyCopy>(value, dest));
+      }
+    }
+    for (int k : chain.ops) {
+      removed[k] = true;
+    }
+  }
+  if (rewrites.empty()) {
+    return false;
+  }
+
+  std::vector<std::shared_ptr<Tacky>> result;
+  for (size_t i = 0; i < insts.size(); ++i) {
+    auto it = rewrites.find(i);
+    if (it != rewrites.end()) {
+      result.insert(result.end(), it->second.begin(), it->second.end());
+    } else if (!removed[i]) {
+      result.emplace_back(insts[i]);
+    }
+  }
+  insts = std::move(result);
+  return true;
+}
+
+void Reassociate::collect(const TackyBlock& block, int index,
+                          const std::unordered_map<std::string, int>& def_at,
+                          Chain& chain) const {
+  chain.ops.push_back(index);
+  auto& bin = std::get<TackyBinary>(*block.instructions[index]);
+  for (auto& src : {bin.src1, bin.src2}) {
+    if (auto constant = std::get_if<TackyConstant>(src.get())) {
+      chain.constants.push_back(constant->value);
+      continue;
+    }
+    auto name = var_name(src);
+    auto it = name ? def_at.find(*name) : def_at.end();
+    TokenType op;
+    if (it != def_at.end() && it->second < index &&
+        associative(*block.instructions[it->second], op) && op == chain.op) {
+      collect(block, it->second, def_at, chain);
+    } else {
+      chain.vars.emplace_back(src);
+      chain.readers.push_back(index);
+    }
+  }
+}
+
+std::shared_ptr<Tacky> Reassociate::balance(
+    TokenType op, const std::vector<std::shared_ptr<Tacky>>& vars,
+    size_t lo, size_t hi, std::shared_ptr<Tacky> dest,
+    std::vector<std::shared_ptr<Tacky>>& out) const {
+  if (hi - lo == 1) {
+    return vars[lo];
+  }
+  size_t mid = lo + (hi - lo) / 2;
+  auto left = balance(op, vars, lo, mid, nullptr, out);
+  auto right = balance(op, vars, mid, hi, nullptr, out);
+  if (dest == nullptr) {
+    dest = make_tacky<TackyVar>(TackyCFG::unique_var());
+  }
+  out.emplace_back(make_tacky<TackyBinary>(make_op(op), left, right, dest));
+  return dest;
+}
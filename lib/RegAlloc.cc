@@ -0,0 +1,549 @@
+#include "RegAlloc.h"
+#include "AsmCFG.h"
+#include "Util.h"
+#include <algorithm>
+#include <bit>
+#include <cstdint>
+#include <format>
+#include <queue>
+#include <tuple>
+
+using namespace ccomp;
+
+// registers the allocator hands out, and the order it prefers them in;
+// AX and DX come last since division and return values claim them
+static const std::vector<AsmReg> kRegisters = {
+  AsmReg::AX, AsmReg::CX, AsmReg::DX, AsmReg::SI, AsmReg::DI, AsmReg::R8,
+  AsmReg::R9};
+static const std::vector<AsmReg> kColorOrder = {
+  AsmReg::CX, AsmReg::SI, AsmReg::DI, AsmReg::R8, AsmReg::R9, AsmReg::DX,
+  AsmReg::AX};
+
+static int reg_node(AsmReg reg) {
+  auto it = std::find(kRegisters.begin(), kRegisters.end(), reg);
+  return (it == kRegisters.end()) ? -1 : it - kRegisters.begin();
+}
+
+// a set of nodes, one bit each
+using NodeSet = std::vector<uint64_t>;
+
+static void set_bit(NodeSet& set, int n) {
+  set[n / 64] |= uint64_t(1) << (n % 64);
+}
+
+static bool test_bit(const NodeSet& set, int n) {
+  return (set[n / 64] >> (n % 64)) & 1;
+}
+
+// The nodes live at one point of a walk through a block: insert and erase
+// take constant time, and iterating visits the members only.
+namespace {
+struct LiveSet {
+  std::vector<int> members;
+  // where each node is in members, if it is there at all
+  std::vector<size_t> index;
+
+  explicit LiveSet(size_t num_nodes) : index(num_nodes, 0) {}
+  bool contains(int n) const {
+    return index[n] < members.size() && members[index[n]] == n;
+  }
+  void insert(int n) {
+    if (!contains(n)) {
+      index[n] = members.size();
+      members.push_back(n);
+    }
+  }
+  void erase(int n) {
+    if (contains(n)) {
+      int last = members.back();
+      members[index[n]] = last;
+      index[last] = index[n];
+      members.pop_back();
+    }
+  }
+  void clear() { members.clear(); }
+};
+}
+
+RegAlloc::RegAlloc(int num_regs) :
+  num_regs_(std::clamp(num_regs, 0, (int)kRegisters.size()))
+{}
+
+int RegAlloc::find(int node) const {
+  while (alias_[node] != node) {
+    node = alias_[node];
+  }
+  return node;
+}
+
+int RegAlloc::node(const std::shared_ptr<Asm>& operand) const {
+  if (auto pseudo = std::get_if<AsmPseudo>(operand.get())) {
+    return find(pseudo_node_.at(pseudo->identifier));
+  } else if (auto reg = std::get_if<AsmRegister>(operand.get())) {
+    int n = reg_node(reg->reg);
+    return (n < 0) ? -1 : find(n);
+  }
+  return -1;
+}
+
+bool RegAlloc::precolored(int node) const {
+  return node < (int)kRegisters.size();
+}
+
+bool RegAlloc::allowed(int node) const {
+  auto end = kColorOrder.begin() + num_regs_;
+  return std::find(kColorOrder.begin(), end, kRegisters[node]) != end;
+}
+
+RegAlloc::Access RegAlloc::access(const Asm& inst) const {
+  Access acc;
+  auto use = [&acc, this](const std::shared_ptr<Asm>& operand) {
+    if (int n = node(operand); n >= 0) {
+      acc.uses.push_back(n);
+    }
+  };
+  auto def = [&acc, this](const std::shared_ptr<Asm>& operand) {
+    if (int n = node(operand); n >= 0) {
+      acc.defs.push_back(n);
+    }
+  };
+  auto ax = make_asm<AsmRegister>(AsmReg::AX);
+  auto dx = make_asm<AsmRegister>(AsmReg::DX);
+
+  if (auto mov = std::get_if<AsmMov>(&inst)) {
+    use(mov->src);
+    def(mov->dest);
+    acc.move_src = node(mov->src);
+    acc.move_dst = node(mov->dest);
+  } else if (auto unary = std::get_if<AsmUnary>(&inst)) {
+    use(unary->operand);
+    def(unary->operand);
+  } else if (auto bin = std::get_if<AsmBinary>(&inst)) {
+    use(bin->operand1);
+    use(bin->operand2);
+    def(bin->operand2);
+  } else if (auto cmp = std::get_if<AsmCmp>(&inst)) {
+    use(cmp->operand1);
+    use(cmp->operand2);
+  } else if (auto test = std::get_if<AsmTest>(&inst)) {
+    use(test->operand1);
+    use(test->operand2);
+  } else if (auto lea = std::get_if<AsmLea>(&inst)) {
+    use(lea->base);
+    use(lea->index);
+    def(lea->dest);
+  } else if (auto imul = std::get_if<AsmImulImm>(&inst)) {
+    use(imul->src);
+    def(imul->dest);
+  } else if (auto shift = std::get_if<AsmShift>(&inst)) {
+    use(shift->operand);
+    def(shift->operand);
+  } else if (auto imul = std::get_if<AsmImulHi>(&inst)) {
+    // edx:eax = eax * operand
+    use(imul->operand);
+    use(ax);
+    def(ax);
+    def(dx);
+  } else if (auto idiv = std::get_if<AsmIdiv>(&inst)) {
+    // edx:eax / operand, quotient in eax and remainder in edx
+    use(idiv->operand);
+    use(ax);
+    use(dx);
+    def(ax);
+    def(dx);
+  } else if (std::holds_alternative<AsmCdq>(inst)) {
+    use(ax);
+    def(dx);
+  } else if (auto setcc = std::get_if<AsmSetCC>(&inst)) {
+    // only writes the low byte
+    use(setcc->operand);
+    def(setcc->operand);
+  } else if (auto cmov = std::get_if<AsmCMovCC>(&inst)) {
+    use(cmov->src);
+    use(cmov->dest);
+    def(cmov->dest);
+  } else if (auto table = std::get_if<AsmJumpTable>(&inst)) {
+    use(table->index);
+  } else if (std::holds_alternative<AsmReturn>(inst)) {
+    use(ax);
+  }
+  return acc;
+}
+
+void RegAlloc::build() {
+  size_t num_nodes = node_name_.size();
+  size_t words = (num_nodes + 63) / 64;
+  AsmCFG cfg(instructions_);
+  auto& blocks = cfg.blocks;
+  std::vector<Access> accesses;
+  accesses.reserve(instructions_.size());
+  for (auto& inst : instructions_) {
+    accesses.push_back(access(*inst));
+  }
+
+  // the nodes each block reads before writing them, and the ones it writes
+  partners_.assign(num_nodes, {});
+  moves_.clear();
+  std::vector<NodeSet> gen(blocks.size(), NodeSet(words));
+  std::vector<NodeSet> kill = gen;
+  for (size_t b = 0; b < blocks.size(); ++b) {
+    for (size_t i = blocks[b].body; i < blocks[b].end; ++i) {
+      auto& acc = accesses[i];
+      for (int u : acc.uses) {
+        if (!test_bit(kill[b], u)) {
+          set_bit(gen[b], u);
+        }
+      }
+      for (int d : acc.defs) {
+        set_bit(kill[b], d);
+      }
+      if (acc.move_src >= 0 && acc.move_dst >= 0 &&
+          acc.move_src != acc.move_dst) {
+        partners_[acc.move_src].push_back(acc.move_dst);
+        partners_[acc.move_dst].push_back(acc.move_src);
+        moves_.push_back({acc.move_src, acc.move_dst});
+      }
+    }
+  }
+
+  // live nodes on entry to and exit from each block, to a fixed point;
+  // blocks are visited last to first, so straight-line code takes one pass
+  std::vector<NodeSet> live_in = gen;
+  std::vector<NodeSet> live_out(blocks.size(), NodeSet(words));
+  bool changed = true;
+  while (changed) {
+    changed = false;
+    for (int b = blocks.size() - 1; b >= 0; --b) {
+      auto& out = live_out[b];
+      for (int succ : blocks[b].succs) {
+        for (size_t w = 0; w < words; ++w) {
+          out[w] |= live_in[succ][w];
+        }
+      }
+      for (size_t w = 0; w < words; ++w) {
+        uint64_t in = gen[b][w] | (out[w] & ~kill[b][w]);
+        if (in != live_in[b][w]) {
+          live_in[b][w] = in;
+          changed = true;
+        }
+      }
+    }
+  }
+
+  // walking each block backwards from its live out, a definition
+  // interferes with everything live after it, except the source of a
+  // move, which holds the same value
+  adj_.assign(num_nodes, {});
+  LiveSet live(num_nodes);
+  for (size_t b = 0; b < blocks.size(); ++b) {
+    live.clear();
+    for (size_t w = 0; w < words; ++w) {
+      for (uint64_t bits = live_out[b][w]; bits != 0; bits &= bits - 1) {
+        live.insert(w * 64 + std::countr_zero(bits));
+      }
+    }
+    for (size_t i = blocks[b].end; i-- > blocks[b].body;) {
+      auto& acc = accesses[i];
+      for (int d : acc.defs) {
+        for (int n : live.members) {
+          if (n == d || n == acc.move_src || (precolored(d) && precolored(n))) {
+            continue;
+          }
+          adj_[d].insert(n);
+          adj_[n].insert(d);
+        }
+      }
+      for (int d : acc.defs) {
+        live.erase(d);
+      }
+      for (int u : acc.uses) {
+        live.insert(u);
+      }
+    }
+  }
+
+  // spill costs, weighting accesses inside loops by 10 per nesting level
+  std::vector<int> depth(blocks.size(), 0);
+  for (size_t b = 0; b < blocks.size(); ++b) {
+    for (int succ : blocks[b].succs) {
+      for (size_t j = succ; succ <= (int)b && j <= b; ++j) {
+        ++depth[j];
+      }
+    }
+  }
+  cost_.assign(num_nodes, 0);
+  for (size_t b = 0; b < blocks.size(); ++b) {
+    double weight = 1;
+    for (int d = 0; d < std::min(depth[b], 3); ++d) {
+      weight *= 10;
+    }
+    for (size_t i = blocks[b].body; i < blocks[b].end; ++i) {
+      for (int n : accesses[i].uses) {
+        cost_[n] += weight;
+      }
+      for (int n : accesses[i].defs) {
+        cost_[n] += weight;
+      }
+    }
+  }
+}
+
+void RegAlloc::merge(int into, int from) {
+  alias_[from] = into;
+  for (int t : adj_[from]) {
+    adj_[t].erase(from);
+    adj_[t].insert(into);
+    adj_[into].insert(t);
+  }
+  adj_[from].clear();
+  cost_[into] += cost_[from];
+  partners_[into].insert(partners_[into].end(), partners_[from].begin(),
+                         partners_[from].end());
+}
+
+bool RegAlloc::coalesce() {
+  int k = num_regs_;
+  auto significant = [this, k](int n) {
+    return precolored(n) || (int)adj_[n].size() >= k;
+  };
+
+  bool changed = false;
+  for (auto [src, dst] : moves_) {
+    int a = find(src), b = find(dst);
+    if (a == b || adj_[a].contains(b) || (precolored(a) && precolored(b))) {
+      continue;
+    }
+    if (precolored(b)) {
+      std::swap(a, b);
+    }
+
+    if (precolored(a)) {
+      // George: every neighbour of b already conflicts with a, or is easy
+      // to colour
+      if (!allowed(a)) {
+        continue;
+      }
+      bool ok = std::all_of(adj_[b].begin(), adj_[b].end(), [&](int t) {
+        return !significant(t) || adj_[t].contains(a);
+      });
+      if (!ok) {
+        continue;
+      }
+    } else {
+      // Briggs: the merged node has fewer than k significant neighbours
+      int count = 0;
+      for (auto it = adj_[a].begin(); it != adj_[a].end() && count < k; ++it) {
+        count += significant(*it);
+      }
+      for (auto it = adj_[b].begin(); it != adj_[b].end() && count < k; ++it) {
+        count += significant(*it) && !adj_[a].contains(*it);
+      }
+      if (count >= k) {
+        continue;
+      }
+      // moving the smaller node's edges is cheaper
+      if (adj_[a].size() < adj_[b].size()) {
+        std::swap(a, b);
+      }
+    }
+    merge(a, b);
+    changed = true;
+  }
+  return changed;
+}
+
+void RegAlloc::color() {
+  size_t num_nodes = node_name_.size();
+  int k = num_regs_;
+  color_.assign(num_nodes, -1);
+  for (size_t n = 0; n < kRegisters.size(); ++n) {
+    color_[n] = n;
+  }
+  if (k == 0) {
+    return;
+  }
+
+  // simplify: remove nodes of degree < k first, then the cheapest spill
+  // candidate, optimistically hoping it still gets a colour
+  std::vector<int> degree(num_nodes);
+  std::vector<bool> removed(num_nodes, false);
+  auto metric = [&](int n) { return cost_[n] / (degree[n] + 1); };
+  std::vector<int> low;
+  // spill candidates by metric, then node, with the degree they were
+  // queued at; removing a neighbour only raises the metric, so an entry
+  // whose degree is out of date is queued again when it comes up
+  using Candidate = std::tuple<double, int, int>;
+  std::priority_queue<Candidate, std::vector<Candidate>, std::greater<>>
+    spills;
+  size_t remaining = 0;
+  for (size_t n = kRegisters.size(); n < num_nodes; ++n) {
+    if (find(n) != (int)n) {
+      continue;
+    }
+    degree[n] = adj_[n].size();
+    ++remaining;
+    if (degree[n] < k) {
+      low.push_back(n);
+    } else {
+      spills.push({metric(n), n, degree[n]});
+    }
+  }
+  std::vector<int> stack;
+  while (stack.size() < remaining) {
+    int n;
+    if (!low.empty()) {
+      n = low.back();
+      low.pop_back();
+    } else {
+      auto [m, candidate, queued] = spills.top();
+      spills.pop();
+      if (removed[candidate]) {
+        continue;
+      } else if (queued != degree[candidate]) {
+        spills.push({metric(candidate), candidate, degree[candidate]});
+        continue;
+      }
+      n = candidate;
+    }
+    removed[n] = true;
+    stack.push_back(n);
+    for (int t : adj_[n]) {
+      if (!precolored(t) && !removed[t] && --degree[t] == k - 1) {
+        low.push_back(t);
+      }
+    }
+  }
+
+  // select: the first free register, preferring one a move partner has
+  while (!stack.empty()) {
+    int n = stack.back();
+    stack.pop_back();
+    std::vector<bool> taken(kRegisters.size(), false);
+    for (int t : adj_[n]) {
+      if (color_[t] >= 0) {
+        taken[color_[t]] = true;
+      }
+    }
+    auto free = [&](int c) { return !taken[c] && allowed(c); };
+    for (int p : partners_[n]) {
+      int c = color_[find(p)];
+      if (c >= 0 && free(c)) {
+        color_[n] = c;
+        break;
+      }
+    }
+    for (int i = 0; i < num_regs_ && color_[n] < 0; ++i) {
+      int c = reg_node(kColorOrder[i]);
+      if (free(c)) {
+        color_[n] = c;
+      }
+    }
+  }
+}
+
+void RegAlloc::color_slots() {
+  // the most used values get the first slots, next to %rbp
+  std::vector<int> spilled;
+  stats_ = Stats{};
+  for (size_t n = kRegisters.size(); n < node_name_.size(); ++n) {
+    ++stats_.pseudos;
+    if (color_[find(n)] >= 0) {
+      ++stats_.registers;
+    } else if (find(n) == (int)n) {
+      spilled.push_back(n);
+    }
+  }
+  std::stable_sort(spilled.begin(), spilled.end(), [this](int a, int b) {
+    return cost_[a] > cost_[b];
+  });
+
+  // unlike registers there are always more slots, so a greedy pass colours
+  // every node
+  slot_.assign(node_name_.size(), -1);
+  for (int n : spilled) {
+    std::vector<bool> taken(stats_.slots, false);
+    for (int t : adj_[n]) {
+      if (slot_[t] >= 0) {
+        taken[slot_[t]] = true;
+      }
+    }
+    int slot = std::find(taken.begin(), taken.end(), false) - taken.begin();
+    slot_[n] = slot;
+    stats_.slots = std::max(stats_.slots, slot + 1);
+  }
+  stats_.spilled = stats_.pseudos - stats_.registers;
+}
+
+std::shared_ptr<Asm> RegAlloc::rewrite(const std::shared_ptr<Asm>& operand) const {
+  int n = node(operand);
+  if (n < 0 || !std::holds_alternative<AsmPseudo>(*operand)) {
+    return operand;
+  }
+  if (color_[n] < 0) {
+    return make_asm<AsmPseudo>(std::format("slot.{}", slot_[n]));
+  }
+  return make_asm<AsmRegister>(kRegisters[color_[n]]);
+}
+
+std::vector<std::shared_ptr<Asm>> RegAlloc::allocate(
+    const std::vector<std::shared_ptr<Asm>>& instructions) {
+  instructions_ = instructions;
+  node_name_.clear();
+  pseudo_node_.clear();
+  for (auto reg : kRegisters) {
+    node_name_.emplace_back(std::string("%") + std::to_string((int)reg));
+  }
+  for (auto& inst : instructions_) {
+    map_operands(inst, [this](const std::shared_ptr<Asm>& operand) {
+      auto pseudo = std::get_if<AsmPseudo>(operand.get());
+      if (pseudo && !pseudo_node_.contains(pseudo->identifier)) {
+        pseudo_node_[pseudo->identifier] = node_name_.size();
+        node_name_.push_back(pseudo->identifier);
+      }
+      return operand;
+    });
+  }
+  alias_.resize(node_name_.size());
+  for (size_t n = 0; n < alias_.size(); ++n) {
+    alias_[n] = n;
+  }
+
+  build();
+  // with no registers to hand out there is nothing to coalesce or colour,
+  // and the graph only serves to share stack slots
+  if (num_regs_ > 0) {
+    // merging two nodes gives the union of their edges, costs and
+    // partners, so the graph stays conservative without a rebuild; a merge
+    // can make other moves safe to coalesce, so go round again, at most
+    // max_rounds times
+    const int max_rounds = 8;
+    for (int round = 0; round < max_rounds; ++round) {
+      if (!coalesce()) {
+        break;
+      }
+    }
+  }
+  color();
+  color_slots();
+
+  std::vector<std::shared_ptr<Asm>> result;
+  for (auto& inst : instructions_) {
+    auto fixed = map_operands(inst, [this](const std::shared_ptr<Asm>& operand) {
+      return rewrite(operand);
+    });
+    // moves between coalesced nodes disappear
+    if (auto mov = std::get_if<AsmMov>(fixed.get())) {
+      auto src = std::get_if<AsmRegister>(mov->src.get());
+      auto dest = std::get_if<AsmRegister>(mov->dest.get());
+      auto src_pseudo = std::get_if<AsmPseudo>(mov->src.get());
+      auto dest_pseudo = std::get_if<AsmPseudo>(mov->dest.get());
+      if ((src && dest && src->reg == dest->reg) ||
+          (src_pseudo && dest_pseudo &&
+           src_pseudo->identifier == dest_pseudo->identifier)) {
+        continue;
+      }
+    }
+    result.push_back(fixed);
+  }
+  return result;
+}
@@ -1,5 +1,7 @@
 #include "Resolver.h"
+#include <algorithm>
 #include <cassert>
+#include <climits>
 
 using namespace ccomp;
 
@@ -69,12 +71,26 @@ void Resolver::define(const Token &name) {
 }
 
 void Resolver::beginLoop(int* label) {
-  nested_loop_labels_.push_back(loop_label_++);
+  nested_loop_labels_.push_back(loop_label_);
+  nested_break_labels_.push_back(loop_label_++);
   copyLoopLabel(label);
 }
 
 void Resolver::endLoop() {
   nested_loop_labels_.pop_back();
+  nested_break_labels_.pop_back();
+}
+
+void Resolver::beginSwitch(Switch* stmt) {
+  // switches share the loop label numbering, so break works the same way
+  stmt->loop_label = loop_label_;
+  nested_break_labels_.push_back(loop_label_++);
+  nested_switches_.push_back(stmt);
+}
+
+void Resolver::endSwitch() {
+  nested_break_labels_.pop_back();
+  nested_switches_.pop_back();
 }
 
 void Resolver::copyLoopLabel(int* label) {
@@ -211,8 +227,8 @@ void Resolver::operator()(const Null&)
 {}
 
 void Resolver::operator()(Break& flow) {
-  if (!nested_loop_labels_.empty()) {
-    copyLoopLabel(&flow.loop_label);
+  if (!nested_break_labels_.empty()) {
+    flow.loop_label = nested_break_labels_.back();
   } else {
     errorHandler_.add(flow.loc.line, " at 'break'",
                       "break must be inside a loop or switch.");
@@ -224,7 +240,115 @@ void Resolver::operator()(Continue& flow) {
     copyLoopLabel(&flow.loop_label);
   } else {
     errorHandler_.add(flow.loc.line, " at 'continue'",
-                      "break must be inside a loop or switch.");
+                      "continue must be inside a loop.");
+  }
+}
+
+void Resolver::operator()(Switch& stmt) {
+  resolve(stmt.condition.get());
+  beginSwitch(&stmt);
+  resolve(stmt.body.get());
+  endSwitch();
+}
+
+void Resolver::operator()(Case& stmt) {
+  long long value = 0;
+  if (nested_switches_.empty()) {
+    errorHandler_.add(stmt.loc.line, " at 'case'",
+                      "case must be inside a switch.");
+  } else if (!evaluate(stmt.value.get(), value) ||
+             value < INT_MIN || value > INT_MAX) {
+    errorHandler_.add(stmt.loc.line, " at 'case'",
+                      "case value must be an integer constant.");
+  } else {
+    // cases are numbered in source order, and TackyGen labels them that way
+    auto sw = nested_switches_.back();
+    if (std::find(sw->cases.begin(), sw->cases.end(), value) !=
+        sw->cases.end()) {
+      errorHandler_.add(stmt.loc.line, " at 'case'",
+                        "Duplicate case value in switch.");
+    }
+    stmt.loop_label = sw->loop_label;
+    stmt.index = sw->cases.size();
+    sw->cases.push_back(value);
+  }
+  resolve(stmt.body.get());
+}
+
+void Resolver::operator()(Default& stmt) {
+  if (nested_switches_.empty()) {
+    errorHandler_.add(stmt.loc.line, " at 'default'",
+                      "default must be inside a switch.");
+  } else if (nested_switches_.back()->has_default) {
+    errorHandler_.add(stmt.loc.line, " at 'default'",
+                      "Multiple default labels in one switch.");
+  } else {
+    nested_switches_.back()->has_default = true;
+    stmt.loop_label = nested_switches_.back()->loop_label;
+  }
+  resolve(stmt.body.get());
+}
+
+bool Resolver::evaluate(const Expr* expr, long long& value) {
+  if (auto literal = std::get_if<LiteralExpr>(expr)) {
+    if (literal->type != TokenType::NUMBER) {
+      return false;
+    }
+    value = std::stoll(literal->value);
+    return true;
+  }
+
+  if (auto unary = std::get_if<UnaryExpr>(expr)) {
+    if (!evaluate(unary->right.get(), value)) {
+      return false;
+    }
+    switch (unary->Operator.type) {
+      case TokenType::MINUS:
+        value = -value;
+        return true;
+      case TokenType::TILDE:
+        value = ~value;
+        return true;
+      case TokenType::BANG:
+        value = !value;
+        return true;
+      default:
+        return false;
+    }
+  }
+
+  auto bin = std::get_if<BinaryExpr>(expr);
+  long long rhs = 0;
+  if (bin == nullptr || !evaluate(bin->left.get(), value) ||
+      !evaluate(bin->right.get(), rhs)) {
+    return false;
+  }
+  // values stay well inside long long as long as each step fits an int
+  if (value < INT_MIN || value > INT_MAX || rhs < INT_MIN || rhs > INT_MAX) {
+    return false;
+  }
+  switch (bin->Operator.type) {
+    case TokenType::PLUS: value = value + rhs; return true;
+    case TokenType::MINUS: value = value - rhs; return true;
+    case TokenType::STAR: value = value * rhs; return true;
+    case TokenType::SLASH:
+      if (rhs == 0) return false;
+      value = value / rhs;
+      return true;
+    case TokenType::PERCENT:
+      if (rhs == 0) return false;
+      value = value % rhs;
+      return true;
+    case TokenType::LESS: value = value < rhs; return true;
+    case TokenType::LESS_EQUAL: value = value <= rhs; return true;
+    case TokenType::GREATER: value = value > rhs; return true;
+    case TokenType::GREATER_EQUAL: value = value >= rhs; return true;
+    case TokenType::EQUAL_EQUAL: value = value == rhs; return true;
+    case TokenType::BANG_EQUAL: value = value != rhs; return true;
+    case TokenType::AMPERSAND_AMPERSAND: value = value && rhs; return true;
+    case TokenType::PIPE_PIPE: value = value || rhs; return true;
+    default:
+      return false;
   }
 }
 
@@ -258,6 +382,16 @@ void Resolver::operator()(const UnaryExpr& unary) {
   resolve(unary.right.get());
 }
 
+void Resolver::operator()(Expect& expect) {
+  resolve(expect.value.get());
+  long long value = 0;
+  if (!evaluate(expect.expected.get(), value)) {
+    errorHandler_.add(expect.keyword.line, " at '__builtin_expect'",
+                      "expected value must be an integer constant.");
+  }
+  expect.expect_true = (value != 0);
+}
+
 void Resolver::operator()(Variable& var) {
 #if 0
   if (!scopes_.empty()) {
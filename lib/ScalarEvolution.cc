@@ -0,0 +1,614 @@
+#include "ScalarEvolution.h"
+#include "LoopAnalysis.h"
+#include "Util.h"
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <optional>
+#include <unordered_map>
+
+using namespace ccomp;
+
+namespace {
+// A loop invariant value: an expression over constants and the values the
+// variables hold on entry to the loop, folded with 32-bit wraparound.
+struct Coef;
+using CoefPtr = std::shared_ptr<const Coef>;
+struct Coef {
+  enum Kind { CONST, VAR, ADD, MUL, NEG } kind;
+  int value;
+  std::string var;
+  CoefPtr lhs, rhs;
+};
+
+CoefPtr coef_const(int value) {
+  return std::make_shared<Coef>(Coef{Coef::CONST, value, "", nullptr, nullptr});
+}
+
+CoefPtr coef_var(const std::string& var) {
+  return std::make_shared<Coef>(Coef{Coef::VAR, 0, var, nullptr, nullptr});
+}
+
+bool is_const(const CoefPtr& c, int value) {
+  return c->kind == Coef::CONST && c->value == value;
+}
+
+CoefPtr coef_neg(const CoefPtr& a) {
+  if (a->kind == Coef::CONST) {
+    return coef_const(wrap(-(int64_t)a->value));
+  } else if (a->kind == Coef::NEG) {
+    return a->lhs;
+  }
+  return std::make_shared<Coef>(Coef{Coef::NEG, 0, "", a, nullptr});
+}
+
+CoefPtr coef_add(const CoefPtr& a, const CoefPtr& b) {
+  if (a->kind == Coef::CONST && b->kind == Coef::CONST) {
+    return coef_const(wrap((int64_t)a->value + b->value));
+  } else if (is_const(a, 0)) {
+    return b;
+  } else if (is_const(b, 0)) {
+    return a;
+  }
+  return std::make_shared<Coef>(Coef{Coef::ADD, 0, "", a, b});
+}
+
+CoefPtr coef_mul(const CoefPtr& a, const CoefPtr& b) {
+  if (a->kind == Coef::CONST && b->kind == Coef::CONST) {
+    return coef_const(wrap((int64_t)a->value * b->value));
+  } else if (is_const(a, 0) || is_const(b, 0)) {
+    return coef_const(0);
+  } else if (is_const(a, 1)) {
+    return b;
+  } else if (is_const(b, 1)) {
+    return a;
+  } else if (is_const(a, -1)) {
+    return coef_neg(b);
+  } else if (is_const(b, -1)) {
+    return coef_neg(a);
+  }
+  return std::make_shared<Coef>(Coef{Coef::MUL, 0, "", a, b});
+}
+
+// {c0, c1, c2}: the value c0 + c1*m + c2*m*(m-1)/2 in iteration m
+using Chrec = std::vector<CoefPtr>;
+
+void trim(Chrec& c) {
+  while (c.size() > 1 && is_const(c.back(), 0)) {
+    c.pop_back();
+  }
+}
+
+Chrec chrec_add(const Chrec& a, const Chrec& b) {
+  Chrec sum;
+  for (size_t i = 0; i < std::max(a.size(), b.size()); ++i) {
+    sum.push_back(coef_add(i < a.size() ? a[i] : coef_const(0),
+                           i < b.size() ? b[i] : coef_const(0)));
+  }
+  trim(sum);
+  return sum;
+}
+
+Chrec chrec_scale(const Chrec& a, const CoefPtr& k) {
+  Chrec product;
+  for (auto& c : a) {
+    product.push_back(coef_mul(c, k));
+  }
+  trim(product);
+  return product;
+}
+
+std::optional<Chrec> chrec_mul(Chrec a, Chrec b) {
+  trim(a);
+  trim(b);
+  if (a.size() == 1) {
+    return chrec_scale(b, a[0]);
+  } else if (b.size() == 1) {
+    return chrec_scale(a, b[0]);
+  } else if (a.size() > 2 || b.size() > 2) {
+    return std::nullopt;
+  }
+  // (a0 + a1 m)(b0 + b1 m) = a0 b0 + (a0 b1 + a1 b0 + a1 b1) m
+  //                        + 2 a1 b1 m(m-1)/2
+  auto a1b1 = coef_mul(a[1], b[1]);
+  Chrec product = {
+    coef_mul(a[0], b[0]),
+    coef_add(coef_add(coef_mul(a[0], b[1]), coef_mul(a[1], b[0])), a1b1),
+    coef_mul(coef_const(2), a1b1)};
+  trim(product);
+  return product;
+}
+
+// The value of a definition in terms of iteration m: rest + self * x, where
+// x is the header value of the variable being solved for.
+struct Linear {
+  Chrec rest;
+  int64_t self;
+};
+
+// Solves the variables of a straight-line loop body for their value in
+// iteration m, as polynomials of degree two or less.
+class Recurrences {
+public:
+  Recurrences(const std::vector<std::shared_ptr<Tacky>>& body) : body_(body) {
+    for (size_t i = 0; i < body_.size(); ++i) {
+      if (auto dest = var_name(tacky_dest(*body_[i]))) {
+        if (!defs_.insert({*dest, i}).second) {
+          valid = false;
+        }
+      }
+    }
+  }
+
+  bool valid = true;
+
+  // value at the loop header in iteration m
+  std::optional<Chrec> header_value(const std::string& var) {
+    if (auto it = header_.find(var); it != header_.end()) {
+      return it->second;
+    }
+    if (failed_.contains(var) || !solving_.insert(var).second) {
+      return std::nullopt;
+    }
+
+    // var = var + e(m)  =>  var(m) = var(0) + sum of e(j) for j < m
+    auto def = eval_def(var, var);
+    solving_.erase(var);
+    if (!def || def->self != 1 || def->rest.size() > 2) {
+      failed_.insert(var);
+      return std::nullopt;
+    }
+    Chrec value = {coef_var(var)};
+    value.insert(value.end(), def->rest.begin(), def->rest.end());
+    trim(value);
+    header_[var] = value;
+    return value;
+  }
+
+  // value computed by the definition of var in iteration m
+  std::optional<Chrec> def_value(const std::string& var) {
+    auto def = eval_def(var, "");
+    if (!def) {
+      return std::nullopt;
+    }
+    return def->rest;
+  }
+
+private:
+  const std::vector<std::shared_ptr<Tacky>>& body_;
+  std::unordered_map<std::string, size_t> defs_;
+  std::unordered_map<std::string, Chrec> header_;
+  std::unordered_set<std::string> solving_, failed_;
+
+  // the value of `val` as read at body_[pos]
+  std::optional<Linear> eval(const std::shared_ptr<Tacky>& val, size_t pos,
+                             const std::string& self) {
+    if (auto constant = std::get_if<TackyConstant>(val.get())) {
+      return Linear{{coef_const(constant->value)}, 0};
+    }
+    auto name = var_name(val);
+    auto it = defs_.find(*name);
+    if (it == defs_.end()) {
+      return Linear{{coef_var(*name)}, 0};
+    } else if (it->second < pos) {
+      return eval_def(*name, self);
+    } else if (*name == self) {
+      return Linear{{coef_const(0)}, 1};
+    }
+    auto header = header_value(*name);
+    if (!header) {
+      return std::nullopt;
+    }
+    return Linear{*header, 0};
+  }
+
+  std::optional<Linear> eval_def(const std::string& var,
+                                 const std::string& self) {
+    size_t pos = defs_.at(var);
+    auto& inst = *body_[pos];
+    if (auto copy = std::get_if<TackyCopy>(&inst)) {
+      return eval(copy->src, pos, self);
+    }
+
+    if (auto unary = std::get_if<TackyUnary>(&inst)) {
+      auto src = eval(unary->src, pos, self);
+      if (!src || unary->op.type == TokenType::BANG) {
+        return std::nullopt;
+      }
+      // ~x = -x - 1
+      Linear neg{chrec_scale(src->rest, coef_const(-1)), -src->self};
+      if (unary->op.type == TokenType::TILDE) {
+        neg.rest = chrec_add(neg.rest, {coef_const(-1)});
+      }
+      return neg;
+    }
+
+    auto bin = std::get_if<TackyBinary>(&inst);
+    if (bin == nullptr) {
+      return std::nullopt;
+    }
+    auto a = eval(bin->src1, pos, self);
+    auto b = eval(bin->src2, pos, self);
+    if (!a || !b) {
+      return std::nullopt;
+    }
+    switch (bin->op.type) {
+      case TokenType::MINUS:
+        b = Linear{chrec_scale(b->rest, coef_const(-1)), -b->self};
+        [[fallthrough]];
+      case TokenType::PLUS:
+        return Linear{chrec_add(a->rest, b->rest), a->self + b->self};
+      case TokenType::STAR: {
+        if (a->self != 0) {
+          std::swap(a, b);
+        }
+        if (a->self != 0) {
+          return std::nullopt;
+        } else if (b->self == 0) {
+          auto product = chrec_mul(a->rest, b->rest);
+          if (!product) {
+            return std::nullopt;
+          }
+          return Linear{*product, 0};
+        }
+        // only constant multiples of the solved variable stay linear in it
+        if (a->rest.size() != 1 || a->rest[0]->kind != Coef::CONST) {
+          return std::nullopt;
+        }
+        int64_t self = b->self * a->rest[0]->value;
+        if (self < -(1 << 20) || self > (1 << 20)) {
+          return std::nullopt;
+        }
+        return Linear{chrec_scale(b->rest, a->rest[0]), self};
+      }
+      default:
+        return std::nullopt;
+    }
+  }
+};
+
+// Emits the instructions computing a loop invariant value.
+std::shared_ptr<Tacky> emit(const CoefPtr& c,
+                            std::vector<std::shared_ptr<Tacky>>& insts) {
+  switch (c->kind) {
+    case Coef::CONST:
+      return make_tacky<TackyConstant>(c->value);
+    case Coef::VAR:
+      return make_tacky<TackyVar>(c->var);
+    default:
+      break;
+  }
+
+  auto dest = make_tacky<TackyVar>(TackyCFG::unique_var());
+  if (c->kind == Coef::NEG) {
+    insts.emplace_back(make_tacky<TackyUnary>(make_op(TokenType::MINUS),
+                                              emit(c->lhs, insts), dest));
+  } else if (c->kind == Coef::ADD && c->rhs->kind == Coef::NEG) {
+    auto lhs = emit(c->lhs, insts);
+    insts.emplace_back(make_tacky<TackyBinary>(make_op(TokenType::MINUS), lhs,
+                                               emit(c->rhs->lhs, insts), dest));
+  } else {
+    auto lhs = emit(c->lhs, insts);
+    auto op = (c->kind == Coef::ADD) ? TokenType::PLUS : TokenType::STAR;
+    insts.emplace_back(make_tacky<TackyBinary>(make_op(op), lhs,
+                                               emit(c->rhs, insts), dest));
+  }
+  return dest;
+}
+
+std::shared_ptr<Tacky> emit_binary(TokenType op, std::shared_ptr<Tacky> a,
+                                   std::shared_ptr<Tacky> b,
+                                   std::vector<std::shared_ptr<Tacky>>& insts) {
+  auto dest = make_tacky<TackyVar>(TackyCFG::unique_var());
+  insts.emplace_back(make_tacky<TackyBinary>(make_op(op), a, b, dest));
+  return dest;
+}
+
+std::shared_ptr<Tacky> jump_to(const std::string& label) {
+  return make_tacky<TackyJump>(make_tacky<TackyLabel>(label));
+}
+
+// Number of iterations that stay in the loop when iv starts at `start` and
+// the test sees start + step, start + 2 step, ... (or start, start + step,
+// ... when the step comes after the test).
+std::optional<int64_t> trip_count(const CountedLoop& counted, TokenType rel,
+                                  int64_t start, int64_t bound) {
+  int64_t step = counted.step;
+  int64_t first = start + (counted.step_before_test ? step : 0);
+  if (!fits_int(first)) {
+    return std::nullopt;
+  } else if (!eval_relational(rel, first, bound)) {
+    return 0;
+  }
+
+  int64_t trips;
+  switch (rel) {
+    case TokenType::LESS: trips = (bound - first + step - 1) / step; break;
+    case TokenType::LESS_EQUAL: trips = (bound - first) / step + 1; break;
+    case TokenType::GREATER: trips = (first - bound - step - 1) / -step; break;
+    case TokenType::GREATER_EQUAL: trips = (first - bound) / -step + 1; break;
+    case TokenType::BANG_EQUAL:
+      if ((bound - first) % step != 0 || (bound - first) / step <= 0) {
+        return std::nullopt;
+      }
+      trips = (bound - first) / step;
+      break;
+    default:
+      trips = 1;
+      break;
+  }
+  // the induction variable must not wrap around on the way
+  if (!fits_int(first + trips * step)) {
+    return std::nullopt;
+  }
+  return trips;
+}
+}
+
+ScalarEvolution::ScalarEvolution(TackyCFG& cfg) : cfg_(cfg)
+{}
+
+bool ScalarEvolution::run() {
+  // replacing a loop can make its parent innermost
+  bool changed = false;
+  bool progress = true;
+  while (progress) {
+    progress = false;
+    for (auto& loop : cfg_.loops) {
+      auto& header = cfg_.blocks[loop.header].label;
+      if (!loop.innermost || done_.contains(header)) {
+        continue;
+      }
+      done_.insert(header);
+      if (replace(loop)) {
+        changed = progress = true;
+        break;
+      }
+    }
+  }
+  return changed;
+}
+
+bool ScalarEvolution::used_outside(const TackyLoop& loop,
+                                   const std::string& var) const {
+  for (size_t i = 0; i < cfg_.blocks.size(); ++i) {
+    if (cfg_.in_loop(loop, i)) {
+      continue;
+    }
+    for (auto& inst : cfg_.blocks[i].instructions) {
+      for (auto& src : tacky_srcs(*inst)) {
+        if (auto name = var_name(src); name && *name == var) {
+          return true;
+        }
+      }
+    }
+  }
+  return false;
+}
+
+bool ScalarEvolution::replace(const TackyLoop& loop) {
+  CountedLoop counted;
+  if (loop.latches.size() != 1 || !find_counted_loop(cfg_, loop, counted)) {
+    return false;
+  }
+
+  // a single chain of blocks leaving only at the exit test
+  std::vector<int> order;
+  for (int block : cfg_.rpo) {
+    if (cfg_.in_loop(loop, block)) {
+      order.push_back(block);
+    }
+  }
+  std::vector<std::shared_ptr<Tacky>> body;
+  size_t test_pos = 0;
+  for (int block : order) {
+    if (!cfg_.dominates(block, loop.latches[0])) {
+      return false;
+    }
+    for (int succ : cfg_.succs[block]) {
+      if (!cfg_.in_loop(loop, succ) && block != counted.exiting) {
+        return false;
+      }
+    }
+    for (auto& inst : cfg_.blocks[block].instructions) {
+      if (is_terminator(*inst)) {
+        continue;
+      }
+      // deleting the loop must not delete a division trap
+      if (auto bin = std::get_if<TackyBinary>(inst.get());
+          bin && one_of(bin->op.type, {TokenType::SLASH, TokenType::PERCENT})) {
+        auto divisor = std::get_if<TackyConstant>(bin->src2.get());
+        if (divisor == nullptr || divisor->value == 0 || divisor->value == -1) {
+          return false;
+        }
+      }
+      // nor the counters of a --profile-generate build
+      if (std::holds_alternative<TackyCount>(*inst)) {
+        return false;
+      }
+      body.push_back(inst);
+    }
+    if (block == counted.exiting) {
+      test_pos = body.size();
+    }
+  }
+
+  // the direction of the step must agree with the exit test
+  TokenType rel = counted.stay_if_true ?
+    counted.rel : negate_relational(counted.rel);
+  bool up = one_of(rel, {TokenType::LESS, TokenType::LESS_EQUAL});
+  bool down = one_of(rel, {TokenType::GREATER, TokenType::GREATER_EQUAL});
+  if ((up && counted.step < 0) || (down && counted.step > 0)) {
+    return false;
+  }
+
+  // closed forms of everything read after the loop
+  Recurrences rec(body);
+  if (!rec.valid) {
+    return false;
+  }
+  std::vector<std::pair<std::string, Chrec>> finals;
+  for (size_t i = 0; i < body.size(); ++i) {
+    auto dest = var_name(tacky_dest(*body[i]));
+    if (!used_outside(loop, *dest)) {
+      continue;
+    }
+    // the last iteration stops at the exit test
+    auto value = (i < test_pos) ?
+      rec.def_value(*dest) : rec.header_value(*dest);
+    if (!value) {
+      return false;
+    }
+    finals.push_back({*dest, *value});
+  }
+
+  // the trip count T, at compile time if possible
+  int start = 0, bound = 0;
+  std::optional<int64_t> trips;
+  auto bound_const = std::get_if<TackyConstant>(counted.bound.get());
+  bool known_bound = bound_const != nullptr;
+  if (bound_const) {
+    bound = bound_const->value;
+  } else {
+    known_bound = entry_value(cfg_, loop, *var_name(counted.bound), &bound);
+  }
+  if (known_bound && entry_value(cfg_, loop, counted.iv, &start)) {
+    trips = trip_count(counted, rel, start, bound);
+    if (!trips) {
+      return false;
+    }
+  } else if (rel == TokenType::EQUAL_EQUAL ||
+             (rel == TokenType::BANG_EQUAL && std::abs(counted.step) != 1)) {
+    return false;
+  }
+
+  auto& header = cfg_.blocks[loop.header].label;
+  auto final_label = TackyCFG::unique_label("scev_final");
+  std::vector<TackyBlock> blocks;
+  CoefPtr t, t_choose_2;
+  if (trips) {
+    // T (T - 1) / 2 without overflowing 64 bits
+    uint64_t n = *trips;
+    uint64_t choose_2 = (n % 2 == 0) ? (n / 2) * (n - 1) : n * ((n - 1) / 2);
+    t = coef_const(wrap(n));
+    t_choose_2 = coef_const(wrap(choose_2));
+  } else {
+    auto var = make_tacky<TackyVar>(TackyCFG::unique_var());
+    auto iv = make_tacky<TackyVar>(counted.iv);
+    auto zero_label = TackyCFG::unique_label("scev_zero");
+    auto count_label = TackyCFG::unique_label("scev_count");
+
+    // no iteration stays in the loop unless the first test passes
+    TackyBlock entry{TackyCFG::unique_label("scev"), {}};
+    auto first = counted.step_before_test ?
+      emit_binary(TokenType::PLUS, iv,
+                  make_tacky<TackyConstant>(counted.step), entry.instructions) :
+      iv;
+    auto stays = emit_binary(rel, first, counted.bound, entry.instructions);
+    entry.instructions.emplace_back(
+      make_tacky<TackyJumpIfZero>(stays, make_tacky<TackyLabel>(zero_label),
+                                  kUnknownProb));
+    entry.instructions.emplace_back(jump_to(count_label));
+
+    // T = (distance - strict) / |step| + 1, or the original loop if the
+    // distance does not fit in an int
+    TackyBlock count{count_label, {}};
+    bool toward_up = up || (rel == TokenType::BANG_EQUAL && counted.step > 0);
+    auto distance = toward_up ?
+      emit_binary(TokenType::MINUS, counted.bound, first, count.instructions) :
+      emit_binary(TokenType::MINUS, first, counted.bound, count.instructions);
+    auto wraps = emit_binary(TokenType::LESS, distance,
+                             make_tacky<TackyConstant>(0), count.instructions);
+    count.instructions.emplace_back(
+      make_tacky<TackyJumpIfNotZero>(wraps, make_tacky<TackyLabel>(header),
+                                     kUnknownProb));
+    if (rel == TokenType::BANG_EQUAL) {
+      count.instructions.emplace_back(make_tacky<TackyCopy>(distance, var));
+    } else {
+      auto span = distance;
+      if (one_of(rel, {TokenType::LESS, TokenType::GREATER})) {
+        span = emit_binary(TokenType::MINUS, span,
+                           make_tacky<TackyConstant>(1), count.instructions);
+      }
+      if (std::abs(counted.step) != 1) {
+        span = emit_binary(TokenType::SLASH, span,
+                           make_tacky<TackyConstant>(std::abs(counted.step)),
+                           count.instructions);
+      }
+      count.instructions.emplace_back(make_tacky<TackyBinary>(
+        make_op(TokenType::PLUS), span, make_tacky<TackyConstant>(1), var));
+    }
+    count.instructions.emplace_back(jump_to(final_label));
+
+    TackyBlock zero{zero_label, {
+      make_tacky<TackyCopy>(make_tacky<TackyConstant>(0), var),
+      jump_to(final_label)}};
+
+    blocks.emplace_back(std::move(entry));
+    blocks.emplace_back(std::move(count));
+    blocks.emplace_back(std::move(zero));
+    t = coef_var(std::get<TackyVar>(*var).identifier);
+  }
+
+  TackyBlock final_block{final_label, {}};
+  auto& insts = final_block.instructions;
+  if (!t_choose_2) {
+    // T (T - 1) / 2 = a (T - 1) + r (T b - a (T - 1)), with a = T / 2,
+    // b = (T - 1) / 2 and r = T % 2, so that nothing overflows for T < 2^31
+    auto tv = make_tacky<TackyVar>(t->var);
+    auto one = make_tacky<TackyConstant>(1);
+    auto two = make_tacky<TackyConstant>(2);
+    auto a = emit_binary(TokenType::SLASH, tv, two, insts);
+    auto t1 = emit_binary(TokenType::MINUS, tv, one, insts);
+    auto b = emit_binary(TokenType::SLASH, t1, two, insts);
+    auto r = emit_binary(TokenType::PERCENT, tv, two, insts);
+    auto even = emit_binary(TokenType::STAR, a, t1, insts);
+    auto odd = emit_binary(TokenType::STAR, tv, b, insts);
+    auto diff = emit_binary(TokenType::MINUS, odd, even, insts);
+    auto fix = emit_binary(TokenType::STAR, r, diff, insts);
+    auto sum = emit_binary(TokenType::PLUS, even, fix, insts);
+    t_choose_2 = coef_var(std::get<TackyVar>(*sum).identifier);
+  }
+
+  // compute every exit value before assigning any of them
+  std::vector<std::pair<std::string, std::shared_ptr<Tacky>>> values;
+  for (auto& [var, value] : finals) {
+    auto c = value[0];
+    if (value.size() > 1) {
+      c = coef_add(c, coef_mul(value[1], t));
+    }
+    if (value.size() > 2) {
+      c = coef_add(c, coef_mul(value[2], t_choose_2));
+    }
+    auto result = emit(c, insts);
+    if (std::holds_alternative<TackyVar>(*result)) {
+      auto tmp = make_tacky<TackyVar>(TackyCFG::unique_var());
+      insts.emplace_back(make_tacky<TackyCopy>(result, tmp));
+      result = tmp;
+    }
+    values.push_back({var, result});
+  }
+  for (auto& [var, value] : values) {
+    insts.emplace_back(make_tacky<TackyCopy>(value, make_tacky<TackyVar>(var)));
+  }
+  insts.emplace_back(jump_to(counted.exit));
+  blocks.emplace_back(std::move(final_block));
+
+  // enter the new blocks instead of the loop
+  for (int pred : cfg_.preds[loop.header]) {
+    if (!cfg_.in_loop(loop, pred)) {
+      retarget(cfg_.blocks[pred], header, blocks.front().label);
+    }
+  }
+  std::vector<TackyBlock> layout;
+  for (size_t i = 0; i < cfg_.blocks.size(); ++i) {
+    if ((int)i == loop.blocks.front()) {
+      std::move(blocks.begin(), blocks.end(), std::back_inserter(layout));
+    }
+    layout.emplace_back(std::move(cfg_.blocks[i]));
+  }
+  cfg_.blocks = std::move(layout);
+  cfg_.analyze();
+  cfg_.remove_unreachable();
+  return true;
+}
@@ -21,6 +21,9 @@ Scanner::Scanner(const std::string &aSource, ErrorHandler &aErrorHandler)
   reservedKeywords["do"] = TokenType::DO;
   reservedKeywords["break"] = TokenType::BREAK;
   reservedKeywords["continue"] = TokenType::CONTINUE;
+  reservedKeywords["switch"] = TokenType::SWITCH;
+  reservedKeywords["case"] = TokenType::CASE;
+  reservedKeywords["default"] = TokenType::DEFAULT;
 }
 
 char Scanner::advanceAndGetChar() {
@@ -0,0 +1,157 @@
+#include "ShrinkWrap.h"
+#include "AsmCFG.h"
+#include "TackyCFG.h"
+#include "Util.h"
+#include <algorithm>
+
+using namespace ccomp;
+
+ShrinkWrap::ShrinkWrap(std::vector<std::shared_ptr<Asm>>& instructions) :
+  instructions_(instructions), cfg_(instructions)
+{}
+
+void ShrinkWrap::run() {
+  auto alloc = std::find_if(instructions_.begin(), instructions_.end(),
+    [](auto& inst) { return std::holds_alternative<AsmAllocateStack>(*inst); });
+  if (alloc == instructions_.end()) {
+    return;
+  }
+  auto& blocks = cfg_.blocks;
+
+  // the nearest common dominator of the blocks using a stack slot
+  int save = -1;
+  for (size_t b = 0; b < blocks.size(); ++b) {
+    if (cfg_.idom[b] != -1 && uses_frame(b)) {
+      save = (save == -1) ? b : cfg_.intersect(save, b);
+    }
+  }
+  // nothing touches the frame, so there is no better place for it
+  if (save == -1) {
+    save = 0;
+  }
+  // a prologue in a loop would run again on every iteration
+  while (save != 0 && reachable(save)[save]) {
+    save = cfg_.idom[save];
+  }
+  // every return reached after the prologue must have come through it
+  auto after = reachable(save);
+  auto returns = [this, &blocks](int b) {
+    size_t end = blocks[b].end;
+    return end > blocks[b].body &&
+      std::holds_alternative<AsmReturn>(*instructions_[end - 1]);
+  };
+  for (size_t b = 0; b < blocks.size(); ++b) {
+    if ((int)b != save && returns(b) && after[b] && !cfg_.dominates(save, b)) {
+      save = 0;
+      break;
+    }
+  }
+
+  if (save != 0) {
+    auto prologue = *alloc;
+    size_t insert_at = blocks[save].body;
+    std::vector<std::shared_ptr<Asm>> insts;
+    for (size_t b = 0; b < blocks.size(); ++b) {
+      // returns on paths without a frame have nothing to release
+      bool release = !returns(b) || cfg_.dominates(save, b);
+      for (size_t i = blocks[b].begin; i < blocks[b].end; ++i) {
+        auto& inst = instructions_[i];
+        if (i == insert_at) {
+          insts.push_back(prologue);
+        }
+        if (inst == prologue ||
+            (!release && std::holds_alternative<AsmDeallocateStack>(*inst))) {
+          continue;
+        }
+        insts.push_back(inst);
+      }
+      // a block of labels only
+      if ((int)b == save && insert_at == blocks[b].end) {
+        insts.push_back(prologue);
+      }
+    }
+    instructions_ = std::move(insts);
+    moved_ = true;
+  }
+  share_epilogue();
+}
+
+bool ShrinkWrap::moved() const {
+  return moved_;
+}
+
+int ShrinkWrap::merged() const {
+  return merged_;
+}
+
+std::vector<bool> ShrinkWrap::reachable(int block) const {
+  auto& blocks = cfg_.blocks;
+  std::vector<bool> seen(blocks.size(), false);
+  std::vector<int> worklist = blocks[block].succs;
+  while (!worklist.empty()) {
+    int cur = worklist.back();
+    worklist.pop_back();
+    if (seen[cur]) {
+      continue;
+    }
+    seen[cur] = true;
+    worklist.insert(worklist.end(), blocks[cur].succs.begin(),
+                    blocks[cur].succs.end());
+  }
+  return seen;
+}
+
+bool ShrinkWrap::uses_frame(int block) const {
+  bool uses = false;
+  for (size_t i = cfg_.blocks[block].body; i < cfg_.blocks[block].end; ++i) {
+    map_operands(instructions_[i], [&uses](const std::shared_ptr<Asm>& op) {
+      uses = uses || (op && std::holds_alternative<AsmStack>(*op));
+      return op;
+    });
+  }
+  return uses;
+}
+
+void ShrinkWrap::share_epilogue() {
+  // DeallocateStack Return pairs; the first one in the hot part is kept
+  std::vector<size_t> sites;
+  size_t shared = instructions_.size();
+  bool cold = false;
+  for (size_t i = 0; i + 1 < instructions_.size(); ++i) {
+    if (std::holds_alternative<AsmSection>(*instructions_[i])) {
+      cold = true;
+    }
+    if (std::holds_alternative<AsmDeallocateStack>(*instructions_[i]) &&
+        std::holds_alternative<AsmReturn>(*instructions_[i + 1])) {
+      sites.push_back(i);
+      if (!cold && shared == instructions_.size()) {
+        shared = i;
+      }
+    }
+  }
+  if (sites.size() < 2) {
+    return;
+  }
+  if (shared == instructions_.size()) {
+    shared = sites[0];
+  }
+
+  auto label = TackyCFG::unique_label("epilogue");
+  std::vector<std::shared_ptr<Asm>> insts;
+  size_t next = 0;
+  for (size_t i = 0; i < instructions_.size(); ++i) {
+    if (next < sites.size() && sites[next] == i) {
+      ++next;
+      if (i == shared) {
+        add_inst<AsmLabel>(insts, label);
+      } else {
+        add_inst<AsmJmp>(insts, make_asm<AsmLabel>(label));
+        ++i;
+        ++merged_;
+        continue;
+      }
+    }
+    insts.push_back(instructions_[i]);
+  }
+  instructions_ = std::move(insts);
+}
@@ -0,0 +1,147 @@
+#include "StoreForwarding.h"
+#include "Util.h"
+#include <algorithm>
+
+using namespace ccomp;
+
+StoreForwarding::StoreForwarding(std::vector<std::shared_ptr<Asm>>& instructions) :
+  instructions_(instructions)
+{}
+
+std::shared_ptr<Asm> StoreForwarding::forward(const std::shared_ptr<Asm>& operand) const {
+  auto stack = std::get_if<AsmStack>(operand.get());
+  if (stack == nullptr) {
+    return operand;
+  }
+  for (auto [reg, offset] : holds_) {
+    if (offset == stack->offset) {
+      return make_asm<AsmRegister>((AsmReg)reg);
+    }
+  }
+  return operand;
+}
+
+void StoreForwarding::written(const std::shared_ptr<Asm>& operand) {
+  if (auto reg = std::get_if<AsmRegister>(operand.get())) {
+    holds_.erase(reg->reg);
+  } else if (auto stack = std::get_if<AsmStack>(operand.get())) {
+    std::erase_if(holds_, [stack](auto& entry) {
+      return entry.second == stack->offset;
+    });
+  }
+}
+
+int StoreForwarding::run() {
+  int changed = 0;
+  std::vector<std::shared_ptr<Asm>> result;
+  holds_.clear();
+  auto reg_operand = [](AsmReg reg) { return make_asm<AsmRegister>(reg); };
+
+  for (auto& inst : instructions_) {
+    auto emit = inst;
+    if (std::holds_alternative<AsmLabel>(*inst)) {
+      // another path may get here with different registers
+      holds_.clear();
+    } else if (auto mov = std::get_if<AsmMov>(inst.get())) {
+      auto src_stack = std::get_if<AsmStack>(mov->src.get());
+      auto src_reg = std::get_if<AsmRegister>(mov->src.get());
+      auto dest_stack = std::get_if<AsmStack>(mov->dest.get());
+      auto dest_reg = std::get_if<AsmRegister>(mov->dest.get());
+
+      if (src_stack && dest_reg) {
+        // movl -4(%rbp), %r10d
+        auto it = holds_.find(dest_reg->reg);
+        if (it != holds_.end() && it->second == src_stack->offset) {
+          ++changed;
+          continue;
+        }
+        auto src = forward(mov->src);
+        if (src != mov->src) {
+          emit = make_asm<AsmMov>(src, mov->dest);
+          ++changed;
+        }
+        holds_[dest_reg->reg] = src_stack->offset;
+        result.push_back(emit);
+        continue;
+      }
+      if (src_reg && dest_stack) {
+        // movl %r10d, -4(%rbp)
+        auto it = holds_.find(src_reg->reg);
+        if (it != holds_.end() && it->second == dest_stack->offset) {
+          ++changed;
+          continue;
+        }
+        written(mov->dest);
+        holds_[src_reg->reg] = dest_stack->offset;
+        result.push_back(emit);
+        continue;
+      }
+      auto src = forward(mov->src);
+      if (src != mov->src) {
+        emit = make_asm<AsmMov>(src, mov->dest);
+        ++changed;
+      }
+      written(mov->dest);
+    } else if (auto bin = std::get_if<AsmBinary>(inst.get())) {
+      auto src = forward(bin->operand1);
+      if (src != bin->operand1) {
+        emit = make_asm<AsmBinary>(bin->op, src, bin->operand2);
+        ++changed;
+      }
+      written(bin->operand2);
+    } else if (auto cmp = std::get_if<AsmCmp>(inst.get())) {
+      auto op1 = forward(cmp->operand1), op2 = forward(cmp->operand2);
+      if (op1 != cmp->operand1 || op2 != cmp->operand2) {
+        emit = make_asm<AsmCmp>(op1, op2);
+        ++changed;
+      }
+    } else if (auto imul = std::get_if<AsmImulImm>(inst.get())) {
+      auto src = forward(imul->src);
+      if (src != imul->src) {
+        emit = make_asm<AsmImulImm>(imul->value, src, imul->dest);
+        ++changed;
+      }
+      written(imul->dest);
+    } else if (auto lea = std::get_if<AsmLea>(inst.get())) {
+      // base and index are registers by now
+      written(lea->dest);
+    } else if (auto shift = std::get_if<AsmShift>(inst.get())) {
+      written(shift->operand);
+    } else if (auto imul = std::get_if<AsmImulHi>(inst.get())) {
+      auto src = forward(imul->operand);
+      if (src != imul->operand) {
+        emit = make_asm<AsmImulHi>(src);
+        ++changed;
+      }
+      written(reg_operand(AsmReg::AX));
+      written(reg_operand(AsmReg::DX));
+    } else if (auto idiv = std::get_if<AsmIdiv>(inst.get())) {
+      auto src = forward(idiv->operand);
+      if (src != idiv->operand) {
+        emit = make_asm<AsmIdiv>(src);
+        ++changed;
+      }
+      written(reg_operand(AsmReg::AX));
+      written(reg_operand(AsmReg::DX));
+    } else if (std::holds_alternative<AsmCdq>(*inst)) {
+      written(reg_operand(AsmReg::DX));
+    } else if (auto unary = std::get_if<AsmUnary>(inst.get())) {
+      written(unary->operand);
+    } else if (auto setcc = std::get_if<AsmSetCC>(inst.get())) {
+      written(setcc->operand);
+    } else if (auto cmov = std::get_if<AsmCMovCC>(inst.get())) {
+      auto src = forward(cmov->src);
+      if (src != cmov->src) {
+        emit = make_asm<AsmCMovCC>(cmov->cond_code, src, cmov->dest);
+        ++changed;
+      }
+      written(cmov->dest);
+    } else if (std::holds_alternative<AsmJumpTable>(*inst)) {
+      // the dispatch sequence uses %r10 and %r11
+      holds_.clear();
+    }
+    result.push_back(emit);
+  }
+  instructions_ = std::move(result);
+  return changed;
+}
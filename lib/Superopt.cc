@@ -0,0 +1,194 @@
+#include "Superopt.h"
+#include "SuperoptRules.h"
+#include "Util.h"
+#include <format>
+#include <sstream>
+
+using namespace ccomp;
+using namespace ccomp::superopt;
+
+std::shared_ptr<Asm> superopt::reg_a() {
+  return make_asm<AsmPseudo>("A");
+}
+
+std::shared_ptr<Asm> superopt::reg_b() {
+  return make_asm<AsmPseudo>("B");
+}
+
+std::shared_ptr<Asm> superopt::imm(int value) {
+  return make_asm<AsmImm>(value);
+}
+
+std::shared_ptr<Asm> superopt::mov(std::shared_ptr<Asm> src,
+                                   std::shared_ptr<Asm> dest) {
+  return make_asm<AsmMov>(src, dest);
+}
+
+std::shared_ptr<Asm> superopt::binary(TokenType op, std::shared_ptr<Asm> src,
+                                      std::shared_ptr<Asm> dest) {
+  return make_asm<AsmBinary>(make_op(op), src, dest);
+}
+
+std::shared_ptr<Asm> superopt::unary(TokenType op, std::shared_ptr<Asm> dest) {
+  return make_asm<AsmUnary>(make_op(op), dest);
+}
+
+std::shared_ptr<Asm> superopt::shift(AsmShiftOp op, int count,
+                                     std::shared_ptr<Asm> dest) {
+  return make_asm<AsmShift>(op, count, dest);
+}
+
+std::shared_ptr<Asm> superopt::lea(std::shared_ptr<Asm> base,
+                                   std::shared_ptr<Asm> index, int scale,
+                                   int disp, std::shared_ptr<Asm> dest) {
+  return make_asm<AsmLea>(base, index, scale, disp, dest);
+}
+
+std::shared_ptr<Asm> superopt::imul(int value, std::shared_ptr<Asm> src,
+                                    std::shared_ptr<Asm> dest) {
+  return make_asm<AsmImulImm>(value, src, dest);
+}
+
+// the register or immediate an operand names, or nullptr
+static uint32_t* reg_of(const std::shared_ptr<Asm>& operand, uint32_t& a,
+                        uint32_t& b) {
+  auto pseudo = std::get_if<AsmPseudo>(operand.get());
+  if (pseudo == nullptr) {
+    return nullptr;
+  }
+  return (pseudo->identifier == "A") ? &a : &b;
+}
+
+static bool value_of(const std::shared_ptr<Asm>& operand, uint32_t a,
+                     uint32_t b, uint32_t& value) {
+  if (operand == nullptr) {
+    value = 0;
+    return true;
+  } else if (auto constant = std::get_if<AsmImm>(operand.get())) {
+    value = (uint32_t)constant->value;
+    return true;
+  } else if (auto reg = reg_of(operand, a, b)) {
+    value = *reg;
+    return true;
+  }
+  return false;
+}
+
+bool superopt::run(const std::vector<std::shared_ptr<Asm>>& seq, uint32_t& a,
+                   uint32_t& b) {
+  for (auto& inst : seq) {
+    uint32_t src = 0;
+    if (auto mov = std::get_if<AsmMov>(inst.get())) {
+      if (!value_of(mov->src, a, b, src)) {
+        return false;
+      }
+      *reg_of(mov->dest, a, b) = src;
+    } else if (auto bin = std::get_if<AsmBinary>(inst.get())) {
+      uint32_t* dest = reg_of(bin->operand2, a, b);
+      if (!value_of(bin->operand1, a, b, src)) {
+        return false;
+      }
+      switch (bin->op.type) {
+        case TokenType::PLUS: *dest += src; break;
+        case TokenType::MINUS: *dest -= src; break;
+        case TokenType::STAR: *dest *= src; break;
+        case TokenType::AMPERSAND: *dest &= src; break;
+        case TokenType::CARET: *dest ^= src; break;
+        default: return false;
+      }
+    } else if (auto unary = std::get_if<AsmUnary>(inst.get())) {
+      uint32_t* dest = reg_of(unary->operand, a, b);
+      *dest = (unary->op.type == TokenType::MINUS) ? 0u - *dest : ~*dest;
+    } else if (auto shift = std::get_if<AsmShift>(inst.get())) {
+      uint32_t* dest = reg_of(shift->operand, a, b);
+      switch (shift->op) {
+        case AsmShiftOp::SAL: *dest <<= shift->count; break;
+        case AsmShiftOp::SAR: *dest = (uint32_t)((int32_t)*dest >> shift->count); break;
+        case AsmShiftOp::SHR: *dest >>= shift->count; break;
+      }
+    } else if (auto lea = std::get_if<AsmLea>(inst.get())) {
+      uint32_t base, index;
+      value_of(lea->base, a, b, base);
+      value_of(lea->index, a, b, index);
+      *reg_of(lea->dest, a, b) = base + index * lea->scale + (uint32_t)lea->disp;
+    } else if (auto imul = std::get_if<AsmImulImm>(inst.get())) {
+      value_of(imul->src, a, b, src);
+      *reg_of(imul->dest, a, b) = src * (uint32_t)imul->value;
+    } else {
+      return false;
+    }
+  }
+  return true;
+}
+
+int superopt::cost(const std::vector<std::shared_ptr<Asm>>& seq) {
+  int total = 0;
+  for (auto& inst : seq) {
+    auto bin = std::get_if<AsmBinary>(inst.get());
+    bool multiply = std::holds_alternative<AsmImulImm>(*inst) ||
+      (bin && bin->op.type == TokenType::STAR);
+    total += multiply ? 3 : 1;
+  }
+  return total;
+}
+
+static std::string operand_source(const std::shared_ptr<Asm>& operand) {
+  if (operand == nullptr) {
+    return "nullptr";
+  } else if (auto constant = std::get_if<AsmImm>(operand.get())) {
+    return std::format("imm({})", constant->value);
+  }
+  return (std::get<AsmPseudo>(*operand).identifier == "A") ? "A" : "B";
+}
+
+static std::string op_source(TokenType op) {
+  switch (op) {
+    case TokenType::PLUS: return "TokenType::PLUS";
+    case TokenType::MINUS: return "TokenType::MINUS";
+    case TokenType::STAR: return "TokenType::STAR";
+    case TokenType::AMPERSAND: return "TokenType::AMPERSAND";
+    case TokenType::CARET: return "TokenType::CARET";
+    case TokenType::TILDE: return "TokenType::TILDE";
+    default: return "";
+  }
+}
+
+std::string superopt::source(const std::vector<std::shared_ptr<Asm>>& seq) {
+  static const char* shift_names[] = {"AsmShiftOp::SAL", "AsmShiftOp::SAR",
+                                      "AsmShiftOp::SHR"};
+  std::stringstream ss;
+  ss << "{";
+  const char* sep = "";
+  for (auto& inst : seq) {
+    ss << sep;
+    sep = ", ";
+    if (auto mov = std::get_if<AsmMov>(inst.get())) {
+      ss << std::format("mov({}, {})", operand_source(mov->src),
+                        operand_source(mov->dest));
+    } else if (auto bin = std::get_if<AsmBinary>(inst.get())) {
+      ss << std::format("binary({}, {}, {})", op_source(bin->op.type),
+                        operand_source(bin->operand1),
+                        operand_source(bin->operand2));
+    } else if (auto unary = std::get_if<AsmUnary>(inst.get())) {
+      ss << std::format("unary({}, {})", op_source(unary->op.type),
+                        operand_source(unary->operand));
+    } else if (auto shift = std::get_if<AsmShift>(inst.get())) {
+      ss << std::format("shift({}, {}, {})", shift_names[shift->op],
+                        shift->count, operand_source(shift->operand));
+    } else if (auto lea = std::get_if<AsmLea>(inst.get())) {
+      ss << std::format("lea({}, {}, {}, {}, {})", operand_source(lea->base),
+                        operand_source(lea->index), lea->scale, lea->disp,
+                        operand_source(lea->dest));
+    } else if (auto imul = std::get_if<AsmImulImm>(inst.get())) {
+      ss << std::format("imul({}, {}, {})", imul->value,
+                        operand_source(imul->src), operand_source(imul->dest));
+    }
+  }
+  ss << "}";
+  return ss.str();
+}
+
+const std::vector<SuperoptRule>& ccomp::superopt_rules() {
+  static const std::vector<SuperoptRule> rules = make_superopt_rules();
+  return rules;
+}
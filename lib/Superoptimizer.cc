@@ -0,0 +1,293 @@
+// Offline superoptimizer: enumerates short Asm sequences over two registers,
+// finds cheaper sequences computing the same values by testing on boundary
+// and random 32-bit inputs, and writes the rewrites to SuperoptRules.h for
+// the peephole pass.
+//
+//   superoptimizer <include dir> [max pattern length]
+
+#include "Superopt.h"
+#include <cctype>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <random>
+#include <sstream>
+#include <unordered_map>
+#include <unordered_set>
+
+using namespace ccomp;
+using namespace ccomp::superopt;
+
+using Seq = std::vector<std::shared_ptr<Asm>>;
+
+static const int kVerifyInputs = 200000;
+
+// The instructions AsmGen and TreeMatcher emit, over A and B and the
+// immediates they commonly use.
+static std::vector<std::shared_ptr<Asm>> alphabet() {
+  std::vector<std::shared_ptr<Asm>> insts;
+  auto A = reg_a(), B = reg_b();
+  std::vector<std::shared_ptr<Asm>> regs = {A, B};
+  std::vector<std::shared_ptr<Asm>> imms = {imm(0), imm(1), imm(-1), imm(2)};
+
+  for (auto& dest : regs) {
+    auto other = (dest == A) ? B : A;
+    insts.push_back(mov(other, dest));
+    for (auto& value : imms) {
+      insts.push_back(mov(value, dest));
+    }
+    for (auto op : {TokenType::PLUS, TokenType::MINUS, TokenType::STAR,
+                    TokenType::AMPERSAND, TokenType::CARET}) {
+      for (auto& src : {A, B}) {
+        insts.push_back(binary(op, src, dest));
+      }
+      for (auto& value : imms) {
+        insts.push_back(binary(op, value, dest));
+      }
+    }
+    insts.push_back(unary(TokenType::MINUS, dest));
+    insts.push_back(unary(TokenType::TILDE, dest));
+    for (auto op : {AsmShiftOp::SAL, AsmShiftOp::SAR, AsmShiftOp::SHR}) {
+      for (int count : {1, 2, 31}) {
+        insts.push_back(shift(op, count, dest));
+      }
+    }
+    for (int disp : {0, 1, -1}) {
+      for (auto& base : regs) {
+        insts.push_back(lea(base, nullptr, 1, disp, dest));
+        for (auto& index : regs) {
+          for (int scale : {1, 2, 4, 8}) {
+            insts.push_back(lea(base, index, scale, disp, dest));
+          }
+        }
+      }
+      for (auto& index : regs) {
+        for (int scale : {2, 4, 8}) {
+          insts.push_back(lea(nullptr, index, scale, disp, dest));
+        }
+      }
+    }
+    for (int value : {-1, 2, 3, 4, 5, 8, 9}) {
+      for (auto& src : regs) {
+        insts.push_back(imul(value, src, dest));
+      }
+    }
+  }
+  return insts;
+}
+
+static std::vector<std::pair<uint32_t, uint32_t>> test_inputs() {
+  std::vector<uint32_t> edges = {0, 1, 2, 3, 7, 31, 32, 100, 0xffffffff,
+                                 0xfffffffe, 0x80000000, 0x80000001,
+                                 0x7fffffff, 0x7ffffffe, 0x55555555,
+                                 0xaaaaaaaa, 0x10000, 0xffff};
+  std::vector<std::pair<uint32_t, uint32_t>> inputs;
+  for (auto a : edges) {
+    for (auto b : edges) {
+      inputs.emplace_back(a, b);
+    }
+  }
+  std::mt19937 rng(12345);
+  for (int i = 0; i < 64; ++i) {
+    inputs.emplace_back(rng(), rng());
+  }
+  return inputs;
+}
+
+// outputs of seq on every input, hashed
+static uint64_t fingerprint(const Seq& seq,
+                            const std::vector<std::pair<uint32_t, uint32_t>>& inputs) {
+  uint64_t hash = 14695981039346656037ull;
+  for (auto [a, b] : inputs) {
+    run(seq, a, b);
+    hash = (hash ^ a) * 1099511628211ull;
+    hash = (hash ^ b) * 1099511628211ull;
+  }
+  return hash;
+}
+
+static bool equivalent(const Seq& x, const Seq& y,
+                       const std::vector<std::pair<uint32_t, uint32_t>>& inputs) {
+  auto same = [&x, &y](uint32_t a, uint32_t b) {
+    uint32_t xa = a, xb = b, ya = a, yb = b;
+    run(x, xa, xb);
+    run(y, ya, yb);
+    return xa == ya && xb == yb;
+  };
+  for (auto [a, b] : inputs) {
+    if (!same(a, b)) {
+      return false;
+    }
+  }
+  std::mt19937 rng(67890);
+  for (int i = 0; i < kVerifyInputs; ++i) {
+    if (!same(rng(), rng())) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// whether seq names B before A; the peephole binds A and B either way
+static bool canonical(const Seq& seq) {
+  std::stringstream ss(source(seq));
+  std::string word;
+  while (std::getline(ss, word, ' ')) {
+    while (!word.empty() && !isalnum(word.back())) {
+      word.pop_back();
+    }
+    word = word.substr(word.find_last_of('(') + 1);
+    if (word == "A") {
+      return true;
+    } else if (word == "B") {
+      return false;
+    }
+  }
+  return true;
+}
+
+static std::shared_ptr<Asm> dest_of(const std::shared_ptr<Asm>& inst) {
+  if (auto mov = std::get_if<AsmMov>(inst.get())) {
+    return mov->dest;
+  } else if (auto bin = std::get_if<AsmBinary>(inst.get())) {
+    return bin->operand2;
+  } else if (auto unary = std::get_if<AsmUnary>(inst.get())) {
+    return unary->operand;
+  } else if (auto shift = std::get_if<AsmShift>(inst.get())) {
+    return shift->operand;
+  } else if (auto lea = std::get_if<AsmLea>(inst.get())) {
+    return lea->dest;
+  }
+  return std::get<AsmImulImm>(*inst).dest;
+}
+
+static bool reads(const std::shared_ptr<Asm>& inst,
+                  const std::shared_ptr<Asm>& reg) {
+  if (auto mov = std::get_if<AsmMov>(inst.get())) {
+    return mov->src == reg;
+  } else if (auto bin = std::get_if<AsmBinary>(inst.get())) {
+    return bin->operand1 == reg || bin->operand2 == reg;
+  } else if (auto lea = std::get_if<AsmLea>(inst.get())) {
+    return lea->base == reg || lea->index == reg;
+  } else if (auto imul = std::get_if<AsmImulImm>(inst.get())) {
+    return imul->src == reg;
+  }
+  return dest_of(inst) == reg;
+}
+
+// Whether every instruction reads the result of the one before. Others are
+// independent instructions or dead writes, which the table leaves to the
+// register allocator's liveness.
+static bool connected(const Seq& seq) {
+  for (size_t i = 1; i < seq.size(); ++i) {
+    if (!reads(seq[i], dest_of(seq[i - 1]))) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// Whether seq has a lea. TreeMatcher already picks those by cost, so
+// patterns containing one mostly cannot occur and only bloat the table;
+// replacements may still use them.
+static bool selected(const Seq& seq) {
+  for (auto& inst : seq) {
+    if (std::holds_alternative<AsmLea>(*inst)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+static bool better(const Seq& x, const Seq& y) {
+  int cx = cost(x), cy = cost(y);
+  return cx < cy || (cx == cy && x.size() < y.size());
+}
+
+int main(int argc, char** argv) {
+  if (argc < 2) {
+    fprintf(stderr, "Usage: superoptimizer <include dir> [max length]\n");
+    return 1;
+  }
+  size_t max_length = (argc > 2) ? std::atoi(argv[2]) : 2;
+  auto insts = alphabet();
+  auto inputs = test_inputs();
+
+  // cheapest known sequence for every fingerprint
+  std::unordered_map<uint64_t, Seq> cheapest;
+  std::vector<Seq> level = {{}};
+  cheapest[fingerprint({}, inputs)] = {};
+
+  std::vector<std::pair<Seq, Seq>> rules;
+  // patterns with a rule, as source text, so longer ones containing them
+  // are skipped
+  std::unordered_set<std::string> reducible;
+  auto contains_reducible = [&reducible](const Seq& seq) {
+    for (size_t len = 1; len < seq.size(); ++len) {
+      for (size_t i = 0; i + len <= seq.size(); ++i) {
+        Seq window(seq.begin() + i, seq.begin() + i + len);
+        if (reducible.contains(source(window))) {
+          return true;
+        }
+      }
+    }
+    return false;
+  };
+
+  for (size_t length = 1; length <= max_length; ++length) {
+    std::vector<std::pair<Seq, uint64_t>> candidates;
+    for (auto& prefix : level) {
+      for (auto& inst : insts) {
+        Seq seq = prefix;
+        seq.push_back(inst);
+        if (connected(seq) && !contains_reducible(seq)) {
+          candidates.emplace_back(seq, fingerprint(seq, inputs));
+        }
+      }
+    }
+    for (auto& [seq, print] : candidates) {
+      auto it = cheapest.find(print);
+      if (it == cheapest.end() || better(seq, it->second)) {
+        cheapest[print] = seq;
+      }
+    }
+    // only sequences with no cheaper equivalent are worth extending
+    std::vector<Seq> next;
+    for (auto& [seq, print] : candidates) {
+      auto& best = cheapest[print];
+      if (better(best, seq) && equivalent(best, seq, inputs)) {
+        reducible.insert(source(seq));
+        if (canonical(seq) && !selected(seq)) {
+          rules.emplace_back(seq, best);
+        }
+      } else {
+        next.push_back(seq);
+      }
+    }
+    level = std::move(next);
+    fprintf(stderr, "length %zu: %zu sequences, %zu rules\n", length,
+            level.size(), rules.size());
+  }
+
+  std::string path = std::string(argv[1]) + "/SuperoptRules.h";
+  std::ofstream file(path);
+  file << "// Generated by superoptimizer. Do not edit.\n"
+       << "#ifndef SUPEROPTRULES_H\n"
+       << "#define SUPEROPTRULES_H\n\n"
+       << "#include \"Superopt.h\"\n\n"
+       << "namespace ccomp {\n"
+       << "inline std::vector<SuperoptRule> make_superopt_rules() {\n"
+       << "  using namespace superopt;\n"
+       << "  auto A = reg_a();\n"
+       << "  auto B = reg_b();\n"
+       << "  return {\n";
+  for (auto& [pattern, replacement] : rules) {
+    file << "    {" << source(pattern) << ",\n"
+         << "     " << source(replacement) << "},\n";
+  }
+  file << "  };\n"
+       << "}\n"
+       << "}\n\n"
+       << "#endif // SUPEROPTRULES_H\n";
+  return 0;
+}
@@ -0,0 +1,380 @@
+#include "TackyCFG.h"
+#include "Util.h"
+#include <algorithm>
+#include <cassert>
+#include <format>
+#include <unordered_set>
+
+using namespace ccomp;
+
+std::shared_ptr<Tacky> ccomp::tacky_dest(const Tacky& inst) {
+  if (auto unary = std::get_if<TackyUnary>(&inst)) {
+    return unary->dest;
+  } else if (auto bin = std::get_if<TackyBinary>(&inst)) {
+    return bin->dest;
+  } else if (auto copy = std::get_if<TackyCopy>(&inst)) {
+    return copy->dest;
+  } else if (auto select = std::get_if<TackySelect>(&inst)) {
+    return select->dest;
+  }
+  return nullptr;
+}
+
+std::vector<std::shared_ptr<Tacky>> ccomp::tacky_srcs(const Tacky& inst) {
+  if (auto unary = std::get_if<TackyUnary>(&inst)) {
+    return {unary->src};
+  } else if (auto bin = std::get_if<TackyBinary>(&inst)) {
+    return {bin->src1, bin->src2};
+  } else if (auto copy = std::get_if<TackyCopy>(&inst)) {
+    return {copy->src};
+  } else if (auto select = std::get_if<TackySelect>(&inst)) {
+    return {select->condition, select->src1, select->src2};
+  } else if (auto ret = std::get_if<TackyReturn>(&inst)) {
+    return {ret->value};
+  } else if (auto jmp = std::get_if<TackyJumpIfZero>(&inst)) {
+    return {jmp->condition};
+  } else if (auto jmp = std::get_if<TackyJumpIfNotZero>(&inst)) {
+    return {jmp->condition};
+  } else if (auto table = std::get_if<TackyJumpTable>(&inst)) {
+    return {table->index};
+  }
+  return {};
+}
+
+const std::string* ccomp::var_name(const std::shared_ptr<Tacky>& val) {
+  if (val == nullptr) {
+    return nullptr;
+  }
+  auto var = std::get_if<TackyVar>(val.get());
+  return var ? &var->identifier : nullptr;
+}
+
+bool ccomp::is_terminator(const Tacky& inst) {
+  return std::holds_alternative<TackyReturn>(inst) ||
+         std::holds_alternative<TackyJump>(inst) ||
+         std::holds_alternative<TackyJumpIfZero>(inst) ||
+         std::holds_alternative<TackyJumpIfNotZero>(inst) ||
+         std::holds_alternative<TackyJumpTable>(inst);
+}
+
+static const std::string& label_of(const std::shared_ptr<Tacky>& target) {
+  auto label = std::get_if<TackyLabel>(target.get());
+  assert(label != nullptr);
+  return label->identifier;
+}
+
+std::vector<std::string> ccomp::successors(const TackyBlock& block) {
+  std::vector<std::string> succs;
+  for (auto& inst : block.instructions) {
+    if (auto jmp = std::get_if<TackyJump>(inst.get())) {
+      succs.push_back(label_of(jmp->target));
+    } else if (auto jmp = std::get_if<TackyJumpIfZero>(inst.get())) {
+      succs.push_back(label_of(jmp->target));
+    } else if (auto jmp = std::get_if<TackyJumpIfNotZero>(inst.get())) {
+      succs.push_back(label_of(jmp->target));
+    } else if (auto table = std::get_if<TackyJumpTable>(inst.get())) {
+      for (auto& target : table->targets) {
+        succs.push_back(label_of(target));
+      }
+    }
+  }
+  return succs;
+}
+
+void ccomp::retarget(TackyBlock& block, const std::string& from,
+                     const std::string& to) {
+  for (auto& inst : block.instructions) {
+    if (auto jmp = std::get_if<TackyJump>(inst.get())) {
+      if (label_of(jmp->target) == from) {
+        inst = make_tacky<TackyJump>(make_tacky<TackyLabel>(to));
+      }
+    } else if (auto jmp = std::get_if<TackyJumpIfZero>(inst.get())) {
+      if (label_of(jmp->target) == from) {
+        inst = make_tacky<TackyJumpIfZero>(jmp->condition,
+                                           make_tacky<TackyLabel>(to),
+                                           jmp->prob);
+      }
+    } else if (auto jmp = std::get_if<TackyJumpIfNotZero>(inst.get())) {
+      if (label_of(jmp->target) == from) {
+        inst = make_tacky<TackyJumpIfNotZero>(jmp->condition,
+                                              make_tacky<TackyLabel>(to),
+                                              jmp->prob);
+      }
+    } else if (auto table = std::get_if<TackyJumpTable>(inst.get())) {
+      auto targets = table->targets;
+      for (auto& target : targets) {
+        if (label_of(target) == from) {
+          target = make_tacky<TackyLabel>(to);
+        }
+      }
+      inst = make_tacky<TackyJumpTable>(table->index, targets);
+    }
+  }
+}
+
+bool ccomp::cond_branch(const TackyBlock& block, TackyBranch& branch) {
+  auto& insts = block.instructions;
+  if (insts.size() < 2) {
+    return false;
+  }
+  auto jmp = std::get_if<TackyJump>(insts.back().get());
+  if (jmp == nullptr) {
+    return false;
+  }
+  auto& other = label_of(jmp->target);
+  auto& cond_jump = insts[insts.size() - 2];
+  if (auto jz = std::get_if<TackyJumpIfZero>(cond_jump.get())) {
+    branch = TackyBranch{jz->condition, other, label_of(jz->target),
+                         invert_prob(jz->prob)};
+    return true;
+  } else if (auto jnz = std::get_if<TackyJumpIfNotZero>(cond_jump.get())) {
+    branch = TackyBranch{jnz->condition, label_of(jnz->target), other,
+                         jnz->prob};
+    return true;
+  }
+  return false;
+}
+
+std::string TackyCFG::unique_label(const std::string& desc) {
+  static int nextId = 0;
+  return std::format("O{}.{}", desc, nextId++);
+}
+
+std::string TackyCFG::unique_var() {
+  static int nextId = 0;
+  return std::format("opt.{}", nextId++);
+}
+
+TackyCFG::TackyCFG(const std::vector<std::shared_ptr<Tacky>>& instructions) {
+  // The current block is "closed" by a Return or Jump, and "pending" after a
+  // conditional jump whose fallthrough has not been made explicit yet. The
+  // entry block never has predecessors, so it cannot be a loop header.
+  bool closed = false, pending = false;
+  TackyBlock cur{unique_label("entry"), {}};
+
+  auto finish = [&](const std::string& next) {
+    if (!closed) {
+      cur.instructions.emplace_back(
+        make_tacky<TackyJump>(make_tacky<TackyLabel>(next)));
+    }
+    blocks.emplace_back(std::move(cur));
+    cur = TackyBlock{next, {}};
+    closed = pending = false;
+  };
+
+  for (auto& inst : instructions) {
+    // constants are emitted as no-op instructions by TackyGen
+    if (std::holds_alternative<TackyConstant>(*inst)) {
+      continue;
+    }
+
+    if (auto label = std::get_if<TackyLabel>(inst.get())) {
+      finish(label->identifier);
+      continue;
+    }
+
+    if (closed || pending) {
+      finish(unique_label("bb"));
+    }
+
+    cur.instructions.push_back(inst);
+    if (std::holds_alternative<TackyReturn>(*inst) ||
+        std::holds_alternative<TackyJump>(*inst) ||
+        std::holds_alternative<TackyJumpTable>(*inst)) {
+      closed = true;
+    } else if (is_terminator(*inst)) {
+      pending = true;
+    }
+  }
+
+  blocks.emplace_back(std::move(cur));
+  analyze();
+}
+
+std::vector<std::shared_ptr<Tacky>> TackyCFG::instructions() const {
+  std::vector<std::shared_ptr<Tacky>> insts;
+  std::unordered_set<std::string> used;
+  for (size_t i = 0; i < blocks.size(); ++i) {
+    auto& block = blocks[i];
+    insts.emplace_back(make_tacky<TackyLabel>(block.label));
+    for (size_t j = 0; j < block.instructions.size(); ++j) {
+      auto& inst = block.instructions[j];
+      // falls through to the next block
+      if (auto jmp = std::get_if<TackyJump>(inst.get());
+          jmp && j + 1 == block.instructions.size() &&
+          i + 1 < blocks.size() &&
+          label_of(jmp->target) == blocks[i + 1].label) {
+        continue;
+      }
+      insts.push_back(inst);
+    }
+  }
+  for (auto& succ : successors(TackyBlock{"", insts})) {
+    used.insert(succ);
+  }
+
+  // drop labels nobody jumps to
+  std::erase_if(insts, [&used](const std::shared_ptr<Tacky>& inst) {
+    auto label = std::get_if<TackyLabel>(inst.get());
+    return label && !used.contains(label->identifier);
+  });
+  return insts;
+}
+
+int TackyCFG::find_block(const std::string& label) const {
+  auto it = label_to_block_.find(label);
+  return (it == label_to_block_.end()) ? -1 : it->second;
+}
+
+void TackyCFG::analyze() {
+  label_to_block_.clear();
+  for (size_t i = 0; i < blocks.size(); ++i) {
+    label_to_block_[blocks[i].label] = i;
+  }
+
+  succs.assign(blocks.size(), {});
+  preds.assign(blocks.size(), {});
+  for (size_t i = 0; i < blocks.size(); ++i) {
+    for (auto& label : successors(blocks[i])) {
+      int succ = find_block(label);
+      assert(succ >= 0);
+      if (std::find(succs[i].begin(), succs[i].end(), succ) == succs[i].end()) {
+        succs[i].push_back(succ);
+        preds[succ].push_back(i);
+      }
+    }
+  }
+
+  compute_dominators();
+  find_loops();
+}
+
+void TackyCFG::compute_dominators() {
+  // reverse postorder from the entry block
+  rpo.clear();
+  rpo_index_.assign(blocks.size(), -1);
+  idom.assign(blocks.size(), -1);
+  if (blocks.empty()) {
+    return;
+  }
+
+  std::vector<bool> visited(blocks.size(), false);
+  std::vector<std::pair<int, size_t>> stack = {{0, 0}};
+  visited[0] = true;
+  while (!stack.empty()) {
+    auto& [block, next] = stack.back();
+    if (next < succs[block].size()) {
+      int succ = succs[block][next++];
+      if (!visited[succ]) {
+        visited[succ] = true;
+        stack.push_back({succ, 0});
+      }
+    } else {
+      rpo.push_back(block);
+      stack.pop_back();
+    }
+  }
+  std::reverse(rpo.begin(), rpo.end());
+  for (size_t i = 0; i < rpo.size(); ++i) {
+    rpo_index_[rpo[i]] = i;
+  }
+
+  // Cooper, Harvey and Kennedy, "A Simple, Fast Dominance Algorithm"
+  auto intersect = [this](int a, int b) {
+    while (a != b) {
+      while (rpo_index_[a] > rpo_index_[b]) a = idom[a];
+      while (rpo_index_[b] > rpo_index_[a]) b = idom[b];
+    }
+    return a;
+  };
+
+  idom[0] = 0;
+  bool changed = true;
+  while (changed) {
+    changed = false;
+    for (size_t i = 1; i < rpo.size(); ++i) {
+      int block = rpo[i];
+      int new_idom = -1;
+      for (int pred : preds[block]) {
+        if (idom[pred] == -1) {
+          continue;
+        }
+        new_idom = (new_idom == -1) ? pred : intersect(pred, new_idom);
+      }
+      if (idom[block] != new_idom) {
+        idom[block] = new_idom;
+        changed = true;
+      }
+    }
+  }
+}
+
+bool TackyCFG::dominates(int a, int b) const {
+  if (idom[b] == -1) {
+    return false;
+  }
+  while (b != a && b != 0) {
+    b = idom[b];
+  }
+  return b == a;
+}
+
+void TackyCFG::find_loops() {
+  loops.clear();
+  std::unordered_map<int, size_t> header_to_loop;
+  for (int block : rpo) {
+    for (int succ : succs[block]) {
+      if (!dominates(succ, block)) {
+        continue;
+      }
+
+      // back edge block -> succ
+      auto [it, inserted] = header_to_loop.insert({succ, loops.size()});
+      if (inserted) {
+        loops.push_back(TackyLoop{succ, {succ}, {}, true});
+      }
+      auto& loop = loops[it->second];
+      loop.latches.push_back(block);
+
+      std::vector<int> worklist = {block};
+      while (!worklist.empty()) {
+        int cur = worklist.back();
+        worklist.pop_back();
+        if (std::find(loop.blocks.begin(), loop.blocks.end(), cur) !=
+            loop.blocks.end()) {
+          continue;
+        }
+        loop.blocks.push_back(cur);
+        for (int pred : preds[cur]) {
+          worklist.push_back(pred);
+        }
+      }
+    }
+  }
+
+  for (auto& loop : loops) {
+    std::sort(loop.blocks.begin(), loop.blocks.end());
+  }
+  for (auto& loop : loops) {
+    for (auto& other : loops) {
+      if (&other != &loop && in_loop(loop, other.header)) {
+        loop.innermost = false;
+      }
+    }
+  }
+}
+
+bool TackyCFG::in_loop(const TackyLoop& loop, int block) const {
+  return std::binary_search(loop.blocks.begin(), loop.blocks.end(), block);
+}
+
+void TackyCFG::remove_unreachable() {
+  std::vector<TackyBlock> reachable;
+  for (size_t i = 0; i < blocks.size(); ++i) {
+    if (i == 0 || idom[i] != -1) {
+      reachable.emplace_back(std::move(blocks[i]));
+    }
+  }
+  blocks = std::move(reachable);
+  analyze();
+}
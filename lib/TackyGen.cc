@@ -3,15 +3,19 @@
 //#include "ast/Asm.h"
 #include "ast/Tacky.h"
 #include "Util.h"
+#include <algorithm>
 #include <cassert>
+#include <climits>
+#include <cstdio>
 #include <format>
 #include <memory>
 #include <vector>
 
 using namespace ccomp;
 
-TackyGen::TackyGen(const std::vector<std::unique_ptr<Stmt>>& stmts, ErrorHandler &errorHandler) :
-  stmts_(stmts), errorHandler_(errorHandler)
+TackyGen::TackyGen(const std::vector<std::unique_ptr<Stmt>>& stmts,
+                   const Options& options, ErrorHandler &errorHandler) :
+  stmts_(stmts), options_(options), errorHandler_(errorHandler)
 {}
 
 std::shared_ptr<Tacky> TackyGen::gen() {
@@ -56,6 +60,14 @@ std::string TackyGen::continue_label(int loop_label) {
   return std::format("continue_loop{}", loop_label);
 }
 
+std::string TackyGen::case_label(int loop_label, int index) {
+  return std::format("switch{}_case{}", loop_label, index);
+}
+
+std::string TackyGen::default_label(int loop_label) {
+  return std::format("switch{}_default", loop_label);
+}
+
 std::shared_ptr<Tacky> TackyGen::operator()(const Block& stmt) {
   gen(stmt.stmts);
   return nullptr;
@@ -68,33 +80,34 @@ std::shared_ptr<Tacky> TackyGen::operator()(const Expression& stmt) {
 std::shared_ptr<Tacky> TackyGen::operator()(const Function& fn) {
   // start with empty instructions
   instructions_.clear();
+  peak_ordered_ = peak_source_ = swapped_ = 0;
   gen(fn.body);
 
   // return 0 statement added to every function
 
   instructions_.emplace_back(
     make_tacky<TackyReturn>(make_tacky<TackyConstant>(0)));
+  if (options_.stats) {
+    fprintf(stderr, "%s: evaluation order peak registers %d -> %d, "
+            "%d operators swapped\n", fn.name.lexeme.c_str(), peak_source_,
+            peak_ordered_, swapped_);
+  }
   return make_tacky<TackyFunction>(fn.name, std::move(instructions_));
 }
 
 std::shared_ptr<Tacky> TackyGen::operator()(const If& ifstmt) {
-  // <instructions for condition>
-  // c = <result of condition>
-  auto condvar = gen(ifstmt.condition.get());
   auto end_label = make_tacky<TackyLabel>(unique_label("if_end"));
 
   if (ifstmt.elseBranch == nullptr) {
-    // JumpIfZero(c, end)
-    instructions_.emplace_back(
-      make_tacky<TackyJumpIfZero>(condvar, end_label));
+    // <branch to end unless condition>
+    genBranch(ifstmt.condition.get(), end_label, false);
 
     // <instructions for statement>
     gen(ifstmt.thenBranch.get());
   } else {
-    // JumpIfZero(c, else_label)
+    // <branch to else_label unless condition>
     auto else_label = make_tacky<TackyLabel>(unique_label("if_else"));
-    instructions_.emplace_back(
-      make_tacky<TackyJumpIfZero>(condvar, else_label));
+    genBranch(ifstmt.condition.get(), else_label, false);
 
     // <instructions for statement1>
     gen(ifstmt.thenBranch.get());
@@ -132,12 +145,8 @@ std::shared_ptr<Tacky> TackyGen::operator()(const DoWhile& loop) {
   instructions_.emplace_back(
     make_tacky<TackyLabel>(continue_label(loop.loop_label)));
 
-  // <instructions for condition>
-  // v = <result of condition>
-  auto res = gen(loop.condition.get());
-
-  // JumpIfNotZero(v, start)
-  instructions_.emplace_back(make_tacky<TackyJumpIfNotZero>(res, loop_begin));
+  // <branch to start if condition>
+  genBranch(loop.condition.get(), loop_begin, true);
 
   // Label(break_label)
   instructions_.emplace_back(
@@ -145,26 +154,29 @@ std::shared_ptr<Tacky> TackyGen::operator()(const DoWhile& loop) {
   return nullptr;
 }
 
+// Loops are rotated into guarded do-while form: the condition is tested once
+// on entry and then at the bottom of every iteration, so the back edge is the
+// only branch an iteration takes.
 std::shared_ptr<Tacky> TackyGen::operator()(const While& loop) {
-  // Label(start|continue_label)
-  auto loop_begin =
-    make_tacky<TackyLabel>(continue_label(loop.loop_label));
-  instructions_.emplace_back(loop_begin);
-
-  // <instructions for condition>
-  // v = <result of condition>
-  auto res = gen(loop.condition.get());
-
-  // JumpIfZero(v, end|break)
+  auto loop_begin = make_tacky<TackyLabel>(unique_label("while"));
   auto end_label =
     make_tacky<TackyLabel>(break_label(loop.loop_label));
-  instructions_.emplace_back(make_tacky<TackyJumpIfZero>(res, end_label));
+
+  // <branch to end|break unless condition>
+  genBranch(loop.condition.get(), end_label, false);
+
+  // Label(start)
+  instructions_.emplace_back(loop_begin);
 
   // <instructions for body>
   gen(loop.body.get());
 
-  // Jump(continue_label)
-  instructions_.emplace_back(make_tacky<TackyJump>(loop_begin));
+  // Label(continue_label)
+  instructions_.emplace_back(
+    make_tacky<TackyLabel>(continue_label(loop.loop_label)));
+
+  // <branch to start if condition>
+  genBranch(loop.condition.get(), loop_begin, true);
 
   // Label(break_label|end_label)
   instructions_.emplace_back(end_label);
@@ -177,22 +189,18 @@ std::shared_ptr<Tacky> TackyGen::operator()(const For& loop) {
     gen(loop.init.get());
   }
 
-  // Label(start)
   auto loop_begin = make_tacky<TackyLabel>(unique_label("forloop"));
-  instructions_.emplace_back(loop_begin);
-
   auto end_label =
     make_tacky<TackyLabel>(break_label(loop.loop_label));
 
-  // <instructions for condition>
-  // v = <result of condition>
+  // <branch to end|break unless condition>
   if (loop.condition) {
-    auto res = gen(loop.condition.get());
-
-    // JumpIfZero(v, end|break)
-    instructions_.emplace_back(make_tacky<TackyJumpIfZero>(res, end_label));
+    genBranch(loop.condition.get(), end_label, false);
   }
 
+  // Label(start)
+  instructions_.emplace_back(loop_begin);
+
   // <instructions for body>
   gen(loop.body.get());
 
@@ -206,8 +214,12 @@ std::shared_ptr<Tacky> TackyGen::operator()(const For& loop) {
     gen(loop.post.get());
   }
 
-  // Jump(start)
-  instructions_.emplace_back(make_tacky<TackyJump>(loop_begin));
+  // <branch to start if condition>, or Jump(start) without a condition
+  if (loop.condition) {
+    genBranch(loop.condition.get(), loop_begin, true);
+  } else {
+    instructions_.emplace_back(make_tacky<TackyJump>(loop_begin));
+  }
 
   // Label(end|break_label)
   instructions_.emplace_back(end_label);
@@ -256,14 +268,125 @@ std::shared_ptr<Tacky> TackyGen::operator()(const Continue& flow) {
   return nullptr;
 }
 
-std::shared_ptr<Tacky> TackyGen::operator()(const Conditional& ternary) {
-  // <instructions for condition>
-  // c = <result of condition>
-  auto condvar = gen(ternary.condition.get());
+std::shared_ptr<Tacky> TackyGen::operator()(const Switch& stmt) {
+  // v = <result of condition>
+  auto v = gen(stmt.condition.get());
+  auto end_label = make_tacky<TackyLabel>(break_label(stmt.loop_label));
+  auto default_target = stmt.has_default ?
+    make_tacky<TackyLabel>(default_label(stmt.loop_label)) : end_label;
+
+  std::vector<SwitchCase> cases;
+  for (size_t i = 0; i < stmt.cases.size(); ++i) {
+    cases.emplace_back(stmt.cases[i], make_tacky<TackyLabel>(
+      case_label(stmt.loop_label, i)));
+  }
+  std::sort(cases.begin(), cases.end(), [](auto& a, auto& b) {
+    return a.first < b.first;
+  });
+
+  // <dispatch to the case labels>
+  if (auto constant = std::get_if<TackyConstant>(v.get())) {
+    auto it = std::find_if(cases.begin(), cases.end(), [constant](auto& c) {
+      return c.first == constant->value;
+    });
+    instructions_.emplace_back(make_tacky<TackyJump>(
+      (it == cases.end()) ? default_target : it->second));
+  } else {
+    genDispatch(v, cases, 0, cases.size(), default_target, INT_MIN, INT_MAX);
+  }
 
-  // JumpIfZero(c, e2_label)
+  // <instructions for body>
+  gen(stmt.body.get());
+
+  // Label(break_label)
+  instructions_.emplace_back(end_label);
+  return nullptr;
+}
+
+std::shared_ptr<Tacky> TackyGen::operator()(const Case& stmt) {
+  // Label(case_label)
+  // <instructions for statement>
+  instructions_.emplace_back(
+    make_tacky<TackyLabel>(case_label(stmt.loop_label, stmt.index)));
+  gen(stmt.body.get());
+  return nullptr;
+}
+
+std::shared_ptr<Tacky> TackyGen::operator()(const Default& stmt) {
+  // Label(default_label)
+  // <instructions for statement>
+  instructions_.emplace_back(
+    make_tacky<TackyLabel>(default_label(stmt.loop_label)));
+  gen(stmt.body.get());
+  return nullptr;
+}
+
+void TackyGen::genDispatch(std::shared_ptr<Tacky> v,
+                           const std::vector<SwitchCase>& cases,
+                           size_t lo, size_t hi,
+                           std::shared_ptr<Tacky> default_label,
+                           long long min, long long max) {
+  auto jump_if = [this, &v](const Token& op, long long value,
+                            std::shared_ptr<Tacky> target) {
+    // c = v op value
+    // JumpIfNotZero(c, target)
+    auto c = make_tacky<TackyVar>(unique_var());
+    instructions_.emplace_back(make_tacky<TackyBinary>(
+      op, v, make_tacky<TackyConstant>(value), c));
+    instructions_.emplace_back(
+      make_tacky<TackyJumpIfNotZero>(c, target, kUnknownProb));
+  };
+
+  size_t count = hi - lo;
+  long long first = (count > 0) ? cases[lo].first : 0;
+  long long last = (count > 0) ? cases[hi - 1].first : 0;
+
+  if (count >= kJumpTableMinCases &&
+      last - first + 1 <= (long long)count * kJumpTableMaxSpread) {
+    // JumpIfNotZero(v < first, default) JumpIfNotZero(v > last, default)
+    // index = v - first
+    // JumpTable(index, [case labels, default in the gaps])
+    if (first > min) {
+      jump_if(make_op(TokenType::LESS), first, default_label);
+    }
+    if (last < max) {
+      jump_if(make_op(TokenType::GREATER), last, default_label);
+    }
+    auto index = v;
+    if (first != 0) {
+      index = make_tacky<TackyVar>(unique_var());
+      instructions_.emplace_back(make_tacky<TackyBinary>(
+        make_op(TokenType::MINUS), v, make_tacky<TackyConstant>(first), index));
+    }
+    std::vector<std::shared_ptr<Tacky>> targets(last - first + 1, default_label);
+    for (size_t i = lo; i < hi; ++i) {
+      targets[cases[i].first - first] = cases[i].second;
+    }
+    instructions_.emplace_back(make_tacky<TackyJumpTable>(index, targets));
+  } else if (count <= kCompareChainMaxCases) {
+    // JumpIfNotZero(v == case, case_label) ... Jump(default)
+    for (size_t i = lo; i < hi; ++i) {
+      jump_if(make_op(TokenType::EQUAL_EQUAL), cases[i].first, cases[i].second);
+    }
+    instructions_.emplace_back(make_tacky<TackyJump>(default_label));
+  } else {
+    // JumpIfNotZero(v < pivot, left)
+    // <dispatch for the upper half>
+    // Label(left)
+    // <dispatch for the lower half>
+    size_t mid = lo + count / 2;
+    auto left = make_tacky<TackyLabel>(unique_label("switch_left"));
+    jump_if(make_op(TokenType::LESS), cases[mid].first, left);
+    genDispatch(v, cases, mid, hi, default_label, cases[mid].first, max);
+    instructions_.emplace_back(left);
+    genDispatch(v, cases, lo, mid, default_label, min, cases[mid].first - 1);
+  }
+}
+
+std::shared_ptr<Tacky> TackyGen::operator()(const Conditional& ternary) {
+  // <branch to e2_label unless condition>
   auto else_label = make_tacky<TackyLabel>(unique_label("ternary_else"));
-  instructions_.emplace_back(make_tacky<TackyJumpIfZero>(condvar, else_label));
+  genBranch(ternary.condition.get(), else_label, false);
 
   // <instructions to calculate e1>
   // v1 = <result of e1>
@@ -302,10 +425,11 @@ std::shared_ptr<Tacky> TackyGen::genLogical(const BinaryExpr& expr) {
   // JumpIfZero|JumpIfNotZero(v1, result_both_check_label)
   if (op == TokenType::AMPERSAND_AMPERSAND) {
     instructions_.emplace_back(
-      make_tacky<TackyJumpIfZero>(v1, result_both_check_label));
+      make_tacky<TackyJumpIfZero>(v1, result_both_check_label, kUnknownProb));
   } else if (op == TokenType::PIPE_PIPE) {
     instructions_.emplace_back(
-      make_tacky<TackyJumpIfNotZero>(v1, result_both_check_label));
+      make_tacky<TackyJumpIfNotZero>(v1, result_both_check_label,
+                                     kUnknownProb));
   }
 
   // <instructions for e2>
@@ -315,10 +439,11 @@ std::shared_ptr<Tacky> TackyGen::genLogical(const BinaryExpr& expr) {
   // JumpIfZero|JumpIfNotZero(v2, result_both_check_label)
   if (op == TokenType::AMPERSAND_AMPERSAND) {
     instructions_.emplace_back(
-      make_tacky<TackyJumpIfZero>(v2, result_both_check_label));
+      make_tacky<TackyJumpIfZero>(v2, result_both_check_label, kUnknownProb));
   } else if (op == TokenType::PIPE_PIPE) {
     instructions_.emplace_back(
-      make_tacky<TackyJumpIfNotZero>(v2, result_both_check_label));
+      make_tacky<TackyJumpIfNotZero>(v2, result_both_check_label,
+                                     kUnknownProb));
   }
 
   // result = 1|0
@@ -346,6 +471,122 @@ std::shared_ptr<Tacky> TackyGen::genLogical(const BinaryExpr& expr) {
   return result;
 }
 
+void TackyGen::genBranch(Expr* cond, std::shared_ptr<Tacky> target,
+                         bool jump_if_true, int prob) {
+  if (auto expr = std::get_if<Expect>(cond)) {
+    // the jump is taken when cond comes out the expected way
+    int expected = (expr->expect_true == jump_if_true) ? kExpectProb :
+      100 - kExpectProb;
+    genBranch(expr->value.get(), target, jump_if_true, expected);
+    return;
+  }
+
+  if (auto expr = std::get_if<BinaryExpr>(cond);
+      expr && isLogicalOp(expr->Operator.type)) {
+    // a && b jumps on false if either side is false, and on true only if
+    // both are; a || b the other way around
+    bool is_and = (expr->Operator.type == TokenType::AMPERSAND_AMPERSAND);
+    if (is_and != jump_if_true) {
+      // JumpIf(a, target) JumpIf(b, target)
+      // each jump is at most as likely as either one being taken
+      int each = (prob != kUnknownProb && prob < 50) ? prob : kUnknownProb;
+      genBranch(expr->left.get(), target, jump_if_true, each);
+      genBranch(expr->right.get(), target, jump_if_true, each);
+    } else {
+      // JumpIfNot(a, skip) JumpIf(b, target) Label(skip)
+      // both jumps go toward target at least as often as target is reached
+      int each = (prob != kUnknownProb && prob > 50) ? prob : kUnknownProb;
+      auto skip_label = make_tacky<TackyLabel>(unique_label("logical_skip"));
+      genBranch(expr->left.get(), skip_label, !jump_if_true,
+                invert_prob(each));
+      genBranch(expr->right.get(), target, jump_if_true, each);
+      instructions_.emplace_back(skip_label);
+    }
+    return;
+  }
+
+  if (auto expr = std::get_if<UnaryExpr>(cond);
+      expr && expr->Operator.type == TokenType::BANG) {
+    genBranch(expr->right.get(), target, !jump_if_true, prob);
+    return;
+  }
+
+  // a constant condition either always jumps or never does
+  if (auto expr = std::get_if<LiteralExpr>(cond)) {
+    if ((std::stoi(expr->value) != 0) == jump_if_true) {
+      instructions_.emplace_back(make_tacky<TackyJump>(target));
+    }
+    return;
+  }
+
+  // v = <result of cond>
+  // JumpIfNotZero|JumpIfZero(v, target)
+  auto v = gen(cond);
+  if (jump_if_true) {
+    instructions_.emplace_back(make_tacky<TackyJumpIfNotZero>(v, target, prob));
+  } else {
+    instructions_.emplace_back(make_tacky<TackyJumpIfZero>(v, target, prob));
+  }
+}
+
+const TackyGen::Need& TackyGen::need(const Expr* expr) {
+  auto it = needs_.find(expr);
+  if (it != needs_.end()) {
+    return it->second;
+  }
+  Need n{1, 1, true};
+  auto take = [&n](const Need& inner) {
+    n.ordered = std::max(n.ordered, inner.ordered);
+    n.source = std::max(n.source, inner.source);
+    n.pure = n.pure && inner.pure;
+  };
+  if (std::holds_alternative<LiteralExpr>(*expr)) {
+    n = {0, 0, true};
+  } else if (auto bin = std::get_if<BinaryExpr>(expr)) {
+    n = need(*bin);
+  } else if (auto unary = std::get_if<UnaryExpr>(expr)) {
+    take(need(unary->right.get()));
+  } else if (auto expect = std::get_if<Expect>(expr)) {
+    n = need(expect->value.get());
+    n.pure = n.pure && need(expect->expected.get()).pure;
+  } else if (auto ternary = std::get_if<Conditional>(expr)) {
+    // one arm runs after the condition is dead
+    take(need(ternary->condition.get()));
+    take(need(ternary->thenExp.get()));
+    take(need(ternary->elseExp.get()));
+  } else if (auto assign = std::get_if<Assign>(expr)) {
+    take(need(assign->value.get()));
+    n.pure = false;
+  }
+  return needs_[expr] = n;
+}
+
+TackyGen::Need TackyGen::need(const BinaryExpr& expr) {
+  auto& left = need(expr.left.get());
+  auto& right = need(expr.right.get());
+  bool pure = left.pure && right.pure;
+  if (isLogicalOp(expr.Operator.type)) {
+    // short-circuited, so in order, and each side is tested and dead
+    return {std::max({left.ordered, right.ordered, 1}),
+            std::max({left.source, right.source, 1}), pure};
+  }
+  // the first operand's value, unless a constant, is live while the
+  // second one is evaluated
+  auto in_order = [](int first, int second) {
+    return std::max({first, second + (first > 0), 1});
+  };
+  int ordered = right_first(expr) ? in_order(right.ordered, left.ordered) :
+    in_order(left.ordered, right.ordered);
+  return {ordered, in_order(left.source, right.source), pure};
+}
+
+bool TackyGen::right_first(const BinaryExpr& expr) {
+  auto& left = need(expr.left.get());
+  auto& right = need(expr.right.get());
+  return options_.eval_order && !isLogicalOp(expr.Operator.type) &&
+    left.pure && right.pure && right.ordered > left.ordered;
+}
+
 std::shared_ptr<Tacky> TackyGen::operator()(const BinaryExpr& expr) {
   // binary_operator = Add | Subtract | Multiply | Divide | Remainder | Equal |
   // NotEqual | LessThan | LessOrEqual | GreaterThan | GreaterOrEqual
@@ -360,11 +601,24 @@ std::shared_ptr<Tacky> TackyGen::operator()(const BinaryExpr& expr) {
     return genLogical(expr);
   }
 
-  // v1 = emit_tacky(e1, instructions)
-  std::shared_ptr<Tacky> src1 = gen(expr.left.get());
-
-  // v2 = emit_tacky(e2, instructions)
-  std::shared_ptr<Tacky> src2 = gen(expr.right.get());
+  // Operands without side effects can go in either order; the one needing
+  // more registers goes first, so fewer values are live while it runs.
+  auto n = need(expr);
+  peak_ordered_ = std::max(peak_ordered_, n.ordered);
+  peak_source_ = std::max(peak_source_, n.source);
+  std::shared_ptr<Tacky> src1, src2;
+  if (right_first(expr)) {
+    ++swapped_;
+    // v2 = emit_tacky(e2, instructions)
+    src2 = gen(expr.right.get());
+    // v1 = emit_tacky(e1, instructions)
+    src1 = gen(expr.left.get());
+  } else {
+    // v1 = emit_tacky(e1, instructions)
+    src1 = gen(expr.left.get());
+    // v2 = emit_tacky(e2, instructions)
+    src2 = gen(expr.right.get());
+  }
 
   // dst_name = make_temporary()
   // dst = Var(dst_name)
@@ -385,6 +639,11 @@ std::shared_ptr<Tacky> TackyGen::operator()(const LiteralExpr& expr) {
   return lexpr;
 }
 
+std::shared_ptr<Tacky> TackyGen::operator()(const Expect& expr) {
+  // the value itself; the hint only matters to genBranch
+  return gen(expr.value.get());
+}
+
 std::shared_ptr<Tacky> TackyGen::operator()(const UnaryExpr& expr) {
   // unary_operator = Complement | Negate | Not
   assert(one_of(expr.Operator.type, {TokenType::TILDE, TokenType::MINUS,
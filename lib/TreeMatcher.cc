@@ -0,0 +1,271 @@
+#include "TreeMatcher.h"
+#include "Util.h"
+#include <bit>
+
+using namespace ccomp;
+
+static const int kNoCover = 1 << 20;
+static const int kMulCost = 3;
+
+TreeMatcher::TreeMatcher(std::vector<std::shared_ptr<Asm>>& instructions) :
+  instructions_(instructions)
+{}
+
+void TreeMatcher::emit(Node& root) {
+  labels_.clear();
+  label(root);
+  emit(root, tacky_operand(root));
+}
+
+std::shared_ptr<Asm> TreeMatcher::tacky_operand(const Node& node) {
+  if (auto constant = std::get_if<TackyConstant>(node.value.get())) {
+    return make_asm<AsmImm>(constant->value);
+  }
+  return make_asm<AsmPseudo>(std::get<TackyVar>(*node.value).identifier);
+}
+
+bool TreeMatcher::same(const std::shared_ptr<Asm>& a,
+                       const std::shared_ptr<Asm>& b) {
+  auto pa = std::get_if<AsmPseudo>(a.get());
+  auto pb = std::get_if<AsmPseudo>(b.get());
+  return pa && pb && pa->identifier == pb->identifier;
+}
+
+const int* TreeMatcher::constant(const Node& node) {
+  if (!node.leaf()) {
+    return nullptr;
+  }
+  auto constant = std::get_if<TackyConstant>(node.value.get());
+  return constant ? &constant->value : nullptr;
+}
+
+int TreeMatcher::chain_cost(const std::vector<Step>& steps) {
+  // a leading shift needs a mov into the destination first
+  if (steps.empty()) {
+    return kNoCover;
+  }
+  return steps.size() + (steps[0].shift ? 1 : 0);
+}
+
+// The cheapest lea and shift sequence for x * c, at most two steps deep,
+// or none.
+std::vector<TreeMatcher::Step> TreeMatcher::mul_steps(int c) {
+  static const int factors[] = {2, 3, 4, 5, 8, 9};
+  std::vector<std::vector<Step>> candidates;
+  if (c > 1 && (c & (c - 1)) == 0) {
+    candidates.push_back({{0, std::countr_zero((unsigned)c)}});
+  }
+  for (int f : factors) {
+    if (c == f) {
+      candidates.push_back({{f, 0}});
+    }
+    if (c <= f || c % f != 0) {
+      continue;
+    }
+    int rest = c / f;
+    for (int g : factors) {
+      if (rest == g) {
+        candidates.push_back({{f, 0}, {g, 0}});
+      }
+    }
+    if ((rest & (rest - 1)) == 0) {
+      candidates.push_back({{f, 0}, {0, std::countr_zero((unsigned)rest)}});
+    }
+  }
+
+  std::vector<Step> best;
+  for (auto& steps : candidates) {
+    if (chain_cost(steps) < chain_cost(best)) {
+      best = steps;
+    }
+  }
+  return best;
+}
+
+void TreeMatcher::label(const Node& node) {
+  auto& lab = labels_[&node];
+  for (auto& addr : lab.addrs) {
+    addr.cost = kNoCover;
+  }
+  auto keep = [&lab](const Address& addr) {
+    if (!fits_int(addr.disp)) {
+      return;
+    }
+    int shape = (addr.base ? 1 : 0) | (addr.index ? 2 : 0);
+    if (addr.cost < lab.addrs[shape].cost) {
+      lab.addrs[shape] = addr;
+    }
+  };
+
+  if (node.leaf()) {
+    // leaf: the operand itself, a variable can be a base or an index
+    lab.cost = 0;
+    lab.rule = Rule::Leaf;
+    if (constant(node) == nullptr) {
+      keep({0, &node, nullptr, 1, 0});
+      keep({0, nullptr, &node, 1, 0});
+    }
+    return;
+  }
+
+  label(*node.left);
+  label(*node.right);
+  auto& left = labels_.at(node.left.get());
+  auto& right = labels_.at(node.right.get());
+  const int* lconst = constant(*node.left);
+  const int* rconst = constant(*node.right);
+
+  // addresses the operation folds into
+  if ((node.op == TokenType::PLUS || node.op == TokenType::MINUS) &&
+      (rconst || (lconst && node.op == TokenType::PLUS))) {
+    // addr + c, c + addr, addr - c
+    auto& x = rconst ? left : right;
+    long long c = rconst ? *rconst : *lconst;
+    for (auto addr : x.addrs) {
+      if (addr.cost < kNoCover) {
+        addr.disp += (node.op == TokenType::MINUS) ? -c : c;
+        keep(addr);
+      }
+    }
+  } else if (node.op == TokenType::PLUS) {
+    // addr + addr, with at most one base and one index between them
+    for (auto& a : left.addrs) {
+      for (auto& b : right.addrs) {
+        if (a.cost >= kNoCover || b.cost >= kNoCover ||
+            (a.index && b.index)) {
+          continue;
+        }
+        Address sum{a.cost + b.cost, a.base ? a.base : b.base,
+                    a.index ? a.index : b.index,
+                    a.index ? a.scale : b.scale, a.disp + b.disp};
+        if (a.base && b.base) {
+          if (a.index || b.index) {
+            continue;
+          }
+          sum.index = b.base;
+        }
+        keep(sum);
+      }
+    }
+  } else if (node.op == TokenType::STAR && (lconst != nullptr) != (rconst != nullptr)) {
+    // x * 1|2|4|8 is an index, x * 3|5|9 is x + x*(c - 1)
+    const Node* x = rconst ? node.left.get() : node.right.get();
+    int c = rconst ? *rconst : *lconst;
+    int cost = labels_.at(x).cost;
+    if (c == 1 || c == 2 || c == 4 || c == 8) {
+      keep({cost, nullptr, x, c, 0});
+    } else if (c == 3 || c == 5 || c == 9) {
+      keep({cost, x, x, c - 1, 0});
+    }
+  }
+
+  // the value into a register: Mov + Binary, Lea, or three-operand imull,
+  // preferring lea to imull for its latency
+  lab.cost = 1 + (node.op == TokenType::STAR ? kMulCost : 1) + left.cost +
+             right.cost;
+  lab.rule = Rule::TwoAddress;
+  for (auto& addr : lab.addrs) {
+    if (addr.cost + 1 < lab.cost) {
+      lab.cost = addr.cost + 1;
+      lab.rule = Rule::Lea;
+      lab.lea = addr;
+    }
+  }
+  if (node.op == TokenType::STAR && (lconst != nullptr) != (rconst != nullptr)) {
+    int xcost = rconst ? left.cost : right.cost;
+    if (kMulCost + xcost < lab.cost) {
+      lab.cost = kMulCost + xcost;
+      lab.rule = Rule::ImulImm;
+    }
+    auto steps = mul_steps(rconst ? *rconst : *lconst);
+    if (chain_cost(steps) + xcost < lab.cost) {
+      lab.cost = chain_cost(steps) + xcost;
+      lab.rule = Rule::MulChain;
+      lab.steps = std::move(steps);
+    }
+  }
+
+  // chain rule: the register as a base or an index
+  keep({lab.cost, &node, nullptr, 1, 0});
+  keep({lab.cost, nullptr, &node, 1, 0});
+}
+
+std::shared_ptr<Asm> TreeMatcher::operand(const Node& node) {
+  if (node.leaf()) {
+    return tacky_operand(node);
+  }
+  // a node used as both base and index is only evaluated once
+  auto& lab = labels_.at(&node);
+  if (lab.operand == nullptr) {
+    lab.operand = tacky_operand(node);
+    emit(node, lab.operand);
+  }
+  return lab.operand;
+}
+
+void TreeMatcher::emit(const Node& node, std::shared_ptr<Asm> dest) {
+  auto& lab = labels_.at(&node);
+  switch (lab.rule) {
+    case Rule::Leaf:
+      add_inst<AsmMov>(instructions_, tacky_operand(node), dest);
+      break;
+    case Rule::TwoAddress: {
+      // Mov(left, dst)
+      // Binary(op, right, dst)
+      auto src1 = operand(*node.left);
+      auto src2 = operand(*node.right);
+      if (same(src2, dest) && !same(src1, dest)) {
+        if (node.op == TokenType::MINUS) {
+          // d = a - d is -d + a
+          add_inst<AsmUnary>(instructions_, make_op(TokenType::MINUS), dest);
+          add_inst<AsmBinary>(instructions_, make_op(TokenType::PLUS), src1,
+                              dest);
+          break;
+        }
+        std::swap(src1, src2);
+      }
+      add_inst<AsmMov>(instructions_, src1, dest);
+      add_inst<AsmBinary>(instructions_, make_op(node.op), src2, dest);
+      break;
+    }
+    case Rule::ImulImm: {
+      // ImulImm(c, x, dst)
+      const int* c = constant(*node.right);
+      auto& x = c ? *node.left : *node.right;
+      c = c ? c : constant(*node.left);
+      add_inst<AsmImulImm>(instructions_, *c, operand(x), dest);
+      break;
+    }
+    case Rule::MulChain: {
+      // the first step reads x, the rest work in place on dst
+      auto x = operand(constant(*node.right) ? *node.left : *node.right);
+      for (auto& step : lab.steps) {
+        if (step.shift) {
+          // Mov(x, dst)
+          // Shift(SAL, k, dst)
+          if (x != dest) {
+            add_inst<AsmMov>(instructions_, x, dest);
+          }
+          add_inst<AsmShift>(instructions_, AsmShiftOp::SAL, step.shift, dest);
+        } else if (step.factor == 3 || step.factor == 5 || step.factor == 9) {
+          // Lea((x, x, f - 1), dst)
+          add_inst<AsmLea>(instructions_, x, x, step.factor - 1, 0, dest);
+        } else {
+          // Lea((, x, f), dst)
+          add_inst<AsmLea>(instructions_, nullptr, x, step.factor, 0, dest);
+        }
+        x = dest;
+      }
+      break;
+    }
+    case Rule::Lea: {
+      // Lea(disp(base, index, scale), dst)
+      auto& addr = lab.lea;
+      auto base = addr.base ? operand(*addr.base) : nullptr;
+      auto index = addr.index ? operand(*addr.index) : nullptr;
+      add_inst<AsmLea>(instructions_, base, index, addr.scale, (int)addr.disp,
+                       dest);
+      break;
+    }
+  }
+}
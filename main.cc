@@ -4,9 +4,12 @@
 #include "Resolver.h"
 // #include "AstPrinter.h"
 #include "TackyGen.h"
+#include "Optimizer.h"
+#include "Options.h"
 #include "AsmGen.h"
 #include "Codegen.h"
 #include <cstdio>
+#include <cstdlib>
 #include <cstring>
 #include <filesystem>
 #include <format>
@@ -23,7 +26,7 @@ const int PHASE_CODEGEN = 0xf;
 #define SETBIT(val, mask) ((val) |= (1<<(mask)))
 #define ISBITSET(val, mask) (((val) & (1<<(mask)))!=0)
 
-static int compile(const std::string& source, const char* outputpath, ccomp::ErrorHandler& errorHandler, int compiler_phases) {
+static int compile(const std::string& source, const char* outputpath, ccomp::ErrorHandler& errorHandler, int compiler_phases, const ccomp::Options& options) {
   if (!ISBITSET(compiler_phases, PHASE_LEX)) {
     printf("no lex\n");
     return 0;
@@ -84,7 +87,7 @@ static int compile(const std::string& source, const char* outputpath, ccomp::Err
   }
 
   /// tackygen
-  ccomp::TackyGen tackygen(stmts, errorHandler);
+  ccomp::TackyGen tackygen(stmts, options, errorHandler);
   auto tackyasm = tackygen.gen();
   // if found error during parsing, report
   if (errorHandler.foundError) {
@@ -92,13 +95,25 @@ static int compile(const std::string& source, const char* outputpath, ccomp::Err
     return 65;
   }
 
+  /// optimizer
+  ccomp::Profile profile(options);
+  if (!options.profile_use.empty()) {
+    profile.load();
+  }
+  ccomp::Optimizer optimizer(tackyasm.get(), options, profile, errorHandler);
+  optimizer.optimize();
+  if (errorHandler.foundError) {
+    errorHandler.report();
+    return 65;
+  }
+
   if (!ISBITSET(compiler_phases, PHASE_CODEGEN)) {
     printf("no codegen\n");
     return 0;
   }
 
   /// asmgen
-  ccomp::AsmGen asmgen(tackyasm.get(), errorHandler);
+  ccomp::AsmGen asmgen(tackyasm.get(), options, profile, errorHandler);
   auto progasm = asmgen.gen();
   // if found error during parsing, report
   if (errorHandler.foundError) {
@@ -107,7 +122,7 @@ static int compile(const std::string& source, const char* outputpath, ccomp::Err
   }
 
   /// codegen
-  ccomp::Codegen codegen(progasm.get(), errorHandler);
+  ccomp::Codegen codegen(progasm.get(), options, profile, errorHandler);
   auto codeasm = codegen.code();
   // if found error during parsing, report
   if (errorHandler.foundError) {
@@ -126,7 +141,7 @@ static int compile(const std::string& source, const char* outputpath, ccomp::Err
   return 0;
 }
 
-static int compileFile(const std::string& path, const char* outputpath, ccomp::ErrorHandler& errorHandler, int compiler_phases) {
+static int compileFile(const std::string& path, const char* outputpath, ccomp::ErrorHandler& errorHandler, int compiler_phases, const ccomp::Options& options) {
   // preprocess file with gcc
   std::filesystem::path filepath(path);
   std::filesystem::path filestem = filepath.filename().stem();
@@ -143,43 +158,41 @@ static int compileFile(const std::string& path, const char* outputpath, ccomp::E
     std::ostringstream stream;
     stream << file.rdbuf();
     file.close();
-    retCode = compile(stream.str(), outputpath, errorHandler, compiler_phases);
+    retCode = compile(stream.str(), outputpath, errorHandler, compiler_phases, options);
   }
 
   return retCode;
 }
 
+// Parses "--name=value" into value. Returns false if opt is some other option.
+static bool parseKnob(const char* opt, const char* name, int* value) {
+  size_t len = strlen(name);
+  if (strncmp(opt, name, len) != 0 || opt[len] != '=') {
+    return false;
+  }
+  *value = std::atoi(opt + len + 1);
+  return true;
+}
+
+// Parses "--name=path" into value. Returns false if opt is some other option.
+static bool parsePath(const char* opt, const char* name, std::string* value) {
+  size_t len = strlen(name);
+  if (strncmp(opt, name, len) != 0 || opt[len] != '=') {
+    return false;
+  }
+  *value = opt + len + 1;
+  return true;
+}
+
 int main(int argc, char** argv) {
   int retCode = 0;
-  if (argc < 2) {
-    printf("Usage: ccomp [filename]\n");
-    retCode = 1;
-  } else if (argc == 2) {
-    int compiler_phases = 0;
-    SETBIT(compiler_phases, PHASE_LEX);
-    SETBIT(compiler_phases, PHASE_PARSE);
-    SETBIT(compiler_phases, PHASE_RESOLVE);
-    SETBIT(compiler_phases, PHASE_TACKY);
-    SETBIT(compiler_phases, PHASE_CODEGEN);
-
-    std::filesystem::path filepath(argv[1]);
-    std::filesystem::path filestem = filepath.filename().stem();
-    std::filesystem::path asmoutputpath = filepath.parent_path() / (filestem.string() + ".s");
-    printf ("compiling %s\n", filepath.c_str());
-    printf("output filename %s\n", asmoutputpath.c_str());
+  int compiler_phases = 0;
+  const char* filename = nullptr;
+  ccomp::Options options;
+  bool profile_generate = false;
 
-    ccomp::ErrorHandler errorHandler;
-    retCode = compileFile(filepath, asmoutputpath.c_str(), errorHandler,
-                          compiler_phases);
-    if (retCode == 0) {
-      // produced an asm file, compile with gcc.
-      std::filesystem::path binoutputpath = filepath.parent_path() / filestem;
-      std::string gcc_args = std::format("gcc {} -o {}", asmoutputpath.c_str(), binoutputpath.c_str());
-      retCode = std::system(gcc_args.c_str());
-    }
-  } else if (argc == 3) {
-    const char* opt = argv[1];
-    int compiler_phases = 0;
+  for (int i = 1; i < argc; ++i) {
+    const char* opt = argv[i];
     if (strcmp(opt, "--lex") == 0) {
       SETBIT(compiler_phases, PHASE_LEX);
     } else if (strcmp(opt, "--parse") == 0) {
@@ -200,11 +213,81 @@ int main(int argc, char** argv) {
       SETBIT(compiler_phases, PHASE_RESOLVE);
       SETBIT(compiler_phases, PHASE_TACKY);
       SETBIT(compiler_phases, PHASE_CODEGEN);
+    } else if (strcmp(opt, "--stats") == 0) {
+      options.stats = true;
+    } else if (strcmp(opt, "--profile-generate") == 0) {
+      profile_generate = true;
+    } else if (parsePath(opt, "--profile-generate",
+                         &options.profile_generate) ||
+               parsePath(opt, "--profile-use", &options.profile_use)) {
+      // profile-guided optimization
+    } else if (parseKnob(opt, "--eval-order", &options.eval_order) ||
+               parseKnob(opt, "--unroll-max-size", &options.unroll_max_size) ||
+               parseKnob(opt, "--unroll-factor", &options.unroll_factor) ||
+               parseKnob(opt, "--unswitch-max-growth",
+                         &options.unswitch_max_growth) ||
+               parseKnob(opt, "--thread-max-size", &options.thread_max_size) ||
+               parseKnob(opt, "--cmov-miss-cost", &options.cmov_miss_cost) ||
+               parseKnob(opt, "--reassociate", &options.reassociate) ||
+               parseKnob(opt, "--alloc-regs", &options.alloc_regs) ||
+               parseKnob(opt, "--store-forwarding",
+                         &options.store_forwarding) ||
+               parseKnob(opt, "--peephole", &options.peephole) ||
+               parseKnob(opt, "--block-layout", &options.block_layout) ||
+               parseKnob(opt, "--hot-cold-split", &options.hot_cold_split) ||
+               parseKnob(opt, "--omit-frame-pointer",
+                         &options.omit_frame_pointer) ||
+               parseKnob(opt, "--shrink-wrap", &options.shrink_wrap)) {
+      // optimization knob
+    } else if (opt[0] == '-') {
+      printf("unknown option %s\n", opt);
+      return 1;
+    } else {
+      filename = opt;
     }
+  }
+
+  // the instrumented program writes its profile next to the source by
+  // default, wherever it runs from
+  if (filename != nullptr && profile_generate) {
+    std::filesystem::path filepath(filename);
+    options.profile_generate = (filepath.parent_path() /
+      (filepath.filename().stem().string() + ".profdata")).string();
+  }
+  if (!options.profile_generate.empty()) {
+    options.profile_generate =
+      std::filesystem::absolute(options.profile_generate).string();
+  }
+
+  if (filename == nullptr) {
+    printf("Usage: ccomp [options] [filename]\n");
+    retCode = 1;
+  } else if (compiler_phases == 0) {
+    SETBIT(compiler_phases, PHASE_LEX);
+    SETBIT(compiler_phases, PHASE_PARSE);
+    SETBIT(compiler_phases, PHASE_RESOLVE);
+    SETBIT(compiler_phases, PHASE_TACKY);
+    SETBIT(compiler_phases, PHASE_CODEGEN);
 
-    const char* filepath = argv[2];
+    std::filesystem::path filepath(filename);
+    std::filesystem::path filestem = filepath.filename().stem();
+    std::filesystem::path asmoutputpath = filepath.parent_path() / (filestem.string() + ".s");
+    printf ("compiling %s\n", filepath.c_str());
+    printf("output filename %s\n", asmoutputpath.c_str());
+
+    ccomp::ErrorHandler errorHandler;
+    retCode = compileFile(filepath, asmoutputpath.c_str(), errorHandler,
+                          compiler_phases, options);
+    if (retCode == 0) {
+      // produced an asm file, compile with gcc.
+      std::filesystem::path binoutputpath = filepath.parent_path() / filestem;
+      std::string gcc_args = std::format("gcc {} -o {}", asmoutputpath.c_str(), binoutputpath.c_str());
+      retCode = std::system(gcc_args.c_str());
+    }
+  } else {
     ccomp::ErrorHandler errorHandler;
-    retCode = compileFile(filepath, nullptr, errorHandler, compiler_phases);
+    retCode = compileFile(filename, nullptr, errorHandler, compiler_phases,
+                          options);
   }
 
   return retCode;
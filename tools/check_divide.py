@@ -0,0 +1,156 @@
+#!/usr/bin/env python3
+"""Checks ccomp's lowering of division, remainder and multiplication by
+constants.
+
+Generates programs that compute x / d, x % d and x * c for a spread of
+constants, with x at the int boundaries, around multiples of the constant
+and at random, and compares every result against the value C gives (with
+32-bit wraparound for the products). Each program exits with the 1-based
+index of a failing constant within its chunk, or 0.
+
+    tools/check_divide.py _gate_build/ccomp
+    tools/check_divide.py _gate_build/ccomp --bench
+
+--bench times a loop dividing by constants against the same loop dividing
+by variables holding them, which still goes through idivl.
+"""
+import argparse
+import os
+import random
+import subprocess
+import sys
+import tempfile
+import time
+
+INT_MIN, INT_MAX = -2**31, 2**31 - 1
+CHUNK = 20
+
+DIVISORS = ([d for d in range(-64, 65) if d != 0] +
+            [2**k for k in range(7, 31)] +
+            [-(2**k) for k in range(7, 32)] +
+            [100, -100, 125, -125, 641, -641, 1000, -1000, 7919, 65535,
+             65537, -65537, 6700417, 3 << 20, 0x55555555, -0x55555555,
+             715827883, -715827883, INT_MAX, INT_MIN + 1])
+MULTIPLIERS = (list(range(-3, 70)) +
+               [72, 80, 81, 96, 100, 128, 1000, 1024, 4096, 65536, -65536,
+                INT_MAX, INT_MIN])
+
+
+def wrap(value):
+    value &= 0xffffffff
+    return value - 2**32 if value > INT_MAX else value
+
+
+def c_div(a, b):
+    q = abs(a) // abs(b)
+    return q if (a < 0) == (b < 0) else -q
+
+
+def lit(value):
+    # -2147483648 is unary minus applied to a constant that does not fit
+    return "(-2147483647 - 1)" if value == INT_MIN else str(value)
+
+
+def operands(d, rng):
+    xs = {INT_MIN, INT_MIN + 1, -1, 0, 1, INT_MAX - 1, INT_MAX}
+    for m in (1, 2, 3, 1000, INT_MAX // max(abs(d), 1)):
+        for e in (-1, 0, 1):
+            for s in (1, -1):
+                v = s * m * abs(d) + e
+                if INT_MIN <= v <= INT_MAX:
+                    xs.add(v)
+    xs.update(rng.randint(INT_MIN, INT_MAX) for _ in range(20))
+    # INT_MIN / -1 overflows
+    if d == -1:
+        xs.discard(INT_MIN)
+    return sorted(xs)
+
+
+def check_program(kind, constants, rng):
+    lines = ["int main(void) {", "  int bad = 0;", "  int x = 0;"]
+    for k, c in enumerate(constants, 1):
+        for x in operands(c, rng):
+            lines.append(f"  x = {lit(x)};")
+            if kind == "div":
+                q = c_div(x, c)
+                checks = [(f"x / {lit(c)}", q), (f"x % {lit(c)}", x - q * c)]
+            else:
+                p = wrap(x * c)
+                checks = [(f"x * {lit(c)}", p), (f"{lit(c)} * x", p)]
+            for expr, want in checks:
+                lines.append(f"  if ({expr} != {lit(want)}) bad = {k};")
+    lines += ["  return bad;", "}"]
+    return "\n".join(lines) + "\n"
+
+
+def bench_program(constant):
+    divisor = (lambda d: str(d)) if constant else (lambda d: f"d{d}")
+    return f"""int main(void) {{
+  int d7 = 7; int d10 = 10; int d16 = 16; int d641 = 641;
+  int s = 0;
+  for (int i = 0; i < 100000000; i = i + 1) {{
+    s = s + i / {divisor(10)} + i % {divisor(7)} + i / {divisor(16)} +
+      i % {divisor(641)};
+  }}
+  return s % 256;
+}}
+"""
+
+
+def build(ccomp, workdir, name, source, flags):
+    path = os.path.join(workdir, name + ".c")
+    with open(path, "w") as f:
+        f.write(source)
+    result = subprocess.run([ccomp] + flags + [path], capture_output=True,
+                            text=True, cwd=workdir)
+    if result.returncode != 0:
+        sys.exit(f"{name}: ccomp failed\n{result.stderr}")
+    return os.path.join(workdir, name)
+
+
+def check(args, workdir):
+    rng = random.Random(args.seed)
+    failed = False
+    for kind, constants in (("div", DIVISORS), ("mul", MULTIPLIERS)):
+        for start in range(0, len(constants), CHUNK):
+            chunk = constants[start:start + CHUNK]
+            name = f"{kind}{start // CHUNK}"
+            exe = build(args.ccomp, workdir, name,
+                        check_program(kind, chunk, rng), args.flags)
+            bad = subprocess.run([exe]).returncode
+            if bad != 0:
+                failed = True
+                op = "/ and %" if kind == "div" else "*"
+                print(f"FAIL {op} by {chunk[bad - 1]}" if bad <= len(chunk)
+                      else f"FAIL {name}: exit {bad}")
+    print("FAILED" if failed else
+          f"OK: {len(DIVISORS)} divisors, {len(MULTIPLIERS)} multipliers")
+    return 1 if failed else 0
+
+
+def bench(args, workdir):
+    for name, constant in (("constant", True), ("variable", False)):
+        exe = build(args.ccomp, workdir, name, bench_program(constant),
+                    args.flags)
+        start = time.perf_counter()
+        subprocess.run([exe])
+        print(f"{name} divisors: {time.perf_counter() - start:.3f}s")
+    return 0
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.split("\n\n")[0])
+    parser.add_argument("ccomp", help="the compiler to test")
+    parser.add_argument("--bench", action="store_true",
+                        help="run the microbenchmark instead of the checks")
+    parser.add_argument("--seed", type=int, default=1,
+                        help="seed for the random dividends")
+    parser.add_argument("flags", nargs="*", help="extra flags for ccomp")
+    args = parser.parse_args()
+    args.ccomp = os.path.abspath(args.ccomp)
+    with tempfile.TemporaryDirectory() as workdir:
+        return bench(args, workdir) if args.bench else check(args, workdir)
+
+
+if __name__ == "__main__":
+    sys.exit(main())